@@ -166,6 +166,9 @@ void mImageBlit(struct mImage* image, const struct mImage* source, int x, int y)
 void mImageComposite(struct mImage* image, const struct mImage* source, int x, int y);
 void mImageCompositeWithAlpha(struct mImage* image, const struct mImage* source, int x, int y, float alpha);
 
+uint32_t mImageHashRegion(const struct mImage* image, int x, int y, int width, int height);
+unsigned mImageCompare(const struct mImage* image, const struct mImage* other, int x, int y);
+
 void mPainterInit(struct mPainter*, struct mImage* backing);
 void mPainterDrawRectangle(struct mPainter*, int x, int y, int width, int height);
 void mPainterDrawLine(struct mPainter*, int x1, int y1, int x2, int y2);
@@ -32,6 +32,7 @@ struct PatchFast {
 void initPatchFast(struct PatchFast*);
 void deinitPatchFast(struct PatchFast*);
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size);
+bool diffPatchFastRange(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t offset, size_t size);
 
 CXX_GUARD_END
 
@@ -34,6 +34,8 @@ struct mCoreOptions {
 	bool rewindEnable;
 	int rewindBufferCapacity;
 	int rewindBufferInterval;
+	int rewindBufferMemory;
+	int runAhead;
 	float fpsTarget;
 	size_t audioBuffers;
 	unsigned sampleRate;
@@ -101,10 +101,13 @@ struct mCore {
 	void (*runFrame)(struct mCore*);
 	void (*runLoop)(struct mCore*);
 	void (*step)(struct mCore*);
+	// Optional: don't render the next given number of frames
+	void (*skipFrames)(struct mCore*, int frames);
 
 	size_t (*stateSize)(struct mCore*);
 	bool (*loadState)(struct mCore*, const void* state);
 	bool (*saveState)(struct mCore*, void* state);
+	bool (*saveStateIncremental)(struct mCore*, void* state, uint32_t* epoch, uint32_t* changedPages);
 	bool (*loadExtraState)(struct mCore*, const struct mStateExtdata*);
 	bool (*saveExtraState)(struct mCore*, struct mStateExtdata*);
 
@@ -140,6 +143,11 @@ struct mCore {
 
 	size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
 	void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
+	// Optional: stamp memory stored to since the last collection with a new
+	// epoch and return it, and ask whether a range of a memory block has been
+	// stored to since a given epoch. Untracked blocks always report stores.
+	uint32_t (*collectMemoryStores)(struct mCore*);
+	bool (*memoryBlockStoredSince)(struct mCore*, size_t id, uint32_t offset, uint32_t length, uint32_t epoch);
 
 	size_t (*listRegisters)(const struct mCore*, const struct mCoreRegisterInfo**);
 	bool (*readRegister)(const struct mCore*, const char* name, void* out);
@@ -160,6 +168,8 @@ struct mCore {
 
 	size_t (*savedataClone)(struct mCore*, void** sram);
 	bool (*savedataRestore)(struct mCore*, const void* sram, size_t size, bool writeback);
+	// Optional: a value that changes whenever the game writes to its savedata
+	uint64_t (*savedataStamp)(struct mCore*);
 
 	size_t (*listVideoLayers)(const struct mCore*, const struct mCoreChannelInfo**);
 	size_t (*listAudioChannels)(const struct mCore*, const struct mCoreChannelInfo**);
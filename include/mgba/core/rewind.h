@@ -10,21 +10,46 @@
 
 CXX_GUARD_START
 
+#include <mgba/core/serialize.h>
+#include <mgba-util/patch/fast.h>
 #include <mgba-util/vector.h>
 #ifndef DISABLE_THREADING
 #include <mgba-util/threading.h>
 #endif
 
-DECLARE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#define mREWIND_KEYFRAME_INTERVAL 60
+
+struct mCoreRewindEntry {
+	// XOR from this state to the one before it, compressed if possible
+	void* diff;
+	size_t diffSize;
+	size_t diffRawSize;
+	// Optional full copy of this state, compressed if possible
+	void* keyframe;
+	size_t keyframeSize;
+	size_t stateSize;
+};
+
+DECLARE_VECTOR(mCoreRewindEntries, struct mCoreRewindEntry);
 
 struct VFile;
 struct mCoreRewindContext {
-	struct mCoreRewindPatches patchMemory;
+	struct mCoreRewindEntries entries;
 	size_t current;
 	size_t size;
+	size_t budget;
+	size_t usage;
+	unsigned keyframeInterval;
+	unsigned sinceKeyframe;
+	struct PatchFast patch;
+	void* scratch;
+	size_t scratchSize;
 	struct VFile* previousState;
 	struct VFile* currentState;
+	struct mStateIncremental previousIncremental;
+	struct mStateIncremental currentIncremental;
 	int rewindFrameCounter;
+	bool seeking;
 
 #ifndef DISABLE_THREADING
 	bool onThread;
@@ -37,10 +62,14 @@ struct mCoreRewindContext {
 
 void mCoreRewindContextInit(struct mCoreRewindContext*, size_t entries, bool onThread);
 void mCoreRewindContextDeinit(struct mCoreRewindContext*);
+void mCoreRewindContextSetBudget(struct mCoreRewindContext*, size_t bytes);
 
 struct mCore;
 void mCoreRewindAppend(struct mCoreRewindContext*, struct mCore*);
 bool mCoreRewindRestore(struct mCoreRewindContext*, struct mCore*, unsigned count);
+// Like mCoreRewindRestore, but then emulates one frame from the target so the
+// video output shows it, and goes back to the target. seeking is set meanwhile.
+bool mCoreRewindSeek(struct mCoreRewindContext*, struct mCore*, unsigned count);
 
 CXX_GUARD_END
 
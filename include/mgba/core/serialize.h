@@ -41,6 +41,23 @@ struct mStateExtdata {
 	struct mStateExtdataItem data[EXTDATA_MAX];
 };
 
+// On-disk extdata directory entry, stored little-endian after the core state
+struct mStateExtdataHeader {
+	uint32_t tag;
+	int32_t size;
+	int64_t offset;
+};
+
+#define mSTATE_PAGE_SHIFT 12
+#define mSTATE_PAGE_SIZE (1 << mSTATE_PAGE_SHIFT)
+
+struct mStateIncremental {
+	uint32_t epoch;
+	size_t stateSize;
+	size_t nPages;
+	uint32_t* changedPages;
+};
+
 void mStateExtdataInit(struct mStateExtdata*);
 void mStateExtdataDeinit(struct mStateExtdata*);
 void mStateExtdataPut(struct mStateExtdata*, enum mStateExtdataTag, struct mStateExtdataItem*);
@@ -54,6 +71,18 @@ struct mCore;
 bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags);
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags);
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
+
+// Save into a caller-owned buffer, returning the number of bytes the state
+// needs. Nothing is written if that's larger than size. If no SAVESTATE_*
+// flags are set only the raw core state is written, without extdata or any
+// allocation. The buffer must be aligned at least as strictly as malloc's.
+size_t mCoreSaveStateBuffer(struct mCore* core, void* buffer, size_t size, int flags);
+bool mCoreLoadStateBuffer(struct mCore* core, const void* buffer, size_t size, int flags);
+
+void mStateIncrementalInit(struct mStateIncremental*);
+void mStateIncrementalDeinit(struct mStateIncremental*);
+void mStateIncrementalInvalidate(struct mStateIncremental*);
+bool mCoreSaveStateIncremental(struct mCore* core, struct VFile* vf, int flags, struct mStateIncremental*);
 bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata);
 
 CXX_GUARD_END
@@ -0,0 +1,58 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_STATE_JOURNAL_H
+#define M_CORE_STATE_JOURNAL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/patch/fast.h>
+#include <mgba-util/vector.h>
+
+#define mSTATE_JOURNAL_REBASE_INTERVAL 64
+
+struct mStateJournalEntry {
+	uint64_t offset;
+	uint32_t base;
+	uint32_t size;
+};
+
+DECLARE_VECTOR(mStateJournalEntryList, struct mStateJournalEntry);
+
+// An append-only file of savestates. Each checkpoint is stored either in
+// full or as a PatchFast diff against the last full checkpoint before it,
+// and an index at the end of the file allows extracting any of them. The
+// VFile stays owned by the caller.
+struct mStateJournal {
+	struct VFile* vf;
+	struct mStateJournalEntryList entries;
+	unsigned rebaseInterval;
+	size_t end;
+	bool dirty;
+
+	uint8_t* base;
+	size_t baseSize;
+	uint32_t baseIndex;
+	struct PatchFast patch;
+	struct VFile* scratch;
+};
+
+struct mCore;
+bool mStateJournalOpen(struct mStateJournal*, struct VFile* vf);
+bool mStateJournalClose(struct mStateJournal*);
+bool mStateJournalFlush(struct mStateJournal*);
+
+bool mStateJournalAppend(struct mStateJournal*, const void* state, size_t size);
+bool mStateJournalAppendCore(struct mStateJournal*, struct mCore*, int flags);
+
+size_t mStateJournalCount(const struct mStateJournal*);
+bool mStateJournalExtract(struct mStateJournal*, size_t index, struct VFile* out);
+bool mStateJournalLoad(struct mStateJournal*, struct mCore*, size_t index, int flags);
+
+CXX_GUARD_END
+
+#endif
@@ -0,0 +1,64 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_CORE_STATE_TREE_H
+#define M_CORE_STATE_TREE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/serialize.h>
+#include <mgba-util/table.h>
+
+struct mStatePage {
+	struct mStatePage* next;
+	uint32_t hash;
+	uint32_t refs;
+	size_t size;
+	uint8_t data[];
+};
+
+struct mStateNode {
+	uint32_t id;
+	uint32_t parent;
+	uint32_t firstChild;
+	uint32_t nextSibling;
+	size_t size;
+	size_t nPages;
+	struct mStatePage** pages;
+};
+
+// An in-memory set of savestates linked as a tree. States are split into
+// pages that are shared between all states with identical contents.
+struct mStateTree {
+	struct Table nodes;
+	struct Table pages;
+	uint32_t nextId;
+	uint32_t firstRoot;
+	uint32_t head;
+
+	struct VFile* work;
+	uint32_t workNode;
+	struct mStateIncremental incremental;
+
+	size_t uniquePages;
+	size_t pageBytes;
+};
+
+struct mCore;
+void mStateTreeInit(struct mStateTree*);
+void mStateTreeDeinit(struct mStateTree*);
+
+uint32_t mStateTreeSave(struct mStateTree*, struct mCore*, int flags);
+bool mStateTreeLoad(struct mStateTree*, struct mCore*, uint32_t id, int flags);
+bool mStateTreeRemove(struct mStateTree*, uint32_t id);
+
+const struct mStateNode* mStateTreeGet(const struct mStateTree*, uint32_t id);
+size_t mStateTreeChildren(const struct mStateTree*, uint32_t id, uint32_t* children, size_t max);
+
+CXX_GUARD_END
+
+#endif
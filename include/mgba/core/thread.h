@@ -95,6 +95,14 @@ struct mCoreThreadInternal {
 	struct mCoreSync sync;
 	struct mCoreRewindContext rewind;
 	struct mCore* core;
+
+	void* runAheadState;
+	size_t runAheadStateSize;
+	void* runAheadSavedata;
+	size_t runAheadSavedataSize;
+	uint64_t runAheadSavedataStamp;
+	bool frameHidden;
+	bool runAheadSpeculative;
 };
 
 #endif
@@ -126,6 +134,7 @@ void mCoreThreadMarkCrashed(struct mCoreThread* threadContext);
 void mCoreThreadClearCrashed(struct mCoreThread* threadContext);
 
 void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool);
+bool mCoreThreadRewindSeek(struct mCoreThread* threadContext, unsigned count);
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext);
 
 struct mCoreThread* mCoreThreadGet(void);
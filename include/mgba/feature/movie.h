@@ -0,0 +1,82 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_MOVIE_H
+#define M_MOVIE_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/vector.h>
+
+#define mMOVIE_KEYFRAME_INTERVAL 600
+
+enum mMovieMode {
+	mMOVIE_IDLE = 0,
+	mMOVIE_RECORDING,
+	mMOVIE_PLAYING,
+};
+
+struct mMovieKeyframe {
+	uint32_t frame;
+	struct VFile* state;
+};
+
+// Keys that changed between two reads within the same frame
+struct mMovieKeyChange {
+	uint32_t frame;
+	uint32_t read;
+	uint32_t keys;
+};
+
+DECLARE_VECTOR(mMovieKeyframeList, struct mMovieKeyframe);
+DECLARE_VECTOR(mMovieKeyChangeList, struct mMovieKeyChange);
+
+// Per-frame key input plus savestate keyframes. A movie always starts
+// from a keyframe at frame 0, so replaying it doesn't depend on how the
+// game was booted, and seeking only runs forward from the nearest keyframe.
+struct mMovie {
+	struct mCore* core;
+	struct mCoreCallbacks callbacks;
+	enum mMovieMode mode;
+
+	uint32_t platform;
+	uint32_t crc32;
+	unsigned keyframeInterval;
+	struct UInt32List keys;
+	struct mMovieKeyChangeList changes;
+	struct mMovieKeyframeList keyframes;
+
+	uint32_t frame;
+	uint32_t reads;
+	uint32_t frameKeys;
+	uint32_t lastKeys;
+	size_t nextChange;
+};
+
+struct mCore;
+struct VFile;
+void mMovieInit(struct mMovie*);
+void mMovieDeinit(struct mMovie*);
+
+// Movies hook the core's callbacks, which can't be removed again, so a
+// movie must stay alive as long as the core it was attached to
+void mMovieAttach(struct mMovie*, struct mCore*);
+
+bool mMovieRecord(struct mMovie*);
+bool mMoviePlay(struct mMovie*);
+void mMovieStop(struct mMovie*);
+bool mMovieSeek(struct mMovie*, uint32_t frame);
+
+size_t mMovieFrameCount(const struct mMovie*);
+
+bool mMovieLoad(struct mMovie*, struct VFile* vf);
+bool mMovieSave(const struct mMovie*, struct VFile* vf);
+
+CXX_GUARD_END
+
+#endif
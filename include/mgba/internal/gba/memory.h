@@ -90,6 +90,16 @@ enum {
 	AGB_PRINT_FLUSH_ADDR = 0x00FE209C,
 };
 
+// Dirty pages are numbered by where they land in the serialized state:
+// page 0 holds the header, IO, palette and OAM, and is always rewritten
+enum {
+	GBA_DIRTY_PAGE_SHIFT = 12,
+	GBA_DIRTY_PAGE_VRAM = 1,
+	GBA_DIRTY_PAGE_IWRAM = GBA_DIRTY_PAGE_VRAM + (GBA_SIZE_VRAM >> GBA_DIRTY_PAGE_SHIFT),
+	GBA_DIRTY_PAGE_EWRAM = GBA_DIRTY_PAGE_IWRAM + (GBA_SIZE_IWRAM >> GBA_DIRTY_PAGE_SHIFT),
+	GBA_DIRTY_PAGES = GBA_DIRTY_PAGE_EWRAM + (GBA_SIZE_EWRAM >> GBA_DIRTY_PAGE_SHIFT)
+};
+
 mLOG_DECLARE_CATEGORY(GBA_MEM);
 
 struct GBAPrintContext {
@@ -138,6 +148,10 @@ struct GBAMemory {
 	struct GBAPrintContext agbPrintCtxBackup;
 	uint32_t agbPrintFuncBackup;
 	uint16_t* agbPrintBufferBackup;
+
+	uint32_t dirtyPages[(GBA_DIRTY_PAGES + 31) / 32];
+	uint32_t dirtyPageEpoch[GBA_DIRTY_PAGES];
+	uint32_t dirtyEpoch;
 };
 
 struct GBA;
@@ -173,8 +187,11 @@ uint32_t GBAStoreMultiple(struct ARMCore*, uint32_t baseAddress, int mask, enum
 void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters);
 void GBAAdjustEWRAMWaitstates(struct GBA* gba, uint16_t parameters);
 
+void GBAMemoryMarkAllDirty(struct GBAMemory* memory);
+uint32_t GBAMemoryCollectDirtyPages(struct GBAMemory* memory);
+void GBAMemoryLoadPages(struct GBAMemory* memory, unsigned page, void* dest, const void* src, size_t size);
+
 struct GBASerializedState;
-void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state);
 void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state);
 
 void GBAPrintFlush(struct GBA* gba);
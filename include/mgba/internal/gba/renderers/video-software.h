@@ -104,6 +104,7 @@ struct GBAVideoSoftwareRenderer {
 	mColor variantPalette[512];
 	mColor highlightPalette[512];
 	mColor highlightVariantPalette[512];
+	mColor variantChannels[3][32];
 
 	uint16_t blda;
 	uint16_t bldb;
@@ -125,6 +126,7 @@ struct GBAVideoSoftwareRenderer {
 	struct WindowControl objwin;
 
 	struct WindowControl currentWindow;
+	bool objwinActive;
 
 	int nWindows;
 	struct Window windows[MAX_WINDOW];
@@ -135,6 +137,7 @@ struct GBAVideoSoftwareRenderer {
 	bool oamDirty;
 	int oamMax;
 	struct GBAVideoRendererSprite sprites[128];
+	uint32_t spriteRows[GBA_VIDEO_VERTICAL_PIXELS][4];
 	int16_t objOffsetX;
 	int16_t objOffsetY;
 
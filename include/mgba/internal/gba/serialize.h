@@ -485,10 +485,15 @@ struct GBASerializedState {
 };
 
 static_assert(sizeof(struct GBASerializedState) == 0x61000, "GBA savestate struct sized wrong");
+static_assert(offsetof(struct GBASerializedState, vram) == GBA_DIRTY_PAGE_VRAM << GBA_DIRTY_PAGE_SHIFT, "GBA savestate VRAM misaligned");
+static_assert(offsetof(struct GBASerializedState, iwram) == GBA_DIRTY_PAGE_IWRAM << GBA_DIRTY_PAGE_SHIFT, "GBA savestate IWRAM misaligned");
+static_assert(offsetof(struct GBASerializedState, wram) == GBA_DIRTY_PAGE_EWRAM << GBA_DIRTY_PAGE_SHIFT, "GBA savestate EWRAM misaligned");
+static_assert(sizeof(struct GBASerializedState) == GBA_DIRTY_PAGES << GBA_DIRTY_PAGE_SHIFT, "GBA savestate pages sized wrong");
 
 struct VDir;
 
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state);
+uint32_t GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t since, uint32_t* changedPages);
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state);
 
 CXX_GUARD_END
@@ -13,6 +13,7 @@ CXX_GUARD_START
 #include <mgba/core/log.h>
 #include <mgba/script/types.h>
 #include <mgba-util/table.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #define mSCRIPT_KV_PAIR(KEY, VALUE) { #KEY, (struct mScriptValue*) VALUE }
@@ -21,10 +22,62 @@ CXX_GUARD_START
 
 mLOG_DECLARE_CATEGORY(SCRIPT);
 
+#define mSCRIPT_POOL_MIN_SIZE 32
+#define mSCRIPT_POOL_CLASSES 3
+#define mSCRIPT_POOL_DEPTH 256
+
 struct mScriptFrame;
 struct mScriptFunction;
 struct mScriptEngineContext;
 
+// Freed blocks kept for reuse. Requests are rounded up to power-of-two size
+// classes starting at mSCRIPT_POOL_MIN_SIZE, i.e. 32, 64 and 128 bytes
+struct mScriptPool {
+	void* blocks[mSCRIPT_POOL_CLASSES];
+	unsigned count[mSCRIPT_POOL_CLASSES];
+};
+
+// A watched range of a memory domain, along with a copy of its contents as
+// of the last check
+struct mScriptWatch {
+	struct mScriptValue* domain;
+	uint32_t address;
+	uint32_t length;
+	uint32_t id;
+	bool primed;
+	bool pending;
+	uint8_t* shadow;
+};
+
+DECLARE_VECTOR(mScriptWatchList, struct mScriptWatch*);
+
+struct mScriptCallbackStats {
+	uint64_t triggers;
+	uint64_t calls;
+	uint64_t usec;
+};
+
+struct mScriptCallbackProfile {
+	uint32_t id;
+	const char* callback;
+	uint64_t calls;
+	uint64_t usec;
+	uint64_t deferred;
+};
+
+typedef void (*mScriptProfileHandler)(const char* function, uint64_t samples, void* user);
+
+// Where watched memory comes from. If stores are tracked, ranges that
+// haven't been stored to since the previous check are skipped unread.
+struct mScriptWatchSource {
+	void* user;
+	bool (*read)(void* user, struct mScriptValue* domain, uint32_t address, uint32_t length, uint8_t* out);
+
+	// Optional: stamp stores since the last collection, returning the epoch
+	uint32_t (*collectStores)(void* user);
+	bool (*storedSince)(void* user, struct mScriptValue* domain, uint32_t address, uint32_t length, uint32_t epoch);
+};
+
 struct mScriptContext {
 	struct Table rootScope;
 	struct Table engines;
@@ -34,9 +87,21 @@ struct mScriptContext {
 	struct Table callbacks;
 	struct Table callbackId;
 	uint32_t nextCallbackId;
+	struct mScriptWatchList watches;
+	bool watchesDirty;
+	uint32_t watchEpoch;
+	bool profiling;
+	uint64_t frameBudget;
+	uint64_t frameBudgetUsed;
+	bool frameBudgetDefer;
+	bool frameBudgetWarned;
 	struct mScriptValue* constants;
 	struct Table docstrings;
 	int threadDepth;
+	struct mScriptPool pool;
+	// Set while the core runs frames that will be thrown away again, such as
+	// the ones run ahead. No callbacks or watches fire while it's set.
+	bool speculative;
 };
 
 struct mScriptEngine2 {
@@ -64,6 +129,10 @@ struct mScriptEngineContext {
 	bool (*run)(struct mScriptEngineContext*);
 	const char* (*getError)(struct mScriptEngineContext*);
 
+	// Optional: sample which functions are running while profiling is enabled
+	void (*setProfiling)(struct mScriptEngineContext*, bool enable);
+	void (*enumerateProfile)(struct mScriptEngineContext*, mScriptProfileHandler handler, void* user);
+
 	struct Table docroot;
 };
 
@@ -99,6 +168,29 @@ void mScriptContextTriggerCallback(struct mScriptContext*, const char* callback,
 uint32_t mScriptContextAddCallback(struct mScriptContext*, const char* callback, struct mScriptValue* value);
 uint32_t mScriptContextAddOneshot(struct mScriptContext*, const char* callback, struct mScriptValue* value);
 void mScriptContextRemoveCallback(struct mScriptContext*, uint32_t cbid);
+bool mScriptContextGetCallbackStats(struct mScriptContext*, const char* callback, struct mScriptCallbackStats* stats);
+void mScriptContextEnumerateCallbackStats(struct mScriptContext*, void (*handler)(const char* callback, const struct mScriptCallbackStats*, void* user), void* user);
+
+// Profiling times every callback individually and lets engines sample
+// the functions they run. Enabling it again clears the previous results.
+void mScriptContextSetProfiling(struct mScriptContext*, bool enable);
+void mScriptContextEnumerateCallbackProfiles(struct mScriptContext*, void (*handler)(const struct mScriptCallbackProfile*, void* user), void* user);
+void mScriptContextEnumerateFunctionProfiles(struct mScriptContext*, mScriptProfileHandler handler, void* user);
+
+// Once callbacks have taken more than the budget within a frame, a warning
+// is logged, and if deferring, the remaining callbacks without arguments are
+// skipped. The next trigger starts with the first one skipped, and always
+// runs at least one callback. A budget of 0 disables it.
+void mScriptContextSetFrameBudget(struct mScriptContext*, uint64_t usec, bool defer);
+void mScriptContextStartFrame(struct mScriptContext*);
+
+// Watches share ids with callbacks, so they are removed the same way
+uint32_t mScriptContextAddWatch(struct mScriptContext*, struct mScriptValue* domain, uint32_t address, uint32_t length, struct mScriptValue* fn);
+// Reads every watched range that was stored to once, merging overlapping
+// and adjacent watches on the same domain, then calls each watch whose range
+// changed. The first check after adding a watch only records its contents.
+// Watches deferred by the frame budget are called on a later check.
+void mScriptContextCheckWatches(struct mScriptContext*, const struct mScriptWatchSource*);
 
 void mScriptContextSetDocstring(struct mScriptContext*, const char* key, const char* docstring);
 const char* mScriptContextGetDocstring(struct mScriptContext*, const char* key);
@@ -117,6 +209,12 @@ struct mScriptContext* mScriptActiveContext(void);
 bool mScriptContextActivate(struct mScriptContext*);
 void mScriptContextDeactivate(struct mScriptContext*);
 
+// Allocations made while a context is active on this thread reuse blocks
+// from its pool. Blocks of the same size are interchangeable, so they can be
+// freed from any context, or none at all.
+void* mScriptPoolAlloc(size_t size);
+void mScriptPoolFree(void* block, size_t size);
+
 bool mScriptContextInvoke(struct mScriptContext*, const struct mScriptValue* fn, struct mScriptFrame* frame);
 
 bool mScriptInvoke(const struct mScriptValue* fn, struct mScriptFrame* frame);
@@ -22,6 +22,7 @@ bool mScriptStorageSaveBucketVF(struct mScriptContext* context, const char* buck
 bool mScriptStorageLoadBucket(struct mScriptContext* context, const char* bucket);
 bool mScriptStorageLoadBucketVF(struct mScriptContext* context, const char* bucket, struct VFile* vf);
 void mScriptStorageGetBucketPath(const char* bucket, char* out);
+void mScriptStorageGetBucketBinaryPath(const char* bucket, char* out);
 
 CXX_GUARD_END
 
@@ -263,6 +263,7 @@ struct mScriptClassMember {
 	const struct mScriptFunctionOverload* overloads;
 	size_t offset;
 	bool readonly;
+	size_t slot;
 };
 
 struct mScriptClassCastMember {
@@ -293,6 +294,10 @@ struct mScriptTypeClass {
 	struct mScriptClassMember* alloc; // TODO
 	struct mScriptClassMember* free;
 	struct mScriptClassMember* get;
+
+	// Instance members by index, so lookups can be resolved once and reused
+	struct mScriptClassMember** slots;
+	size_t nSlots;
 };
 
 struct mScriptType {
@@ -376,6 +381,8 @@ void mScriptClassInit(struct mScriptTypeClass* cls);
 void mScriptClassDeinit(struct mScriptTypeClass* cls);
 
 bool mScriptObjectGet(struct mScriptValue* obj, const char* member, struct mScriptValue*);
+int mScriptClassGetSlot(struct mScriptTypeClass* cls, const char* member);
+bool mScriptObjectGetSlot(struct mScriptValue* obj, int slot, struct mScriptValue*);
 bool mScriptObjectGetConst(const struct mScriptValue* obj, const char* member, struct mScriptValue*);
 bool mScriptObjectSet(struct mScriptValue* obj, const char* member, struct mScriptValue*);
 bool mScriptObjectCast(const struct mScriptValue* input, const struct mScriptType* type, struct mScriptValue* output) ;
@@ -4,6 +4,15 @@
 -- Frame counter for periodic updates (every second at 60 FPS)
 local frameCount = 0
 
+-- Offsets and widths of the fields read from SaveBlock1
+local saveBlock1Layout = {
+    x = { 0x00, 2 },
+    y = { 0x02, 2 },
+    mapGroup = 0x04,
+    mapNum = 0x05,
+    warpId = 0x06,
+}
+
 -- Callback on each frame
 callbacks:add("frame", function()
     frameCount = frameCount + 1
@@ -38,16 +47,13 @@ callbacks:add("frame", function()
         
         local saveBlock1Base = 0x02000000 + saveBlock1Offset
         
-        -- Read player position (at offset 0x00 in SaveBlock1)
-        local posX = emu:read16(saveBlock1Base + 0x00)
-        local posY = emu:read16(saveBlock1Base + 0x02)
-
-        -- Read map info (at offset 0x04 in SaveBlock1)
-        local mapGroup = emu:read8(saveBlock1Base + 0x04)
-        local mapNum = emu:read8(saveBlock1Base + 0x05)
-
-        -- Read warp ID (at offset 0x06 in SaveBlock1)
-        local warpId = emu:read8(saveBlock1Base + 0x06)
+        -- Read player position, map info and warp ID from the start of SaveBlock1
+        local location = emu:readStruct(saveBlock1Base, saveBlock1Layout)
+        local posX = location.x
+        local posY = location.y
+        local mapGroup = location.mapGroup
+        local mapNum = location.mapNum
+        local warpId = location.warpId
 
         -- Check if in battle (gBattleMons address)
         local battleData = emu:read32(0x02024084)
@@ -6,11 +6,17 @@
 #include <mgba/core/rewind.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
-#include <mgba-util/patch/fast.h>
 #include <mgba-util/vfs.h>
 
-DEFINE_VECTOR(mCoreRewindPatches, struct PatchFast);
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+mLOG_DEFINE_CATEGORY(REWIND, "Rewind", "core.rewind");
+
+DEFINE_VECTOR(mCoreRewindEntries, struct mCoreRewindEntry);
 
 static void _rewindDiff(struct mCoreRewindContext* context);
 
@@ -18,18 +24,121 @@ static void _rewindDiff(struct mCoreRewindContext* context);
 THREAD_ENTRY _rewindThread(void* context);
 #endif
 
-void mCoreRewindContextInit(struct mCoreRewindContext* context, size_t entries, bool onThread) {
-	if (context->currentState) {
+static void* _pack(const void* data, size_t size, size_t* packedSize) {
+	void* packed;
+#ifdef USE_ZLIB
+	uLongf bound = compressBound(size);
+	packed = malloc(bound);
+	if (packed && compress2(packed, &bound, data, size, Z_BEST_SPEED) == Z_OK && bound < size) {
+		*packedSize = bound;
+		return realloc(packed, bound);
+	}
+	free(packed);
+#endif
+	// Data that doesn't shrink is stored as-is, which _unpack detects by size
+	packed = malloc(size);
+	if (!packed) {
+		*packedSize = 0;
+		return NULL;
+	}
+	memcpy(packed, data, size);
+	*packedSize = size;
+	return packed;
+}
+
+static bool _unpack(const void* packed, size_t packedSize, void* data, size_t size) {
+	if (packedSize == size) {
+		memcpy(data, packed, size);
+		return true;
+	}
+#ifdef USE_ZLIB
+	uLongf outSize = size;
+	return uncompress(data, &outSize, packed, packedSize) == Z_OK && outSize == size;
+#else
+	return false;
+#endif
+}
+
+static void* _scratch(struct mCoreRewindContext* context, size_t size) {
+	if (size > context->scratchSize) {
+		free(context->scratch);
+		context->scratch = malloc(size);
+		context->scratchSize = context->scratch ? size : 0;
+	}
+	return context->scratch;
+}
+
+static void _extend(struct VFile* vf, size_t size) {
+	size_t oldSize = vf->size(vf);
+	if (size <= oldSize) {
 		return;
 	}
-	mCoreRewindPatchesInit(&context->patchMemory, entries);
+	// Growing a memory chunk can expose stale bytes, but diffs rely on the tail being zero
+	vf->truncate(vf, size);
+	uint8_t* mem = vf->map(vf, size, MAP_WRITE);
+	memset(&mem[oldSize], 0, size - oldSize);
+	vf->unmap(vf, mem, size);
+}
+
+static inline struct mCoreRewindEntry* _entry(struct mCoreRewindContext* context, size_t stepsBack) {
+	size_t capacity = mCoreRewindEntriesSize(&context->entries);
+	return mCoreRewindEntriesGetPointer(&context->entries, (context->current + capacity - stepsBack) % capacity);
+}
+
+static void _dropDiff(struct mCoreRewindContext* context, struct mCoreRewindEntry* entry) {
+	context->usage -= entry->diffSize;
+	free(entry->diff);
+	entry->diff = NULL;
+	entry->diffSize = 0;
+	entry->diffRawSize = 0;
+}
+
+static void _freeEntry(struct mCoreRewindContext* context, struct mCoreRewindEntry* entry) {
+	context->usage -= entry->diffSize + entry->keyframeSize;
+	free(entry->diff);
+	free(entry->keyframe);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static void _evictOldest(struct mCoreRewindContext* context) {
+	_freeEntry(context, _entry(context, context->size - 1));
+	--context->size;
+	if (context->size) {
+		// Nothing can be restored past the oldest entry, so its diff is dead weight
+		_dropDiff(context, _entry(context, context->size - 1));
+	}
+}
+
+static void _clearEntries(struct mCoreRewindContext* context) {
 	size_t e;
-	for (e = 0; e < entries; ++e) {
-		initPatchFast(mCoreRewindPatchesAppend(&context->patchMemory));
+	for (e = 0; e < mCoreRewindEntriesSize(&context->entries); ++e) {
+		_freeEntry(context, mCoreRewindEntriesGetPointer(&context->entries, e));
 	}
+	context->size = 0;
+	context->usage = 0;
+	context->sinceKeyframe = 0;
+}
+
+void mCoreRewindContextInit(struct mCoreRewindContext* context, size_t entries, bool onThread) {
+	if (context->currentState) {
+		return;
+	}
+	mCoreRewindEntriesInit(&context->entries, entries);
+	mCoreRewindEntriesResize(&context->entries, entries);
+	memset(mCoreRewindEntriesGetPointer(&context->entries, 0), 0, entries * sizeof(struct mCoreRewindEntry));
+	initPatchFast(&context->patch);
+	context->scratch = NULL;
+	context->scratchSize = 0;
 	context->previousState = VFileMemChunk(0, 0);
 	context->currentState = VFileMemChunk(0, 0);
+	mStateIncrementalInit(&context->previousIncremental);
+	mStateIncrementalInit(&context->currentIncremental);
+	context->current = 0;
 	context->size = 0;
+	context->budget = 0;
+	context->usage = 0;
+	context->keyframeInterval = mREWIND_KEYFRAME_INTERVAL;
+	context->sinceKeyframe = 0;
 	context->rewindFrameCounter = 0;
 #ifndef DISABLE_THREADING
 	context->onThread = onThread;
@@ -63,11 +172,28 @@ void mCoreRewindContextDeinit(struct mCoreRewindContext* context) {
 	context->currentState->close(context->currentState);
 	context->previousState = NULL;
 	context->currentState = NULL;
-	size_t s;
-	for (s = 0; s < mCoreRewindPatchesSize(&context->patchMemory); ++s) {
-		deinitPatchFast(mCoreRewindPatchesGetPointer(&context->patchMemory, s));
+	mStateIncrementalDeinit(&context->previousIncremental);
+	mStateIncrementalDeinit(&context->currentIncremental);
+	_clearEntries(context);
+	mCoreRewindEntriesDeinit(&context->entries);
+	deinitPatchFast(&context->patch);
+	free(context->scratch);
+	context->scratch = NULL;
+	context->scratchSize = 0;
+}
+
+void mCoreRewindContextSetBudget(struct mCoreRewindContext* context, size_t bytes) {
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		MutexLock(&context->mutex);
+	}
+#endif
+	context->budget = bytes;
+#ifndef DISABLE_THREADING
+	if (context->onThread) {
+		MutexUnlock(&context->mutex);
 	}
-	mCoreRewindPatchesDeinit(&context->patchMemory);
+#endif
 }
 
 void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
@@ -75,11 +201,17 @@ void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
 	if (context->onThread) {
 		MutexLock(&context->mutex);
 	}
+	if (context->ready) {
+		_rewindDiff(context);
+	}
 #endif
 	struct VFile* nextState = context->previousState;
-	mCoreSaveStateNamed(core, nextState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	struct mStateIncremental nextIncremental = context->previousIncremental;
+	mCoreSaveStateIncremental(core, nextState, SAVESTATE_SAVEDATA | SAVESTATE_RTC, &nextIncremental);
 	context->previousState = context->currentState;
+	context->previousIncremental = context->currentIncremental;
 	context->currentState = nextState;
+	context->currentIncremental = nextIncremental;
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		context->ready = true;
@@ -91,28 +223,157 @@ void mCoreRewindAppend(struct mCoreRewindContext* context, struct mCore* core) {
 	_rewindDiff(context);
 }
 
+static bool _packKeyframe(struct VFile* vf, struct mCoreRewindEntry* entry) {
+	void* state = vf->map(vf, entry->stateSize, MAP_READ);
+	entry->keyframe = _pack(state, entry->stateSize, &entry->keyframeSize);
+	vf->unmap(vf, state, entry->stateSize);
+	return entry->keyframe;
+}
+
+// Returns false if the diff couldn't be stored, in which case the previous
+// state can't be reached from this entry
+static bool _packDiff(struct mCoreRewindContext* context, struct mCoreRewindEntry* entry, size_t previousSize) {
+	size_t size = entry->stateSize;
+	if (previousSize > size) {
+		size = previousSize;
+	}
+	_extend(context->previousState, size);
+	_extend(context->currentState, size);
+	void* previous = context->previousState->map(context->previousState, size, MAP_READ);
+	void* current = context->currentState->map(context->currentState, size, MAP_READ);
+
+	// Pages the core didn't rewrite are identical in both states, so only
+	// the rewritten pages and everything past the last page need diffing
+	const struct mStateIncremental* incremental = &context->currentIncremental;
+	struct PatchFast* patch = &context->patch;
+	PatchFastExtentsClear(&patch->extents);
+	size_t page = 0;
+	while (page < incremental->nPages) {
+		if (!(incremental->changedPages[page >> 5] & (1U << (page & 31))) && page + 1 < incremental->nPages) {
+			++page;
+			continue;
+		}
+		size_t start = page << mSTATE_PAGE_SHIFT;
+		for (++page; page < incremental->nPages; ++page) {
+			if (!(incremental->changedPages[page >> 5] & (1U << (page & 31))) && page + 1 < incremental->nPages) {
+				break;
+			}
+		}
+		size_t end = page < incremental->nPages ? page << mSTATE_PAGE_SHIFT : size;
+		diffPatchFastRange(patch, current, previous, start, end - start);
+	}
+	if (!incremental->nPages) {
+		diffPatchFast(patch, current, previous, size);
+	}
+	context->previousState->unmap(context->previousState, previous, size);
+	context->currentState->unmap(context->currentState, current, size);
+	context->previousState->truncate(context->previousState, previousSize);
+	context->currentState->truncate(context->currentState, entry->stateSize);
+
+	// Flatten the extents to (offset, length, XOR bytes) records before packing
+	size_t rawSize = 0;
+	size_t e;
+	for (e = 0; e < PatchFastExtentsSize(&patch->extents); ++e) {
+		rawSize += 8 + PatchFastExtentsGetPointer(&patch->extents, e)->length;
+	}
+	if (!rawSize) {
+		return true;
+	}
+	uint8_t* raw = _scratch(context, rawSize);
+	if (!raw) {
+		return false;
+	}
+	for (e = 0; e < PatchFastExtentsSize(&patch->extents); ++e) {
+		const struct PatchFastExtent* extent = PatchFastExtentsGetConstPointer(&patch->extents, e);
+		STORE_32LE(extent->offset, 0, raw);
+		STORE_32LE(extent->length, 4, raw);
+		memcpy(&raw[8], extent->extent, extent->length);
+		raw += 8 + extent->length;
+	}
+	entry->diff = _pack(context->scratch, rawSize, &entry->diffSize);
+	if (!entry->diff) {
+		return false;
+	}
+	entry->diffRawSize = rawSize;
+	return true;
+}
+
+static bool _applyDiff(struct mCoreRewindContext* context, const struct mCoreRewindEntry* entry, size_t previousSize) {
+	size_t size = entry->stateSize;
+	if (previousSize > size) {
+		size = previousSize;
+	}
+	struct VFile* vf = context->currentState;
+	_extend(vf, size);
+	if (entry->diffRawSize) {
+		const uint8_t* raw = _scratch(context, entry->diffRawSize);
+		if (!raw || !_unpack(entry->diff, entry->diffSize, context->scratch, entry->diffRawSize)) {
+			return false;
+		}
+		const uint8_t* end = &raw[entry->diffRawSize];
+		uint8_t* state = vf->map(vf, size, MAP_WRITE);
+		while (raw + 8 <= end) {
+			uint32_t offset;
+			uint32_t length;
+			LOAD_32LE(offset, 0, raw);
+			LOAD_32LE(length, 4, raw);
+			raw += 8;
+			if (offset + (size_t) length > size || raw + length > end) {
+				vf->unmap(vf, state, size);
+				return false;
+			}
+			size_t i;
+			for (i = 0; i < length; ++i) {
+				state[offset + i] ^= raw[i];
+			}
+			raw += length;
+		}
+		vf->unmap(vf, state, size);
+	}
+	vf->truncate(vf, previousSize);
+	return true;
+}
+
 void _rewindDiff(struct mCoreRewindContext* context) {
-	++context->current;
-	if (context->size < mCoreRewindPatchesSize(&context->patchMemory)) {
-		++context->size;
+	size_t capacity = mCoreRewindEntriesSize(&context->entries);
+	if (context->size == capacity) {
+		_evictOldest(context);
+	}
+	context->current = (context->current + 1) % capacity;
+	struct mCoreRewindEntry* entry = _entry(context, 0);
+	entry->stateSize = context->currentState->size(context->currentState);
+	if (context->size && !_packDiff(context, entry, _entry(context, 1)->stateSize)) {
+		// An empty diff would read as "nothing changed", so make the previous
+		// state reachable on its own instead, or forget everything before it
+		struct mCoreRewindEntry* previous = _entry(context, 1);
+		mLOG(REWIND, WARN, "Could not store rewind diff");
+		if (!previous->keyframe) {
+			if (_packKeyframe(context->previousState, previous)) {
+				context->usage += previous->keyframeSize;
+			} else {
+				mLOG(REWIND, ERROR, "Could not store rewind keyframe, dropping older rewind history");
+				size_t i;
+				for (i = 1; i <= context->size; ++i) {
+					_freeEntry(context, _entry(context, i));
+				}
+				context->size = 0;
+			}
+		}
+		context->sinceKeyframe = 0;
 	}
-	if (context->current >= mCoreRewindPatchesSize(&context->patchMemory)) {
-		context->current = 0;
+
+	// Periodic keyframes bound how many diffs a long seek has to walk through
+	++context->sinceKeyframe;
+	if (context->sinceKeyframe >= context->keyframeInterval) {
+		_packKeyframe(context->currentState, entry);
+		context->sinceKeyframe = 0;
 	}
-	struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-	size_t size2 = context->currentState->size(context->currentState);
-	size_t size = context->previousState->size(context->previousState);
-	if (size2 > size) {
-		context->previousState->truncate(context->previousState, size2);
-		size = size2;
-	} else if (size > size2) {
-		context->currentState->truncate(context->currentState, size);
+	context->usage += entry->diffSize + entry->keyframeSize;
+	++context->size;
+
+	while (context->budget && context->usage > context->budget && context->size > 1) {
+		_evictOldest(context);
 	}
-	void* current = context->previousState->map(context->previousState, size, MAP_READ);
-	void* next = context->currentState->map(context->currentState, size, MAP_READ);
-	diffPatchFast(patch, current, next, size);
-	context->previousState->unmap(context->previousState, current, size);
-	context->currentState->unmap(context->currentState, next, size);
 }
 
 bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core, unsigned count) {
@@ -120,6 +381,11 @@ bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core,
 	if (context->onThread) {
 		MutexLock(&context->mutex);
 	}
+	if (context->ready) {
+		// The newest state hasn't been diffed yet; do it now so the entries line up
+		_rewindDiff(context);
+		context->ready = false;
+	}
 #endif
 	if (!context->size) {
 #ifndef DISABLE_THREADING
@@ -130,39 +396,70 @@ bool mCoreRewindRestore(struct mCoreRewindContext* context, struct mCore* core,
 		return false;
 	}
 
-	for (; count && context->size; --count, --context->size) {
-		if (context->current == 0) {
-			context->current = mCoreRewindPatchesSize(&context->patchMemory);
-		}
-		--context->current;
-
-		if (context->size > 1) {
-			struct PatchFast* patch = mCoreRewindPatchesGetPointer(&context->patchMemory, context->current);
-			size_t size2 = context->previousState->size(context->previousState);
-			size_t size = context->currentState->size(context->currentState);
-			if (size2 < size) {
-				size = size2;
-			}
-			void* current = context->currentState->map(context->currentState, size, MAP_READ);
-			void* previous = context->previousState->map(context->previousState, size, MAP_WRITE);
-			patch->d.applyPatch(&patch->d, previous, size, current, size);
-			context->currentState->unmap(context->currentState, current, size);
-			context->previousState->unmap(context->previousState, previous, size);
+	size_t steps = count;
+	if (steps >= context->size) {
+		steps = context->size - 1;
+	}
+
+	// Start from the keyframe nearest the target, if there is one, so that
+	// at most one keyframe and fewer than keyframeInterval diffs are applied
+	size_t start = 0;
+	size_t i;
+	for (i = steps; i > 0; --i) {
+		if (_entry(context, i)->keyframe) {
+			start = i;
+			break;
 		}
-		struct VFile* nextState = context->previousState;
-		context->previousState = context->currentState;
-		context->currentState = nextState;
+	}
+	bool success = true;
+	if (start) {
+		const struct mCoreRewindEntry* keyframe = _entry(context, start);
+		context->currentState->truncate(context->currentState, keyframe->stateSize);
+		void* state = context->currentState->map(context->currentState, keyframe->stateSize, MAP_WRITE);
+		success = _unpack(keyframe->keyframe, keyframe->keyframeSize, state, keyframe->stateSize);
+		context->currentState->unmap(context->currentState, state, keyframe->stateSize);
+	}
+	for (i = start; success && i < steps; ++i) {
+		success = _applyDiff(context, _entry(context, i), _entry(context, i + 1)->stateSize);
 	}
 
-	mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	for (i = 0; i < steps; ++i) {
+		_freeEntry(context, _entry(context, i));
+	}
+	size_t capacity = mCoreRewindEntriesSize(&context->entries);
+	context->current = (context->current + capacity - steps) % capacity;
+	context->size -= steps;
+	context->sinceKeyframe = 0;
+	for (i = 0; i < context->size && !_entry(context, i)->keyframe; ++i) {
+		++context->sinceKeyframe;
+	}
+	mStateIncrementalInvalidate(&context->previousIncremental);
+	mStateIncrementalInvalidate(&context->currentIncremental);
 
+	if (success) {
+		mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
+	} else {
+		// The working state can't be trusted anymore, so nothing else can be either
+		_clearEntries(context);
+	}
 
 #ifndef DISABLE_THREADING
 	if (context->onThread) {
 		MutexUnlock(&context->mutex);
 	}
 #endif
-	return true;
+	return success;
+}
+
+bool mCoreRewindSeek(struct mCoreRewindContext* context, struct mCore* core, unsigned count) {
+	// Only the target state is ever loaded, so the only frame drawn is the one after it
+	if (!mCoreRewindRestore(context, core, count)) {
+		return false;
+	}
+	context->seeking = true;
+	core->runFrame(core);
+	context->seeking = false;
+	return mCoreLoadStateNamed(core, context->currentState, SAVESTATE_SAVEDATA | SAVESTATE_RTC);
 }
 
 #ifndef DISABLE_THREADING
@@ -183,4 +480,3 @@ THREAD_ENTRY _rewindThread(void* context) {
 	THREAD_EXIT(0);
 }
 #endif
-
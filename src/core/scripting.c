@@ -7,6 +7,8 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/state-journal.h>
+#include <mgba/core/state-tree.h>
 #ifdef M_CORE_GBA
 #include <mgba/gba/interface.h>
 #endif
@@ -206,8 +208,16 @@ struct mScriptCoreAdapter {
 	struct mScriptValue* luminanceCb;
 	struct GBALuminanceSource* oldLuminance;
 #endif
+	struct VFile* snapshot;
+	struct mStateIncremental snapshotIncremental;
+	struct mStateTree* checkpoints;
+	struct mStateJournal* journal;
+	struct mScriptValue* frameView;
 };
 
+// Large enough to hold the biggest memory domain (a full GBA ROM)
+#define SCRIPT_MEMORY_BUFFER_MAX 0x02000000
+
 #define CALCULATE_SEGMENT_INFO \
 	uint32_t segmentSize = adapter->block.end - adapter->block.start; \
 	uint32_t segmentStart = adapter->block.segmentStart - adapter->block.start; \
@@ -223,6 +233,164 @@ struct mScriptCoreAdapter {
 		segmentAddress += segmentStart; \
 	}
 
+struct mScriptMemoryBuffer {
+	uint8_t* data;
+	uint32_t size;
+};
+
+mSCRIPT_DECLARE_STRUCT(mScriptMemoryBuffer);
+
+typedef uint32_t (*mScriptMemoryReader)(void* source, uint32_t address, uint32_t width);
+
+static bool _mScriptCastU32(const struct mScriptValue* value, uint32_t* out) {
+	struct mScriptValue cast;
+	if (value->type->base == mSCRIPT_TYPE_WRAPPER) {
+		value = mScriptValueUnwrapConst(value);
+	}
+	if (!mScriptCast(mSCRIPT_TYPE_MS_U32, value, &cast)) {
+		return false;
+	}
+	*out = cast.value.u32;
+	return true;
+}
+
+// A read is either an address, which reads one byte, or a list of an address and a width
+static bool _mScriptParseRead(const struct mScriptValue* spec, uint32_t* address, uint32_t* width) {
+	if (spec->type->base == mSCRIPT_TYPE_WRAPPER) {
+		spec = mScriptValueUnwrapConst(spec);
+	}
+	*width = 1;
+	if (spec->type != mSCRIPT_TYPE_MS_LIST) {
+		return _mScriptCastU32(spec, address);
+	}
+	const struct mScriptList* list = spec->value.list;
+	size_t size = mScriptListSize(list);
+	if (size < 1 || size > 2) {
+		return false;
+	}
+	if (!_mScriptCastU32(mScriptListGetConstPointer(list, 0), address)) {
+		return false;
+	}
+	if (size == 2 && !_mScriptCastU32(mScriptListGetConstPointer(list, 1), width)) {
+		return false;
+	}
+	return *width == 1 || *width == 2 || *width == 4;
+}
+
+static struct mScriptValue* _mScriptReadMany(mScriptMemoryReader read, void* source, struct mScriptList* reads) {
+	struct mScriptValue* values = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	mScriptListEnsureCapacity(values->value.list, mScriptListSize(reads));
+	size_t i;
+	for (i = 0; i < mScriptListSize(reads); ++i) {
+		uint32_t address;
+		uint32_t width;
+		if (!_mScriptParseRead(mScriptListGetPointer(reads, i), &address, &width)) {
+			mScriptValueDeref(values);
+			return NULL;
+		}
+		*mScriptListAppend(values->value.list) = mSCRIPT_MAKE_U32(read(source, address, width));
+	}
+	return values;
+}
+
+static struct mScriptValue* _mScriptReadStruct(mScriptMemoryReader read, void* source, uint32_t address, struct mScriptValue* layout) {
+	if (layout->type->base == mSCRIPT_TYPE_WRAPPER) {
+		layout = mScriptValueUnwrap(layout);
+	}
+	if (!layout || layout->type != mSCRIPT_TYPE_MS_TABLE) {
+		return NULL;
+	}
+	struct mScriptValue* values = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	struct TableIterator iter;
+	if (!mScriptTableIteratorStart(layout, &iter)) {
+		return values;
+	}
+	do {
+		uint32_t offset;
+		uint32_t width;
+		if (!_mScriptParseRead(mScriptTableIteratorGetValue(layout, &iter), &offset, &width)) {
+			mScriptValueDeref(values);
+			return NULL;
+		}
+		struct mScriptValue* value = mScriptValueCreateFromUInt(read(source, address + offset, width));
+		mScriptTableInsert(values, mScriptTableIteratorGetKey(layout, &iter), value);
+		mScriptValueDeref(value);
+	} while (mScriptTableIteratorNext(layout, &iter));
+	return values;
+}
+
+static struct mScriptValue* _mScriptMemoryBufferCreate(uint32_t size) {
+	if (size > SCRIPT_MEMORY_BUFFER_MAX) {
+		return NULL;
+	}
+	// The data lives in the same allocation, so freeing the buffer frees both
+	struct mScriptMemoryBuffer* buffer = calloc(1, sizeof(*buffer) + size);
+	if (!buffer) {
+		return NULL;
+	}
+	buffer->data = (uint8_t*) &buffer[1];
+	buffer->size = size;
+
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptMemoryBuffer));
+	value->value.opaque = buffer;
+	value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+	return value;
+}
+
+static uint32_t mScriptMemoryBufferRead8(const struct mScriptMemoryBuffer* buffer, uint32_t offset) {
+	if (offset >= buffer->size) {
+		return 0;
+	}
+	return buffer->data[offset];
+}
+
+static uint32_t mScriptMemoryBufferRead16(const struct mScriptMemoryBuffer* buffer, uint32_t offset) {
+	if (buffer->size < 2 || offset > buffer->size - 2) {
+		return 0;
+	}
+	return buffer->data[offset] | (buffer->data[offset + 1] << 8);
+}
+
+static uint32_t mScriptMemoryBufferRead32(const struct mScriptMemoryBuffer* buffer, uint32_t offset) {
+	if (buffer->size < 4 || offset > buffer->size - 4) {
+		return 0;
+	}
+	const uint8_t* data = &buffer->data[offset];
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24);
+}
+
+static uint32_t mScriptMemoryBufferSize(const struct mScriptMemoryBuffer* buffer) {
+	return buffer->size;
+}
+
+static struct mScriptValue* mScriptMemoryBufferToString(const struct mScriptMemoryBuffer* buffer) {
+	return mScriptStringCreateFromBytes(buffer->data, buffer->size);
+}
+
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryBuffer, U32, read8, mScriptMemoryBufferRead8, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryBuffer, U32, read16, mScriptMemoryBufferRead16, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryBuffer, U32, read32, mScriptMemoryBufferRead32, 1, U32, offset);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryBuffer, U32, size, mScriptMemoryBufferSize, 0);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptMemoryBuffer, WSTR, toString, mScriptMemoryBufferToString, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptMemoryBuffer)
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"A fixed-size byte buffer that can be refilled from memory with struct::mCore.readInto or "
+		"struct::mScriptMemoryDomain.readInto without allocating anything. Multi-byte reads are little endian, "
+		"and reads past the end of the buffer return 0."
+	)
+	mSCRIPT_DEFINE_DOCSTRING("Read an 8-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryBuffer, read8)
+	mSCRIPT_DEFINE_DOCSTRING("Read a 16-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryBuffer, read16)
+	mSCRIPT_DEFINE_DOCSTRING("Read a 32-bit value from the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryBuffer, read32)
+	mSCRIPT_DEFINE_DOCSTRING("Get the size of this buffer in bytes")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryBuffer, size)
+	mSCRIPT_DEFINE_DOCSTRING("Copy the contents of this buffer into a string")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryBuffer, toString)
+mSCRIPT_DEFINE_END;
+
 static uint32_t mScriptMemoryDomainRead8(struct mScriptMemoryDomain* adapter, uint32_t address) {
 	CALCULATE_SEGMENT_INFO;
 	CALCULATE_SEGMENT_ADDRESS;
@@ -253,6 +421,34 @@ static struct mScriptValue* mScriptMemoryDomainReadRange(struct mScriptMemoryDom
 	return value;
 }
 
+static uint32_t _mScriptMemoryDomainReadWidth(void* source, uint32_t address, uint32_t width) {
+	switch (width) {
+	case 1:
+		return mScriptMemoryDomainRead8(source, address);
+	case 2:
+		return mScriptMemoryDomainRead16(source, address);
+	default:
+		return mScriptMemoryDomainRead32(source, address);
+	}
+}
+
+static struct mScriptValue* mScriptMemoryDomainReadMany(struct mScriptMemoryDomain* adapter, struct mScriptList* reads) {
+	return _mScriptReadMany(_mScriptMemoryDomainReadWidth, adapter, reads);
+}
+
+static struct mScriptValue* mScriptMemoryDomainReadStruct(struct mScriptMemoryDomain* adapter, uint32_t address, struct mScriptValue* layout) {
+	return _mScriptReadStruct(_mScriptMemoryDomainReadWidth, adapter, address, layout);
+}
+
+static void mScriptMemoryDomainReadInto(struct mScriptMemoryDomain* adapter, struct mScriptMemoryBuffer* buffer, uint32_t address) {
+	CALCULATE_SEGMENT_INFO;
+	uint32_t i;
+	for (i = 0; i < buffer->size; ++i, ++address) {
+		CALCULATE_SEGMENT_ADDRESS;
+		buffer->data[i] = adapter->core->rawRead8(adapter->core, segmentAddress, segment);
+	}
+}
+
 static void mScriptMemoryDomainWrite8(struct mScriptMemoryDomain* adapter, uint32_t address, uint8_t value) {
 	CALCULATE_SEGMENT_INFO;
 	CALCULATE_SEGMENT_ADDRESS;
@@ -292,6 +488,9 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read8, mScriptMemoryDoma
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read16, mScriptMemoryDomainRead16, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read32, mScriptMemoryDomainRead32, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WSTR, readRange, mScriptMemoryDomainReadRange, 2, U32, address, U32, length);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WLIST, readMany, mScriptMemoryDomainReadMany, 1, LIST, reads);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WTABLE, readStruct, mScriptMemoryDomainReadStruct, 2, U32, address, WTABLE, layout);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, readInto, mScriptMemoryDomainReadInto, 2, S(mScriptMemoryBuffer), buffer, U32, address);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, write8, mScriptMemoryDomainWrite8, 2, U32, address, U8, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, write16, mScriptMemoryDomainWrite16, 2, U32, address, U16, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, write32, mScriptMemoryDomainWrite32, 2, U32, address, U32, value);
@@ -314,6 +513,18 @@ mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, read32)
 	mSCRIPT_DEFINE_DOCSTRING("Read byte range from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readRange)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Read several values in one call and return them as a list in the same order. Each entry is either "
+		"an offset, which reads 8 bits, or a list of an offset and a width in bytes (1, 2 or 4)"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readMany)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Read a structure starting at the given offset. The layout is a table mapping field names to "
+		"entries as for readMany, relative to the start of the structure, and a table with the same keys is returned"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readStruct)
+	mSCRIPT_DEFINE_DOCSTRING("Fill a buffer created with struct::mCore.newBuffer starting at the given offset")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, readInto)
 	mSCRIPT_DEFINE_DOCSTRING("Write an 8-bit value from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, write8)
 	mSCRIPT_DEFINE_DOCSTRING("Write a 16-bit value from the given offset")
@@ -372,6 +583,38 @@ static struct mScriptValue* _mScriptCoreChecksum(const struct mCore* core, int t
 	return ret;
 }
 
+static uint32_t _mScriptCoreReadWidth(void* source, uint32_t address, uint32_t width) {
+	struct mCore* core = source;
+	switch (width) {
+	case 1:
+		return core->busRead8(core, address);
+	case 2:
+		return core->busRead16(core, address);
+	default:
+		return core->busRead32(core, address);
+	}
+}
+
+static struct mScriptValue* _mScriptCoreReadMany(struct mCore* core, struct mScriptList* reads) {
+	return _mScriptReadMany(_mScriptCoreReadWidth, core, reads);
+}
+
+static struct mScriptValue* _mScriptCoreReadStruct(struct mCore* core, uint32_t address, struct mScriptValue* layout) {
+	return _mScriptReadStruct(_mScriptCoreReadWidth, core, address, layout);
+}
+
+static void _mScriptCoreReadInto(struct mCore* core, struct mScriptMemoryBuffer* buffer, uint32_t address) {
+	uint32_t i;
+	for (i = 0; i < buffer->size; ++i, ++address) {
+		buffer->data[i] = core->busRead8(core, address);
+	}
+}
+
+static struct mScriptValue* _mScriptCoreNewBuffer(struct mCore* core, uint32_t size) {
+	UNUSED(core);
+	return _mScriptMemoryBufferCreate(size);
+}
+
 static void _mScriptCoreAddKey(struct mCore* core, int32_t key) {
 	core->addKeys(core, 1 << key);
 }
@@ -409,6 +652,14 @@ static void _mScriptCoreWriteRegister(struct mCore* core, const char* regName, i
 }
 
 static struct mScriptValue* _mScriptCoreSaveState(struct mCore* core, int32_t flags) {
+	if (!(flags & SAVESTATE_ALL)) {
+		struct mScriptValue* value = mScriptStringCreateEmpty(core->stateSize(core));
+		if (!mCoreSaveStateBuffer(core, value->value.string->buffer, value->value.string->size, flags)) {
+			mScriptValueDeref(value);
+			return &mScriptValueNull;
+		}
+		return value;
+	}
 	struct VFile* vf = VFileMemChunk(NULL, 0);
 	if (!mCoreSaveStateNamed(core, vf, flags)) {
 		vf->close(vf);
@@ -456,10 +707,7 @@ static void _mScriptCoreTakeScreenshot(struct mCore* core, const char* filename)
 #endif
 
 static int32_t _mScriptCoreLoadState(struct mCore* core, struct mScriptString* buffer, int32_t flags) {
-	struct VFile* vf = VFileFromConstMemory(buffer->buffer, buffer->size);
-	int ret = mCoreLoadStateNamed(core, vf, flags);
-	vf->close(vf);
-	return ret;
+	return mCoreLoadStateBuffer(core, buffer->buffer, buffer->size, flags);
 }
 
 static struct mScriptValue* _mScriptCoreTakeScreenshotToImage(struct mCore* core) {
@@ -521,6 +769,10 @@ mSCRIPT_DECLARE_STRUCT_D_METHOD(mCore, U32, busRead8, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_D_METHOD(mCore, U32, busRead16, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_D_METHOD(mCore, U32, busRead32, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WSTR, readRange, _mScriptCoreReadRange, 2, U32, address, U32, length);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WLIST, readMany, _mScriptCoreReadMany, 1, LIST, reads);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, WTABLE, readStruct, _mScriptCoreReadStruct, 2, U32, address, WTABLE, layout);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mCore, readInto, _mScriptCoreReadInto, 2, S(mScriptMemoryBuffer), buffer, U32, address);
+mSCRIPT_DECLARE_STRUCT_METHOD(mCore, W(mScriptMemoryBuffer), newBuffer, _mScriptCoreNewBuffer, 1, U32, size);
 mSCRIPT_DECLARE_STRUCT_VOID_D_METHOD(mCore, busWrite8, 2, U32, address, U8, value);
 mSCRIPT_DECLARE_STRUCT_VOID_D_METHOD(mCore, busWrite16, 2, U32, address, U16, value);
 mSCRIPT_DECLARE_STRUCT_VOID_D_METHOD(mCore, busWrite32, 2, U32, address, U32, value);
@@ -604,6 +856,22 @@ mSCRIPT_DEFINE_STRUCT(mCore)
 	mSCRIPT_DEFINE_STRUCT_METHOD_NAMED(mCore, read32, busRead32)
 	mSCRIPT_DEFINE_DOCSTRING("Read byte range from the given offset")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, readRange)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Read several values in one call and return them as a list in the same order. Each entry is either "
+		"a bus address, which reads 8 bits, or a list of a bus address and a width in bytes (1, 2 or 4)"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, readMany)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Read a structure starting at the given bus address. The layout is a table mapping field names to "
+		"entries as for readMany, relative to the start of the structure, and a table with the same keys is returned"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, readStruct)
+	mSCRIPT_DEFINE_DOCSTRING("Fill a buffer created with newBuffer starting at the given bus address")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, readInto)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Create a struct::mScriptMemoryBuffer of the given size for use with readInto. Sizes over 32 MiB return nil"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mCore, newBuffer)
 	mSCRIPT_DEFINE_DOCSTRING("Write an 8-bit value from the given bus address")
 	mSCRIPT_DEFINE_STRUCT_METHOD_NAMED(mCore, write8, busWrite8)
 	mSCRIPT_DEFINE_DOCSTRING("Write a 16-bit value from the given bus address")
@@ -693,6 +961,17 @@ static void _clearMemoryMap(struct mScriptContext* context, struct mScriptCoreAd
 	mScriptTableClear(&adapter->memory);
 }
 
+static void _clearFrameView(struct mScriptContext* context, struct mScriptCoreAdapter* adapter, bool clear) {
+	if (!adapter->frameView) {
+		return;
+	}
+	if (clear) {
+		mScriptContextClearWeakref(context, adapter->frameView->value.u32);
+	}
+	mScriptValueDeref(adapter->frameView);
+	adapter->frameView = NULL;
+}
+
 static void _rebuildMemoryMap(struct mScriptContext* context, struct mScriptCoreAdapter* adapter) {
 	_clearMemoryMap(context, adapter, true);
 
@@ -994,9 +1273,112 @@ static uint64_t _mScriptCoreAdapterCurrentCycle(struct mScriptCoreAdapter* adapt
 }
 #endif
 
+static uint32_t _mScriptCoreAdapterFrameView(struct mScriptCoreAdapter* adapter) {
+	struct mCore* core = adapter->core;
+	size_t stride;
+	const void* pixels = NULL;
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	core->getPixels(core, &pixels, &stride);
+	if (!pixels) {
+		return 0;
+	}
+
+	struct mScriptValue* value = NULL;
+	if (adapter->frameView) {
+		value = mScriptContextAccessWeakref(adapter->context, adapter->frameView);
+	}
+	if (!value) {
+		_clearFrameView(adapter->context, adapter, false);
+		// The image only points at the frontend's buffer, so it must not be destroyed like an owned image
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_CS(mImage));
+		value->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+		value->value.opaque = calloc(1, sizeof(struct mImage));
+		adapter->frameView = mScriptContextMakeWeakref(adapter->context, value);
+	}
+
+	struct mImage* image = value->value.opaque;
+	image->data = (void*) pixels;
+	image->width = width;
+	image->height = height;
+	image->stride = stride;
+	image->format = mCOLOR_NATIVE;
+	image->depth = mColorFormatBytes(mCOLOR_NATIVE);
+	return adapter->frameView->value.u32;
+}
+
+static bool _mScriptCoreAdapterCloseJournal(struct mScriptCoreAdapter* adapter) {
+	if (!adapter->journal) {
+		return false;
+	}
+	// The journal doesn't own its file, so it has to be closed separately
+	struct VFile* vf = adapter->journal->vf;
+	bool ok = mStateJournalClose(adapter->journal);
+	vf->close(vf);
+	free(adapter->journal);
+	adapter->journal = NULL;
+	return ok;
+}
+
+static bool _mScriptCoreAdapterOpenJournal(struct mScriptCoreAdapter* adapter, const char* path) {
+	_mScriptCoreAdapterCloseJournal(adapter);
+	struct VFile* vf = VFileOpen(path, O_RDWR | O_CREAT);
+	if (!vf) {
+		return false;
+	}
+	adapter->journal = malloc(sizeof(*adapter->journal));
+	if (!adapter->journal || !mStateJournalOpen(adapter->journal, vf)) {
+		free(adapter->journal);
+		adapter->journal = NULL;
+		vf->close(vf);
+		return false;
+	}
+	return true;
+}
+
+static bool _mScriptCoreAdapterAppendJournal(struct mScriptCoreAdapter* adapter, int32_t flags) {
+	if (!adapter->journal) {
+		return false;
+	}
+	return mStateJournalAppendCore(adapter->journal, adapter->core, flags);
+}
+
+static bool _mScriptCoreAdapterFlushJournal(struct mScriptCoreAdapter* adapter) {
+	if (!adapter->journal) {
+		return false;
+	}
+	return mStateJournalFlush(adapter->journal);
+}
+
+static uint32_t _mScriptCoreAdapterJournalSize(struct mScriptCoreAdapter* adapter) {
+	if (!adapter->journal) {
+		return 0;
+	}
+	return mStateJournalCount(adapter->journal);
+}
+
+static bool _mScriptCoreAdapterRestoreJournal(struct mScriptCoreAdapter* adapter, uint32_t index, int32_t flags) {
+	if (!adapter->journal) {
+		return false;
+	}
+	return mStateJournalLoad(adapter->journal, adapter->core, index, flags);
+}
+
 static void _mScriptCoreAdapterDeinit(struct mScriptCoreAdapter* adapter) {
 	_clearMemoryMap(adapter->context, adapter, false);
+	_clearFrameView(adapter->context, adapter, false);
 	adapter->memory.type->free(&adapter->memory);
+	if (adapter->snapshot) {
+		adapter->snapshot->close(adapter->snapshot);
+		adapter->snapshot = NULL;
+	}
+	mStateIncrementalDeinit(&adapter->snapshotIncremental);
+	if (adapter->checkpoints) {
+		mStateTreeDeinit(adapter->checkpoints);
+		free(adapter->checkpoints);
+		adapter->checkpoints = NULL;
+	}
+	_mScriptCoreAdapterCloseJournal(adapter);
 #ifdef ENABLE_DEBUGGERS
 	if (adapter->debugger.d.p) {
 		struct TableIterator iter;
@@ -1035,6 +1417,64 @@ static void _mScriptCoreAdapterReset(struct mScriptCoreAdapter* adapter) {
 	mScriptContextTriggerCallback(adapter->context, "reset", NULL);
 }
 
+static bool _mScriptCoreAdapterSaveStateSnapshot(struct mScriptCoreAdapter* adapter, int32_t flags) {
+	if (!adapter->snapshot) {
+		adapter->snapshot = VFileMemChunk(NULL, 0);
+	}
+	return mCoreSaveStateIncremental(adapter->core, adapter->snapshot, flags, &adapter->snapshotIncremental);
+}
+
+static bool _mScriptCoreAdapterLoadStateSnapshot(struct mScriptCoreAdapter* adapter, int32_t flags) {
+	if (!adapter->snapshot) {
+		return false;
+	}
+	adapter->snapshot->seek(adapter->snapshot, 0, SEEK_SET);
+	return mCoreLoadStateNamed(adapter->core, adapter->snapshot, flags);
+}
+
+static uint32_t _mScriptCoreAdapterCheckpoint(struct mScriptCoreAdapter* adapter, int32_t flags) {
+	if (!adapter->checkpoints) {
+		adapter->checkpoints = malloc(sizeof(*adapter->checkpoints));
+		if (!adapter->checkpoints) {
+			return 0;
+		}
+		mStateTreeInit(adapter->checkpoints);
+	}
+	return mStateTreeSave(adapter->checkpoints, adapter->core, flags);
+}
+
+static bool _mScriptCoreAdapterRestoreCheckpoint(struct mScriptCoreAdapter* adapter, uint32_t id, int32_t flags) {
+	if (!adapter->checkpoints) {
+		return false;
+	}
+	return mStateTreeLoad(adapter->checkpoints, adapter->core, id, flags);
+}
+
+static bool _mScriptCoreAdapterDropCheckpoint(struct mScriptCoreAdapter* adapter, uint32_t id) {
+	if (!adapter->checkpoints) {
+		return false;
+	}
+	return mStateTreeRemove(adapter->checkpoints, id);
+}
+
+static uint32_t _mScriptCoreAdapterCheckpointParent(struct mScriptCoreAdapter* adapter, uint32_t id) {
+	if (!adapter->checkpoints) {
+		return 0;
+	}
+	const struct mStateNode* node = mStateTreeGet(adapter->checkpoints, id);
+	if (!node) {
+		return 0;
+	}
+	return node->parent;
+}
+
+static uint64_t _mScriptCoreAdapterCheckpointMemory(struct mScriptCoreAdapter* adapter) {
+	if (!adapter->checkpoints) {
+		return 0;
+	}
+	return adapter->checkpoints->pageBytes;
+}
+
 static struct mScriptValue* _mScriptCoreAdapterSetRotationCbTable(struct mScriptCoreAdapter* adapter, struct mScriptValue* cbTable) {
 	if (cbTable) {
 		mScriptValueRef(cbTable);
@@ -1106,6 +1546,38 @@ static struct mScriptValue* _mScriptCoreAdapterReadRange(struct mScriptCoreAdapt
 	return value;
 }
 
+static struct mScriptValue* _mScriptCoreAdapterReadMany(struct mScriptCoreAdapter* adapter, struct mScriptList* reads) {
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = true;
+#endif
+	struct mScriptValue* values = _mScriptCoreReadMany(adapter->core, reads);
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = false;
+#endif
+	return values;
+}
+
+static struct mScriptValue* _mScriptCoreAdapterReadStruct(struct mScriptCoreAdapter* adapter, uint32_t address, struct mScriptValue* layout) {
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = true;
+#endif
+	struct mScriptValue* values = _mScriptCoreReadStruct(adapter->core, address, layout);
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = false;
+#endif
+	return values;
+}
+
+static void _mScriptCoreAdapterReadInto(struct mScriptCoreAdapter* adapter, struct mScriptMemoryBuffer* buffer, uint32_t address) {
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = true;
+#endif
+	_mScriptCoreReadInto(adapter->core, buffer, address);
+#ifdef ENABLE_DEBUGGERS
+	adapter->debugger.reentered = false;
+#endif
+}
+
 static void _mScriptCoreAdapterWrite8(struct mScriptCoreAdapter* adapter, uint32_t address, uint8_t value) {
 #ifdef ENABLE_DEBUGGERS
 	adapter->debugger.reentered = true;
@@ -1142,11 +1614,28 @@ mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, _deinit, _mScriptCoreAdap
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, reset, _mScriptCoreAdapterReset, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WTABLE, setRotationCallbacks, _mScriptCoreAdapterSetRotationCbTable, 1, WTABLE, cbTable);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, setSolarSensorCallback, _mScriptCoreAdapterSetLuminanceCb, 1, WRAPPER, callback);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, saveStateSnapshot, _mScriptCoreAdapterSaveStateSnapshot, 1, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, loadStateSnapshot, _mScriptCoreAdapterLoadStateSnapshot, 1, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, U32, checkpoint, _mScriptCoreAdapterCheckpoint, 1, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, restoreCheckpoint, _mScriptCoreAdapterRestoreCheckpoint, 2, U32, id, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, dropCheckpoint, _mScriptCoreAdapterDropCheckpoint, 1, U32, id);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, checkpointParent, _mScriptCoreAdapterCheckpointParent, 1, U32, id);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U64, checkpointMemory, _mScriptCoreAdapterCheckpointMemory, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, openJournal, _mScriptCoreAdapterOpenJournal, 1, CHARP, path);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, appendJournal, _mScriptCoreAdapterAppendJournal, 1, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, flushJournal, _mScriptCoreAdapterFlushJournal, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, BOOL, closeJournal, _mScriptCoreAdapterCloseJournal, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, journalSize, _mScriptCoreAdapterJournalSize, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptCoreAdapter, BOOL, restoreJournal, _mScriptCoreAdapterRestoreJournal, 2, U32, index, S32, flags);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WEAKREF, frameView, _mScriptCoreAdapterFrameView, 0);
 
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, read8, _mScriptCoreAdapterRead8, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, read16, _mScriptCoreAdapterRead16, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, U32, read32, _mScriptCoreAdapterRead32, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WSTR, readRange, _mScriptCoreAdapterReadRange, 2, U32, address, U32, length);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WLIST, readMany, _mScriptCoreAdapterReadMany, 1, LIST, reads);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCoreAdapter, WTABLE, readStruct, _mScriptCoreAdapterReadStruct, 2, U32, address, WTABLE, layout);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, readInto, _mScriptCoreAdapterReadInto, 2, S(mScriptMemoryBuffer), buffer, U32, address);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write8, _mScriptCoreAdapterWrite8, 2, U32, address, U8, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write16, _mScriptCoreAdapterWrite16, 2, U32, address, U16, value);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCoreAdapter, write32, _mScriptCoreAdapterWrite32, 2, U32, address, U32, value);
@@ -1180,6 +1669,32 @@ mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, setRangeWatchpoint)
 mSCRIPT_DEFINE_DEFAULTS_END;
 #endif
 
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, saveStateSnapshot)
+	mSCRIPT_S32(SAVESTATE_ALL)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, loadStateSnapshot)
+	mSCRIPT_S32(SAVESTATE_ALL & ~SAVESTATE_SAVEDATA)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, checkpoint)
+	mSCRIPT_S32(SAVESTATE_ALL)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, restoreCheckpoint)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_S32(SAVESTATE_ALL & ~SAVESTATE_SAVEDATA)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, appendJournal)
+	mSCRIPT_S32(SAVESTATE_ALL)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCoreAdapter, restoreJournal)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_S32(SAVESTATE_ALL & ~SAVESTATE_SAVEDATA)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
 mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
 	mSCRIPT_DEFINE_CLASS_DOCSTRING(
 		"A wrapper around a struct::mCore object that exposes more functionality. "
@@ -1210,10 +1725,61 @@ mSCRIPT_DEFINE_STRUCT(mScriptCoreAdapter)
 		"Note that the full range of values is not used by games, and the exact range depends on the calibration done by the game itself."
 	)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, setSolarSensorCallback)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Save the current state into an in-memory snapshot owned by this object. Repeated calls only rewrite "
+		"the parts of the state that changed since the last call, which makes this much cheaper than "
+		"struct::mCore.saveStateBuffer for frequent checkpoints. Only one snapshot is kept"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, saveStateSnapshot)
+	mSCRIPT_DEFINE_DOCSTRING("Load the snapshot made by the last call to saveStateSnapshot. Returns false if there is none")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, loadStateSnapshot)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Save the current state as a new checkpoint and return its ID, or 0 on failure. The new checkpoint is "
+		"a child of the checkpoint that was last saved or restored, so restoring an earlier checkpoint and "
+		"saving again starts a new branch. Memory that is identical between checkpoints is only stored once"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, checkpoint)
+	mSCRIPT_DEFINE_DOCSTRING("Load the checkpoint with the given ID. Returns false if there is no such checkpoint")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, restoreCheckpoint)
+	mSCRIPT_DEFINE_DOCSTRING("Delete a checkpoint and free any memory only it was using. Its children are moved to its parent")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, dropCheckpoint)
+	mSCRIPT_DEFINE_DOCSTRING("Get the ID of the parent of a checkpoint, or 0 if it has none")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, checkpointParent)
+	mSCRIPT_DEFINE_DOCSTRING("Get the number of bytes used to store the contents of all checkpoints")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, checkpointMemory)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Open a savestate journal file, creating it if it doesn't exist, and close any journal that was already "
+		"open. A journal stores many states in one file, mostly as differences from earlier ones, and can be "
+		"read back with the mgba-journal tool"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, openJournal)
+	mSCRIPT_DEFINE_DOCSTRING("Append the current state to the open journal")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, appendJournal)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Write the journal's index so every state appended so far can be found quickly. This also happens "
+		"when the journal is closed"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, flushJournal)
+	mSCRIPT_DEFINE_DOCSTRING("Flush and close the open journal")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, closeJournal)
+	mSCRIPT_DEFINE_DOCSTRING("Get the number of states in the open journal")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, journalSize)
+	mSCRIPT_DEFINE_DOCSTRING("Load the state with the given index, starting at 0, from the open journal")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, restoreJournal)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a read-only struct::mImage that shows the current frame directly, without copying it like "
+		"struct::mCore.screenshotToImage does. It can be drawn onto other images, hashed or compared. The "
+		"view stops working at the end of the frame, or sooner if the frontend replaces its video buffer, "
+		"so call this again each frame rather than keeping it"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, frameView)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, read8)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, read16)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, read32)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, readRange)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, readMany)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, readStruct)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, readInto)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write8)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write16)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCoreAdapter, write32)
@@ -1379,17 +1945,128 @@ static uint8_t _readLuminance(struct GBALuminanceSource* luminance) {
 }
 #endif
 
+// The frame view points into the frontend's video buffer, which can be
+// reallocated between frames or while the core is interrupted. Views end at
+// the end of each frame, and earlier if the buffer has moved since.
+static void _checkFrameView(struct mScriptContext* context, bool frameEnded) {
+	struct mScriptValue* value = mScriptContextGetGlobal(context, "emu");
+	if (!value || value->type != mSCRIPT_TYPE_MS_S(mScriptCoreAdapter)) {
+		return;
+	}
+	struct mScriptCoreAdapter* adapter = value->value.opaque;
+	if (!adapter->frameView) {
+		return;
+	}
+	struct mScriptValue* view = mScriptContextAccessWeakref(context, adapter->frameView);
+	if (view && !frameEnded) {
+		struct mCore* core = adapter->core;
+		const struct mImage* image = view->value.opaque;
+		size_t stride;
+		const void* pixels = NULL;
+		unsigned width, height;
+		core->currentVideoSize(core, &width, &height);
+		core->getPixels(core, &pixels, &stride);
+		if (pixels == image->data && stride == image->stride && width == image->width && height == image->height) {
+			return;
+		}
+	}
+	_clearFrameView(context, adapter, true);
+}
+
 #define mCoreCallback(NAME) _mScriptCoreCallback ## NAME
 #define DEFINE_CALLBACK(NAME) \
 	void mCoreCallback(NAME) (void* context) { \
 		struct mScriptContext* scriptContext = context; \
-		if (!scriptContext) { \
+		if (!scriptContext || scriptContext->speculative) { \
 			return; \
 		} \
+		_checkFrameView(scriptContext, false); \
 		mScriptContextTriggerCallback(scriptContext, #NAME, NULL); \
 	}
 
-DEFINE_CALLBACK(frame)
+static bool _mScriptCoreAdapterReadWatch(void* user, struct mScriptValue* domain, uint32_t address, uint32_t length, uint8_t* out) {
+	struct mScriptCoreAdapter* coreAdapter = user;
+	if (domain->type != mSCRIPT_TYPE_MS_S(mScriptMemoryDomain)) {
+		return false;
+	}
+	// Domains outlive the core they came from if a script holds onto them,
+	// so only read ones that belong to the current memory map
+	bool found = false;
+	struct TableIterator iter;
+	if (mScriptTableIteratorStart(&coreAdapter->memory, &iter)) {
+		do {
+			struct mScriptValue* value = mScriptTableIteratorGetValue(&coreAdapter->memory, &iter);
+			if (mScriptContextAccessWeakref(coreAdapter->context, value) == domain) {
+				found = true;
+				break;
+			}
+		} while (mScriptTableIteratorNext(&coreAdapter->memory, &iter));
+	}
+	if (!found) {
+		return false;
+	}
+
+	struct mScriptMemoryDomain* adapter = domain->value.opaque;
+	if (!adapter->block.segmentStart) {
+		size_t size;
+		const uint8_t* block = adapter->core->getMemoryBlock(adapter->core, adapter->block.id, &size);
+		if (block && size >= adapter->block.end - adapter->block.start && (uint64_t) address + length <= size) {
+			memcpy(out, &block[address], length);
+			return true;
+		}
+	}
+	CALCULATE_SEGMENT_INFO;
+	uint32_t i;
+	for (i = 0; i < length; ++i, ++address) {
+		CALCULATE_SEGMENT_ADDRESS;
+		out[i] = adapter->core->rawRead8(adapter->core, segmentAddress, segment);
+	}
+	return true;
+}
+
+static uint32_t _mScriptCoreAdapterCollectWatchStores(void* user) {
+	struct mScriptCoreAdapter* adapter = user;
+	return adapter->core->collectMemoryStores(adapter->core);
+}
+
+static bool _mScriptCoreAdapterWatchStoredSince(void* user, struct mScriptValue* domain, uint32_t address, uint32_t length, uint32_t epoch) {
+	struct mScriptCoreAdapter* coreAdapter = user;
+	if (domain->type != mSCRIPT_TYPE_MS_S(mScriptMemoryDomain)) {
+		return true;
+	}
+	struct mScriptMemoryDomain* adapter = domain->value.opaque;
+	if (adapter->core != coreAdapter->core || adapter->block.segmentStart) {
+		return true;
+	}
+	return adapter->core->memoryBlockStoredSince(adapter->core, adapter->block.id, address, length, epoch);
+}
+
+void mCoreCallback(frame) (void* context) {
+	struct mScriptContext* scriptContext = context;
+	if (!scriptContext || scriptContext->speculative) {
+		return;
+	}
+	mScriptContextStartFrame(scriptContext);
+	_checkFrameView(scriptContext, true);
+	if (mScriptWatchListSize(&scriptContext->watches)) {
+		struct mScriptValue* value = mScriptContextGetGlobal(scriptContext, "emu");
+		if (value && value->type == mSCRIPT_TYPE_MS_S(mScriptCoreAdapter)) {
+			struct mScriptCoreAdapter* adapter = value->value.opaque;
+			struct mScriptWatchSource source = {
+				.user = adapter,
+				.read = _mScriptCoreAdapterReadWatch,
+			};
+			// Only ranges the core saw stores to need to be read and compared
+			if (adapter->core->collectMemoryStores && adapter->core->memoryBlockStoredSince) {
+				source.collectStores = _mScriptCoreAdapterCollectWatchStores;
+				source.storedSince = _mScriptCoreAdapterWatchStoredSince;
+			}
+			mScriptContextCheckWatches(scriptContext, &source);
+		}
+	}
+	mScriptContextTriggerCallback(scriptContext, "frame", NULL);
+}
+
 DEFINE_CALLBACK(crashed)
 DEFINE_CALLBACK(sleep)
 DEFINE_CALLBACK(stop)
@@ -1402,6 +2079,7 @@ void mScriptContextAttachCore(struct mScriptContext* context, struct mCore* core
 	struct mScriptCoreAdapter* adapter = calloc(1, sizeof(*adapter));
 	adapter->core = core;
 	adapter->context = context;
+	mStateIncrementalInit(&adapter->snapshotIncremental);
 
 	adapter->memory.refs = mSCRIPT_VALUE_UNREF;
 	adapter->memory.flags = 0;
@@ -1462,6 +2140,7 @@ void mScriptContextDetachCore(struct mScriptContext* context) {
 
 	struct mScriptCoreAdapter* adapter = value->value.opaque;
 	_clearMemoryMap(context, adapter, true);
+	_clearFrameView(context, adapter, true);
 	struct mCore* core = adapter->core;
 	core->setPeripheral(core, mPERIPH_RUMBLE, adapter->oldRumble);
 	core->setPeripheral(core, mPERIPH_ROTATION, adapter->oldRotation);
@@ -10,6 +10,7 @@
 #include <mgba/core/interface.h>
 #include <mgba/core/version.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #ifdef USE_PNG
@@ -26,12 +27,6 @@ struct mBundledState {
 	struct mStateExtdata* extdata;
 };
 
-struct mStateExtdataHeader {
-	uint32_t tag;
-	int32_t size;
-	int64_t offset;
-};
-
 void mStateExtdataInit(struct mStateExtdata* extdata) {
 	memset(extdata->data, 0, sizeof(extdata->data));
 }
@@ -153,6 +148,122 @@ bool mStateExtdataDeserialize(struct mStateExtdata* extdata, struct VFile* vf) {
 }
 
 #ifdef USE_PNG
+#define PNG_STATE_CHUNK_SIZE 0x20000
+#define DEFLATE_WORKERS 3
+
+#if !defined(DISABLE_THREADING) && (defined(USE_PTHREADS) || defined(_WIN32))
+#define USE_DEFLATE_WORKERS
+#endif
+
+struct mStateDeflateJob {
+	const void* in;
+	size_t inSize;
+	Bytef* out;
+	uLong outSize;
+	uLong adler;
+	bool raw;
+	bool last;
+	bool ok;
+};
+
+static void _deflateJob(struct mStateDeflateJob* job) {
+	z_stream zstr = {0};
+	job->ok = false;
+	// Raw chunks omit the zlib header and trailer so they can be spliced into
+	// one stream; non-final chunks end on a full flush to stay byte-aligned
+	if (deflateInit2(&zstr, Z_DEFAULT_COMPRESSION, Z_DEFLATED, job->raw ? -MAX_WBITS : MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return;
+	}
+	job->outSize = deflateBound(&zstr, job->inSize) + 16;
+	job->out = malloc(job->outSize);
+	if (job->out) {
+		zstr.next_in = (Bytef*) job->in;
+		zstr.avail_in = job->inSize;
+		zstr.next_out = job->out;
+		zstr.avail_out = job->outSize;
+		int ret = deflate(&zstr, job->last ? Z_FINISH : Z_FULL_FLUSH);
+		job->ok = job->last ? ret == Z_STREAM_END : (ret == Z_OK && !zstr.avail_in);
+		job->outSize = zstr.total_out;
+	}
+	deflateEnd(&zstr);
+	if (job->raw) {
+		job->adler = adler32(adler32(0, NULL, 0), job->in, job->inSize);
+	}
+}
+
+// A few workers are started for each PNG state that's saved, and are joined
+// before the save returns, so none are left behind. Jobs without input are
+// skipped. If no workers can be started, the jobs are deflated inline.
+struct mStateDeflatePool {
+	struct mStateDeflateJob* jobs;
+	size_t nJobs;
+	size_t next;
+#ifdef USE_DEFLATE_WORKERS
+	Mutex mutex;
+	Thread workers[DEFLATE_WORKERS];
+	unsigned nWorkers;
+#endif
+};
+
+static struct mStateDeflateJob* _deflatePoolTake(struct mStateDeflatePool* pool) {
+	struct mStateDeflateJob* job = NULL;
+#ifdef USE_DEFLATE_WORKERS
+	MutexLock(&pool->mutex);
+#endif
+	while (pool->next < pool->nJobs && !pool->jobs[pool->next].in) {
+		++pool->next;
+	}
+	if (pool->next < pool->nJobs) {
+		job = &pool->jobs[pool->next];
+		++pool->next;
+	}
+#ifdef USE_DEFLATE_WORKERS
+	MutexUnlock(&pool->mutex);
+#endif
+	return job;
+}
+
+#ifdef USE_DEFLATE_WORKERS
+static THREAD_ENTRY _deflateThread(void* context) {
+	struct mStateDeflatePool* pool = context;
+	ThreadSetName("Savestate deflate");
+	struct mStateDeflateJob* job;
+	while ((job = _deflatePoolTake(pool))) {
+		_deflateJob(job);
+	}
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _deflatePoolStart(struct mStateDeflatePool* pool) {
+#ifdef USE_DEFLATE_WORKERS
+	MutexInit(&pool->mutex);
+	for (pool->nWorkers = 0; pool->nWorkers < DEFLATE_WORKERS; ++pool->nWorkers) {
+		if (ThreadCreate(&pool->workers[pool->nWorkers], _deflateThread, pool)) {
+			mLOG(SAVESTATE, WARN, "Could only start %u of %u deflate threads", pool->nWorkers, DEFLATE_WORKERS);
+			break;
+		}
+	}
+#else
+	UNUSED(pool);
+#endif
+}
+
+static void _deflatePoolFinish(struct mStateDeflatePool* pool) {
+	// Rather than sit idle, help with whatever is still queued
+	struct mStateDeflateJob* job;
+	while ((job = _deflatePoolTake(pool))) {
+		_deflateJob(job);
+	}
+#ifdef USE_DEFLATE_WORKERS
+	unsigned i;
+	for (i = 0; i < pool->nWorkers; ++i) {
+		ThreadJoin(&pool->workers[i]);
+	}
+	MutexDeinit(&pool->mutex);
+#endif
+}
+
 static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
 	size_t stride;
 	const void* pixels = 0;
@@ -169,47 +280,110 @@ static bool _savePNGState(struct mCore* core, struct VFile* vf, struct mStateExt
 	}
 	core->saveState(core, state);
 
-	uLongf len = compressBound(stateSize);
-	void* buffer = malloc(len);
-	if (!buffer) {
+	// The state is split into chunks deflated in parallel, and each extdata
+	// item gets its own job, while this thread encodes the screenshot
+	size_t nStateJobs = (stateSize + PNG_STATE_CHUNK_SIZE - 1) / PNG_STATE_CHUNK_SIZE;
+	if (!nStateJobs) {
+		nStateJobs = 1;
+	}
+	struct mStateDeflateJob* jobs = calloc(nStateJobs + EXTDATA_MAX, sizeof(*jobs));
+	if (!jobs) {
 		mappedMemoryFree(state, stateSize);
 		return false;
 	}
-	compress(buffer, &len, (const Bytef*) state, stateSize);
-	mappedMemoryFree(state, stateSize);
+	size_t i;
+	for (i = 0; i < nStateJobs; ++i) {
+		struct mStateDeflateJob* job = &jobs[i];
+		job->in = (const uint8_t*) state + i * PNG_STATE_CHUNK_SIZE;
+		job->inSize = stateSize - i * PNG_STATE_CHUNK_SIZE;
+		if (job->inSize > PNG_STATE_CHUNK_SIZE) {
+			job->inSize = PNG_STATE_CHUNK_SIZE;
+		}
+		job->raw = true;
+		job->last = i == nStateJobs - 1;
+	}
+	struct mStateDeflateJob* extJobs = &jobs[nStateJobs];
+	if (extdata) {
+		for (i = 1; i < EXTDATA_MAX; ++i) {
+			if (!extdata->data[i].data) {
+				continue;
+			}
+			extJobs[i].in = extdata->data[i].data;
+			extJobs[i].inSize = extdata->data[i].size;
+			extJobs[i].last = true;
+		}
+	}
+	struct mStateDeflatePool pool = {
+		.jobs = jobs,
+		.nJobs = nStateJobs + EXTDATA_MAX,
+	};
+	_deflatePoolStart(&pool);
 
 	unsigned width, height;
 	core->currentVideoSize(core, &width, &height);
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = PNGWriteHeader(png, width, height, mCOLOR_NATIVE);
-	if (!png || !info) {
-		PNGWriteClose(png, info);
+	bool success = png && info;
+	if (success) {
+		PNGWritePixels(png, width, height, stride, pixels, mCOLOR_NATIVE);
+	}
+
+	_deflatePoolFinish(&pool);
+
+	uLong len = 6;
+	uLong adler = adler32(0, NULL, 0);
+	for (i = 0; i < nStateJobs; ++i) {
+		success = success && jobs[i].ok;
+		len += jobs[i].outSize;
+		adler = adler32_combine(adler, jobs[i].adler, jobs[i].inSize);
+	}
+	uint8_t* buffer = success ? malloc(len) : NULL;
+	if (buffer) {
+		// Same header compress() emits at the default level
+		buffer[0] = 0x78;
+		buffer[1] = 0x9C;
+		size_t offset = 2;
+		for (i = 0; i < nStateJobs; ++i) {
+			memcpy(&buffer[offset], jobs[i].out, jobs[i].outSize);
+			offset += jobs[i].outSize;
+		}
+		buffer[offset] = adler >> 24;
+		buffer[offset + 1] = adler >> 16;
+		buffer[offset + 2] = adler >> 8;
+		buffer[offset + 3] = adler;
+		PNGWriteCustomChunk(png, "gbAs", len, buffer);
 		free(buffer);
-		return false;
+	} else {
+		success = false;
 	}
-	PNGWritePixels(png, width, height, stride, pixels, mCOLOR_NATIVE);
-	PNGWriteCustomChunk(png, "gbAs", len, buffer);
+
 	if (extdata) {
-		uint32_t i;
 		for (i = 1; i < EXTDATA_MAX; ++i) {
 			if (!extdata->data[i].data) {
 				continue;
 			}
-			uLongf len = compressBound(extdata->data[i].size) + sizeof(uint32_t) * 2;
-			uint32_t* data = malloc(len);
+			if (!success || !extJobs[i].ok) {
+				continue;
+			}
+			uint32_t* data = malloc(extJobs[i].outSize + sizeof(uint32_t) * 2);
 			if (!data) {
 				continue;
 			}
 			STORE_32LE(i, 0, data);
 			STORE_32LE(extdata->data[i].size, sizeof(uint32_t), data);
-			compress((Bytef*) (data + 2), &len, extdata->data[i].data, extdata->data[i].size);
-			PNGWriteCustomChunk(png, "gbAx", len + sizeof(uint32_t) * 2, data);
+			memcpy(data + 2, extJobs[i].out, extJobs[i].outSize);
+			PNGWriteCustomChunk(png, "gbAx", extJobs[i].outSize + sizeof(uint32_t) * 2, data);
 			free(data);
 		}
 	}
 	PNGWriteClose(png, info);
-	free(buffer);
-	return true;
+
+	for (i = 0; i < nStateJobs + EXTDATA_MAX; ++i) {
+		free(jobs[i].out);
+	}
+	free(jobs);
+	mappedMemoryFree(state, stateSize);
+	return success;
 }
 
 static int _loadPNGChunkHandler(png_structp png, png_unknown_chunkp chunk) {
@@ -376,12 +550,8 @@ static bool _loadPNGExtdata(struct VFile* vf, struct mStateExtdata* extdata) {
 }
 #endif
 
-bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
-	struct mStateExtdata extdata;
-	mStateExtdataInit(&extdata);
-	size_t stateSize = core->stateSize(core);
-
-	core->saveExtraState(core, &extdata);
+static struct VFile* _collectExtdata(struct mCore* core, struct mStateExtdata* extdata, int flags) {
+	core->saveExtraState(core, extdata);
 	if (flags & SAVESTATE_METADATA) {
 		uint64_t* creationUsec = malloc(sizeof(*creationUsec));
 		if (creationUsec) {
@@ -412,7 +582,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = creationUsec,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_META_TIME, &item);
+			mStateExtdataPut(extdata, EXTDATA_META_TIME, &item);
 		}
 
 		char creator[256];
@@ -422,7 +592,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 			.data = strdup(creator),
 			.clean = free
 		};
-		mStateExtdataPut(&extdata, EXTDATA_META_CREATOR, &item);
+		mStateExtdataPut(extdata, EXTDATA_META_CREATOR, &item);
 	}
 
 	if (flags & SAVESTATE_SAVEDATA) {
@@ -434,7 +604,7 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = sram,
 				.clean = free
 			};
-			mStateExtdataPut(&extdata, EXTDATA_SAVEDATA, &item);
+			mStateExtdataPut(extdata, EXTDATA_SAVEDATA, &item);
 		}
 	}
 	struct VFile* cheatVf = 0;
@@ -448,16 +618,25 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 				.data = cheatVf->map(cheatVf, cheatVf->size(cheatVf), MAP_READ),
 				.clean = 0
 			};
-			mStateExtdataPut(&extdata, EXTDATA_CHEATS, &item);
+			mStateExtdataPut(extdata, EXTDATA_CHEATS, &item);
 		}
 	}
 	if (flags & SAVESTATE_RTC) {
 		struct mStateExtdataItem item;
 		if (core->rtc.d.serialize) {
 			core->rtc.d.serialize(&core->rtc.d, &item);
-			mStateExtdataPut(&extdata, EXTDATA_RTC, &item);
+			mStateExtdataPut(extdata, EXTDATA_RTC, &item);
 		}
 	}
+	return cheatVf;
+}
+
+bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	size_t stateSize = core->stateSize(core);
+	struct VFile* cheatVf = _collectExtdata(core, &extdata, flags);
+
 #ifdef USE_PNG
 	if (!(flags & SAVESTATE_SCREENSHOT)) {
 #else
@@ -496,6 +675,118 @@ bool mCoreSaveStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	return false;
 }
 
+size_t mCoreSaveStateBuffer(struct mCore* core, void* buffer, size_t size, int flags) {
+	size_t stateSize = core->stateSize(core);
+	if (!(flags & SAVESTATE_ALL)) {
+		// Only the core state was requested, so skip extdata entirely and
+		// serialize straight into the caller's buffer
+		if (size >= stateSize && !core->saveState(core, buffer)) {
+			return 0;
+		}
+		return stateSize;
+	}
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	if (!vf) {
+		return 0;
+	}
+	size_t needed = 0;
+	if (mCoreSaveStateNamed(core, vf, flags)) {
+		needed = vf->size(vf);
+		if (needed <= size) {
+			vf->seek(vf, 0, SEEK_SET);
+			vf->read(vf, buffer, needed);
+		}
+	}
+	vf->close(vf);
+	return needed;
+}
+
+bool mCoreLoadStateBuffer(struct mCore* core, const void* buffer, size_t size, int flags) {
+	size_t stateSize = core->stateSize(core);
+	if (size == stateSize) {
+#ifdef USE_PNG
+		if (png_sig_cmp(buffer, 0, 8) != 0) {
+			return core->loadState(core, buffer);
+		}
+#else
+		return core->loadState(core, buffer);
+#endif
+	}
+
+	struct VFile* vf = VFileFromConstMemory(buffer, size);
+	if (!vf) {
+		return false;
+	}
+	bool success = mCoreLoadStateNamed(core, vf, flags);
+	vf->close(vf);
+	return success;
+}
+
+void mStateIncrementalInit(struct mStateIncremental* incremental) {
+	memset(incremental, 0, sizeof(*incremental));
+}
+
+void mStateIncrementalDeinit(struct mStateIncremental* incremental) {
+	free(incremental->changedPages);
+	memset(incremental, 0, sizeof(*incremental));
+}
+
+void mStateIncrementalInvalidate(struct mStateIncremental* incremental) {
+	incremental->epoch = 0;
+}
+
+bool mCoreSaveStateIncremental(struct mCore* core, struct VFile* vf, int flags, struct mStateIncremental* incremental) {
+	size_t stateSize = core->stateSize(core);
+	size_t nPages = (stateSize + mSTATE_PAGE_SIZE - 1) >> mSTATE_PAGE_SHIFT;
+	size_t nWords = (nPages + 31) / 32;
+	if (incremental->stateSize != stateSize) {
+		free(incremental->changedPages);
+		incremental->changedPages = calloc(nWords, sizeof(*incremental->changedPages));
+		incremental->stateSize = stateSize;
+		incremental->nPages = nPages;
+		incremental->epoch = 0;
+		if (!incremental->changedPages) {
+			incremental->stateSize = 0;
+			incremental->nPages = 0;
+			return false;
+		}
+	}
+	if (vf->size(vf) < (ssize_t) stateSize) {
+		incremental->epoch = 0;
+	}
+
+	struct mStateExtdata extdata;
+	mStateExtdataInit(&extdata);
+	struct VFile* cheatVf = _collectExtdata(core, &extdata, flags & ~SAVESTATE_SCREENSHOT);
+
+	bool success = false;
+	vf->truncate(vf, stateSize);
+	void* state = vf->map(vf, stateSize, MAP_WRITE);
+	if (state) {
+		// Only pages the core reports as written since this buffer was last
+		// filled are copied; the rest of the buffer is left as it was
+		if (core->saveStateIncremental) {
+			success = core->saveStateIncremental(core, state, &incremental->epoch, incremental->changedPages);
+		}
+		if (!success) {
+			success = core->saveState(core, state);
+			incremental->epoch = 0;
+			memset(incremental->changedPages, 0xFF, nWords * sizeof(*incremental->changedPages));
+		}
+		vf->unmap(vf, state, stateSize);
+		vf->seek(vf, stateSize, SEEK_SET);
+		mStateExtdataSerialize(&extdata, vf);
+	} else {
+		incremental->epoch = 0;
+	}
+	mStateExtdataDeinit(&extdata);
+	if (cheatVf) {
+		cheatVf->close(cheatVf);
+	}
+	return success;
+}
+
 void* mCoreExtractState(struct mCore* core, struct VFile* vf, struct mStateExtdata* extdata) {
 #ifdef USE_PNG
 	if (isPNG(vf)) {
@@ -529,15 +820,64 @@ bool mCoreExtractExtdata(struct mCore* core, struct VFile* vf, struct mStateExtd
 	return mStateExtdataDeserialize(extdata, vf);
 }
 
+static void _mapExtdata(struct mStateExtdata* extdata, const uint8_t* data, size_t size, size_t offset) {
+	while (offset + sizeof(struct mStateExtdataHeader) <= size) {
+		struct mStateExtdataHeader header;
+		LOAD_32LE(header.tag, offsetof(struct mStateExtdataHeader, tag), &data[offset]);
+		LOAD_32LE(header.size, offsetof(struct mStateExtdataHeader, size), &data[offset]);
+		LOAD_64LE(header.offset, offsetof(struct mStateExtdataHeader, offset), &data[offset]);
+		offset += sizeof(header);
+
+		if (header.tag == EXTDATA_NONE) {
+			break;
+		}
+		if (header.tag >= EXTDATA_MAX || header.size <= 0 || header.offset < 0) {
+			continue;
+		}
+		if ((uint64_t) header.offset > size || (size_t) header.size > size - header.offset) {
+			continue;
+		}
+		// Items point into the mapping and are released along with it
+		struct mStateExtdataItem item = {
+			.data = (void*) &data[header.offset],
+			.size = header.size,
+			.clean = NULL
+		};
+		mStateExtdataPut(extdata, header.tag, &item);
+	}
+}
+
 bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 	struct mStateExtdata extdata;
 	mStateExtdataInit(&extdata);
-	void* state = mCoreExtractState(core, vf, &extdata);
-	if (!state) {
-		return false;
+	size_t stateSize = core->stateSize(core);
+	uint8_t* mapped = NULL;
+	ssize_t mappedSize = 0;
+#ifdef USE_PNG
+	if (!isPNG(vf)) {
+#endif
+		mappedSize = vf->size(vf);
+		if (mappedSize >= (ssize_t) stateSize) {
+			mapped = vf->map(vf, mappedSize, MAP_READ);
+		}
+#ifdef USE_PNG
+	}
+#endif
+
+	bool success;
+	if (mapped) {
+		// Raw states are loaded straight out of the mapping instead of being
+		// read into a scratch buffer first
+		success = core->loadState(core, mapped);
+		_mapExtdata(&extdata, mapped, mappedSize, stateSize);
+	} else {
+		void* state = mCoreExtractState(core, vf, &extdata);
+		if (!state) {
+			return false;
+		}
+		success = core->loadState(core, state);
+		mappedMemoryFree(state, stateSize);
 	}
-	bool success = core->loadState(core, state);
-	mappedMemoryFree(state, core->stateSize(core));
 
 	core->loadExtraState(core, &extdata);
 
@@ -580,6 +920,9 @@ bool mCoreLoadStateNamed(struct mCore* core, struct VFile* vf, int flags) {
 		}
 	}
 	mStateExtdataDeinit(&extdata);
+	if (mapped) {
+		vf->unmap(vf, mapped, mappedSize);
+	}
 	return success;
 }
 
@@ -0,0 +1,432 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-journal.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
+
+#define JOURNAL_MAGIC "mGBAJRNL"
+#define JOURNAL_INDEX_MAGIC "mGBAJIDX"
+#define JOURNAL_VERSION 1
+
+enum {
+	JOURNAL_RECORD_FULL = 1,
+	JOURNAL_RECORD_DIFF = 2,
+};
+
+struct mStateJournalHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct mStateJournalRecord {
+	uint32_t type;
+	uint32_t base;
+	uint32_t size;
+	uint32_t payload;
+};
+
+struct mStateJournalIndexEntry {
+	uint64_t offset;
+	uint32_t base;
+	uint32_t size;
+};
+
+struct mStateJournalTrailer {
+	uint64_t indexOffset;
+	uint32_t count;
+	uint32_t reserved;
+	char magic[8];
+};
+
+struct mStateJournalDiffExtent {
+	uint32_t offset;
+	uint32_t length;
+};
+
+DEFINE_VECTOR(mStateJournalEntryList, struct mStateJournalEntry);
+
+static bool _readRecord(struct VFile* vf, size_t offset, struct mStateJournalRecord* record) {
+	struct mStateJournalRecord buffer;
+	if (vf->seek(vf, offset, SEEK_SET) < 0 || vf->read(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+		return false;
+	}
+	LOAD_32LE(record->type, 0, &buffer.type);
+	LOAD_32LE(record->base, 0, &buffer.base);
+	LOAD_32LE(record->size, 0, &buffer.size);
+	LOAD_32LE(record->payload, 0, &buffer.payload);
+	return true;
+}
+
+static bool _readIndex(struct mStateJournal* journal, size_t size) {
+	struct mStateJournalTrailer trailer;
+	if (size < sizeof(struct mStateJournalHeader) + sizeof(trailer)) {
+		return false;
+	}
+	struct VFile* vf = journal->vf;
+	if (vf->seek(vf, size - sizeof(trailer), SEEK_SET) < 0 || vf->read(vf, &trailer, sizeof(trailer)) != sizeof(trailer)) {
+		return false;
+	}
+	if (memcmp(trailer.magic, JOURNAL_INDEX_MAGIC, sizeof(trailer.magic)) != 0) {
+		return false;
+	}
+	uint64_t indexOffset;
+	uint32_t count;
+	LOAD_64LE(indexOffset, 0, &trailer.indexOffset);
+	LOAD_32LE(count, 0, &trailer.count);
+	if (indexOffset < sizeof(struct mStateJournalHeader) || indexOffset > size) {
+		return false;
+	}
+	if ((size - sizeof(trailer) - indexOffset) / sizeof(struct mStateJournalIndexEntry) != count ||
+	    (size - sizeof(trailer) - indexOffset) % sizeof(struct mStateJournalIndexEntry)) {
+		return false;
+	}
+
+	if (vf->seek(vf, indexOffset, SEEK_SET) < 0) {
+		return false;
+	}
+	mStateJournalEntryListClear(&journal->entries);
+	uint32_t i;
+	for (i = 0; i < count; ++i) {
+		struct mStateJournalIndexEntry buffer;
+		if (vf->read(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+			mStateJournalEntryListClear(&journal->entries);
+			return false;
+		}
+		struct mStateJournalEntry entry;
+		LOAD_64LE(entry.offset, 0, &buffer.offset);
+		LOAD_32LE(entry.base, 0, &buffer.base);
+		LOAD_32LE(entry.size, 0, &buffer.size);
+		if (entry.offset >= indexOffset || entry.base > i) {
+			mStateJournalEntryListClear(&journal->entries);
+			return false;
+		}
+		*mStateJournalEntryListAppend(&journal->entries) = entry;
+	}
+	journal->end = indexOffset;
+	return true;
+}
+
+static void _scanRecords(struct mStateJournal* journal, size_t size) {
+	// Without an index, e.g. after a crash, every complete record is recovered
+	mStateJournalEntryListClear(&journal->entries);
+	size_t offset = sizeof(struct mStateJournalHeader);
+	struct mStateJournalRecord record;
+	while (offset + sizeof(record) <= size && _readRecord(journal->vf, offset, &record)) {
+		uint32_t index = mStateJournalEntryListSize(&journal->entries);
+		if (record.type == JOURNAL_RECORD_FULL) {
+			if (record.base != index || record.payload != record.size) {
+				break;
+			}
+		} else if (record.type != JOURNAL_RECORD_DIFF || record.base >= index) {
+			break;
+		}
+		if (record.payload > size - offset - sizeof(record)) {
+			break;
+		}
+		struct mStateJournalEntry* entry = mStateJournalEntryListAppend(&journal->entries);
+		entry->offset = offset;
+		entry->base = record.base;
+		entry->size = record.size;
+		offset += sizeof(record) + record.payload;
+	}
+	journal->end = offset;
+}
+
+static void _truncate(struct mStateJournal* journal) {
+	// Drop anything after the last complete record so a failed write can't
+	// leave a torn record or index behind for the next append to build on
+	struct VFile* vf = journal->vf;
+	if (vf->size(vf) > (ssize_t) journal->end) {
+		vf->truncate(vf, journal->end);
+	}
+}
+
+bool mStateJournalOpen(struct mStateJournal* journal, struct VFile* vf) {
+	journal->vf = vf;
+	journal->dirty = false;
+	mStateJournalEntryListInit(&journal->entries, 0);
+	journal->rebaseInterval = mSTATE_JOURNAL_REBASE_INTERVAL;
+	journal->base = NULL;
+	journal->baseSize = 0;
+	journal->baseIndex = 0;
+	initPatchFast(&journal->patch);
+	journal->scratch = VFileMemChunk(NULL, 0);
+
+	struct mStateJournalHeader header;
+	ssize_t size = vf->size(vf);
+	if (size <= 0) {
+		memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+		STORE_32LE(JOURNAL_VERSION, 0, &header.version);
+		header.reserved = 0;
+		if (vf->seek(vf, 0, SEEK_SET) < 0 || vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+			goto error;
+		}
+		journal->end = sizeof(header);
+		journal->dirty = true;
+		return true;
+	}
+
+	uint32_t version;
+	if (vf->seek(vf, 0, SEEK_SET) < 0 || vf->read(vf, &header, sizeof(header)) != sizeof(header)) {
+		goto error;
+	}
+	LOAD_32LE(version, 0, &header.version);
+	if (memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 || version != JOURNAL_VERSION) {
+		goto error;
+	}
+	if (!_readIndex(journal, size)) {
+		_scanRecords(journal, size);
+	}
+	return true;
+
+error:
+	mStateJournalEntryListDeinit(&journal->entries);
+	deinitPatchFast(&journal->patch);
+	journal->scratch->close(journal->scratch);
+	journal->scratch = NULL;
+	journal->vf = NULL;
+	return false;
+}
+
+bool mStateJournalClose(struct mStateJournal* journal) {
+	bool success = !journal->dirty || mStateJournalFlush(journal);
+	mStateJournalEntryListDeinit(&journal->entries);
+	deinitPatchFast(&journal->patch);
+	free(journal->base);
+	journal->base = NULL;
+	journal->scratch->close(journal->scratch);
+	journal->scratch = NULL;
+	journal->vf = NULL;
+	return success;
+}
+
+bool mStateJournalFlush(struct mStateJournal* journal) {
+	struct VFile* vf = journal->vf;
+	if (vf->seek(vf, journal->end, SEEK_SET) < 0) {
+		return false;
+	}
+	size_t i;
+	for (i = 0; i < mStateJournalEntryListSize(&journal->entries); ++i) {
+		const struct mStateJournalEntry* entry = mStateJournalEntryListGetConstPointer(&journal->entries, i);
+		struct mStateJournalIndexEntry buffer;
+		STORE_64LE(entry->offset, 0, &buffer.offset);
+		STORE_32LE(entry->base, 0, &buffer.base);
+		STORE_32LE(entry->size, 0, &buffer.size);
+		if (vf->write(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+			goto error;
+		}
+	}
+	struct mStateJournalTrailer trailer;
+	STORE_64LE(journal->end, 0, &trailer.indexOffset);
+	STORE_32LE(i, 0, &trailer.count);
+	trailer.reserved = 0;
+	memcpy(trailer.magic, JOURNAL_INDEX_MAGIC, sizeof(trailer.magic));
+	if (vf->write(vf, &trailer, sizeof(trailer)) != sizeof(trailer)) {
+		goto error;
+	}
+	journal->dirty = false;
+	return true;
+
+error:
+	// A partial index would be read back as garbage, so leave none at all
+	_truncate(journal);
+	return false;
+}
+
+bool mStateJournalAppend(struct mStateJournal* journal, const void* state, size_t size) {
+	if (!size || size > UINT32_MAX) {
+		return false;
+	}
+	struct VFile* vf = journal->vf;
+	uint32_t index = mStateJournalEntryListSize(&journal->entries);
+	bool full = !journal->base || journal->baseSize != size || index - journal->baseIndex >= journal->rebaseInterval;
+	size_t payload = size;
+	size_t i;
+	if (!full) {
+		diffPatchFast(&journal->patch, journal->base, state, size);
+		payload = 0;
+		for (i = 0; i < PatchFastExtentsSize(&journal->patch.extents); ++i) {
+			payload += sizeof(struct mStateJournalDiffExtent) + PatchFastExtentsGetPointer(&journal->patch.extents, i)->length;
+		}
+		// Once a checkpoint has drifted far enough from the base, starting
+		// over with a new base is cheaper than carrying ever-larger diffs
+		if (payload >= size / 2) {
+			full = true;
+			payload = size;
+		}
+	}
+
+	// The old index gets overwritten, so drop it before appending
+	_truncate(journal);
+	journal->dirty = true;
+	if (vf->seek(vf, journal->end, SEEK_SET) < 0) {
+		return false;
+	}
+
+	struct mStateJournalRecord record;
+	STORE_32LE(full ? JOURNAL_RECORD_FULL : JOURNAL_RECORD_DIFF, 0, &record.type);
+	STORE_32LE(full ? index : journal->baseIndex, 0, &record.base);
+	STORE_32LE(size, 0, &record.size);
+	STORE_32LE(payload, 0, &record.payload);
+	if (vf->write(vf, &record, sizeof(record)) != sizeof(record)) {
+		goto error;
+	}
+	if (full) {
+		if (vf->write(vf, state, size) != (ssize_t) size) {
+			goto error;
+		}
+		if (journal->baseSize != size) {
+			free(journal->base);
+			journal->base = malloc(size);
+			journal->baseSize = journal->base ? size : 0;
+		}
+		if (journal->base) {
+			memcpy(journal->base, state, size);
+			journal->baseIndex = index;
+		}
+	} else {
+		for (i = 0; i < PatchFastExtentsSize(&journal->patch.extents); ++i) {
+			const struct PatchFastExtent* extent = PatchFastExtentsGetConstPointer(&journal->patch.extents, i);
+			struct mStateJournalDiffExtent header;
+			STORE_32LE(extent->offset, 0, &header.offset);
+			STORE_32LE(extent->length, 0, &header.length);
+			if (vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+				goto error;
+			}
+			if (vf->write(vf, extent->extent, extent->length) != (ssize_t) extent->length) {
+				goto error;
+			}
+		}
+	}
+
+	struct mStateJournalEntry* entry = mStateJournalEntryListAppend(&journal->entries);
+	entry->offset = journal->end;
+	entry->base = full ? index : journal->baseIndex;
+	entry->size = size;
+	journal->end += sizeof(record) + payload;
+	return true;
+
+error:
+	_truncate(journal);
+	return false;
+}
+
+bool mStateJournalAppendCore(struct mStateJournal* journal, struct mCore* core, int flags) {
+	struct VFile* vf = journal->scratch;
+	vf->truncate(vf, 0);
+	if (!mCoreSaveStateNamed(core, vf, flags & ~SAVESTATE_SCREENSHOT)) {
+		return false;
+	}
+	size_t size = vf->size(vf);
+	void* state = vf->map(vf, size, MAP_READ);
+	if (!state) {
+		return false;
+	}
+	bool success = mStateJournalAppend(journal, state, size);
+	vf->unmap(vf, state, size);
+	return success;
+}
+
+size_t mStateJournalCount(const struct mStateJournal* journal) {
+	return mStateJournalEntryListSize(&journal->entries);
+}
+
+static bool _readFull(struct mStateJournal* journal, const struct mStateJournalEntry* entry, void* out) {
+	struct mStateJournalRecord record;
+	if (!_readRecord(journal->vf, entry->offset, &record)) {
+		return false;
+	}
+	if (record.type != JOURNAL_RECORD_FULL || record.size != entry->size || record.payload != entry->size) {
+		return false;
+	}
+	return journal->vf->read(journal->vf, out, entry->size) == (ssize_t) entry->size;
+}
+
+static bool _readState(struct mStateJournal* journal, size_t index, void* out) {
+	const struct mStateJournalEntry* entry = mStateJournalEntryListGetConstPointer(&journal->entries, index);
+	if (entry->base == index) {
+		return _readFull(journal, entry, out);
+	}
+
+	const struct mStateJournalEntry* baseEntry = mStateJournalEntryListGetConstPointer(&journal->entries, entry->base);
+	if (baseEntry->size != entry->size) {
+		return false;
+	}
+	void* base = NULL;
+	const void* in;
+	if (journal->base && journal->baseIndex == entry->base && journal->baseSize == entry->size) {
+		in = journal->base;
+	} else {
+		base = malloc(entry->size);
+		if (!base || !_readFull(journal, baseEntry, base)) {
+			free(base);
+			return false;
+		}
+		in = base;
+	}
+
+	struct mStateJournalRecord record;
+	bool success = _readRecord(journal->vf, entry->offset, &record) && record.type == JOURNAL_RECORD_DIFF && record.size == entry->size;
+	PatchFastExtentsClear(&journal->patch.extents);
+	size_t remaining = success ? record.payload : 0;
+	while (remaining >= sizeof(struct mStateJournalDiffExtent)) {
+		struct mStateJournalDiffExtent header;
+		if (journal->vf->read(journal->vf, &header, sizeof(header)) != sizeof(header)) {
+			success = false;
+			break;
+		}
+		struct PatchFastExtent* extent = PatchFastExtentsAppend(&journal->patch.extents);
+		LOAD_32LE(extent->offset, 0, &header.offset);
+		LOAD_32LE(extent->length, 0, &header.length);
+		remaining -= sizeof(header);
+		if (extent->length > sizeof(extent->extent) || extent->length > remaining ||
+		    journal->vf->read(journal->vf, extent->extent, extent->length) != (ssize_t) extent->length) {
+			success = false;
+			break;
+		}
+		remaining -= extent->length;
+	}
+	if (success && !remaining) {
+		success = journal->patch.d.applyPatch(&journal->patch.d, in, entry->size, out, entry->size);
+	} else {
+		success = false;
+	}
+	free(base);
+	return success;
+}
+
+bool mStateJournalExtract(struct mStateJournal* journal, size_t index, struct VFile* out) {
+	if (index >= mStateJournalEntryListSize(&journal->entries)) {
+		return false;
+	}
+	size_t size = mStateJournalEntryListGetConstPointer(&journal->entries, index)->size;
+	void* state = malloc(size);
+	if (!state) {
+		return false;
+	}
+	bool success = _readState(journal, index, state) && out->write(out, state, size) == (ssize_t) size;
+	free(state);
+	return success;
+}
+
+bool mStateJournalLoad(struct mStateJournal* journal, struct mCore* core, size_t index, int flags) {
+	if (index >= mStateJournalEntryListSize(&journal->entries)) {
+		return false;
+	}
+	size_t size = mStateJournalEntryListGetConstPointer(&journal->entries, index)->size;
+	struct VFile* vf = journal->scratch;
+	vf->truncate(vf, size);
+	void* state = vf->map(vf, size, MAP_WRITE);
+	if (!state) {
+		return false;
+	}
+	bool success = _readState(journal, index, state);
+	vf->unmap(vf, state, size);
+	return success && mCoreLoadStateNamed(core, vf, flags);
+}
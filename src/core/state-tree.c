@@ -0,0 +1,257 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-tree.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/hash.h>
+#include <mgba-util/vfs.h>
+
+void mStateTreeInit(struct mStateTree* tree) {
+	TableInit(&tree->nodes, 0, NULL);
+	TableInit(&tree->pages, 0, NULL);
+	tree->nextId = 1;
+	tree->firstRoot = 0;
+	tree->head = 0;
+	tree->work = VFileMemChunk(NULL, 0);
+	tree->workNode = 0;
+	mStateIncrementalInit(&tree->incremental);
+	tree->uniquePages = 0;
+	tree->pageBytes = 0;
+}
+
+static void _freeNode(uint32_t id, void* value, void* user) {
+	UNUSED(id);
+	UNUSED(user);
+	struct mStateNode* node = value;
+	free(node->pages);
+	free(node);
+}
+
+static void _freePages(uint32_t hash, void* value, void* user) {
+	UNUSED(hash);
+	UNUSED(user);
+	struct mStatePage* page = value;
+	while (page) {
+		struct mStatePage* next = page->next;
+		free(page);
+		page = next;
+	}
+}
+
+void mStateTreeDeinit(struct mStateTree* tree) {
+	TableEnumerate(&tree->nodes, _freeNode, NULL);
+	TableEnumerate(&tree->pages, _freePages, NULL);
+	TableDeinit(&tree->nodes);
+	TableDeinit(&tree->pages);
+	tree->work->close(tree->work);
+	tree->work = NULL;
+	mStateIncrementalDeinit(&tree->incremental);
+}
+
+static struct mStatePage* _internPage(struct mStateTree* tree, const void* data, size_t size) {
+	uint32_t hash = hash32(data, size, 0);
+	struct mStatePage* chain = TableLookup(&tree->pages, hash);
+	struct mStatePage* page;
+	for (page = chain; page; page = page->next) {
+		if (page->size == size && memcmp(page->data, data, size) == 0) {
+			++page->refs;
+			return page;
+		}
+	}
+	page = malloc(sizeof(*page) + size);
+	if (!page) {
+		return NULL;
+	}
+	page->next = chain;
+	page->hash = hash;
+	page->refs = 1;
+	page->size = size;
+	memcpy(page->data, data, size);
+	TableInsert(&tree->pages, hash, page);
+	++tree->uniquePages;
+	tree->pageBytes += size;
+	return page;
+}
+
+static void _derefPage(struct mStateTree* tree, struct mStatePage* page) {
+	if (--page->refs) {
+		return;
+	}
+	struct mStatePage* chain = TableLookup(&tree->pages, page->hash);
+	if (chain == page) {
+		if (page->next) {
+			TableInsert(&tree->pages, page->hash, page->next);
+		} else {
+			TableRemove(&tree->pages, page->hash);
+		}
+	} else {
+		while (chain->next != page) {
+			chain = chain->next;
+		}
+		chain->next = page->next;
+	}
+	--tree->uniquePages;
+	tree->pageBytes -= page->size;
+	free(page);
+}
+
+static uint32_t* _childLink(struct mStateTree* tree, uint32_t parent) {
+	if (!parent) {
+		return &tree->firstRoot;
+	}
+	struct mStateNode* node = TableLookup(&tree->nodes, parent);
+	return &node->firstChild;
+}
+
+uint32_t mStateTreeSave(struct mStateTree* tree, struct mCore* core, int flags) {
+	if (!mCoreSaveStateIncremental(core, tree->work, flags, &tree->incremental)) {
+		tree->workNode = 0;
+		return 0;
+	}
+	size_t size = tree->work->size(tree->work);
+	struct mStateNode* node = calloc(1, sizeof(*node));
+	if (!node) {
+		tree->workNode = 0;
+		return 0;
+	}
+	node->size = size;
+	node->nPages = (size + mSTATE_PAGE_SIZE - 1) >> mSTATE_PAGE_SHIFT;
+	node->pages = calloc(node->nPages, sizeof(*node->pages));
+	if (!node->pages) {
+		free(node);
+		tree->workNode = 0;
+		return 0;
+	}
+
+	// Pages the core didn't rewrite since the work buffer last matched a
+	// stored state are shared with that state without rehashing them
+	const struct mStateNode* base = tree->workNode ? TableLookup(&tree->nodes, tree->workNode) : NULL;
+	size_t stablePages = tree->incremental.stateSize >> mSTATE_PAGE_SHIFT;
+	const uint8_t* data = tree->work->map(tree->work, size, MAP_READ);
+	size_t p;
+	for (p = 0; p < node->nPages; ++p) {
+		if (base && p < stablePages && p < base->nPages && !(tree->incremental.changedPages[p >> 5] & (1U << (p & 31)))) {
+			node->pages[p] = base->pages[p];
+			++node->pages[p]->refs;
+			continue;
+		}
+		size_t offset = p << mSTATE_PAGE_SHIFT;
+		size_t length = size - offset;
+		if (length > mSTATE_PAGE_SIZE) {
+			length = mSTATE_PAGE_SIZE;
+		}
+		node->pages[p] = _internPage(tree, &data[offset], length);
+		if (!node->pages[p]) {
+			break;
+		}
+	}
+	tree->work->unmap(tree->work, (void*) data, size);
+	if (p < node->nPages) {
+		while (p--) {
+			_derefPage(tree, node->pages[p]);
+		}
+		_freeNode(0, node, NULL);
+		tree->workNode = 0;
+		return 0;
+	}
+
+	node->id = tree->nextId;
+	++tree->nextId;
+	node->parent = tree->head;
+	uint32_t* link = _childLink(tree, node->parent);
+	node->nextSibling = *link;
+	*link = node->id;
+	TableInsert(&tree->nodes, node->id, node);
+	tree->head = node->id;
+	tree->workNode = node->id;
+	return node->id;
+}
+
+bool mStateTreeLoad(struct mStateTree* tree, struct mCore* core, uint32_t id, int flags) {
+	const struct mStateNode* node = TableLookup(&tree->nodes, id);
+	if (!node) {
+		return false;
+	}
+	if (tree->workNode != id) {
+		tree->work->truncate(tree->work, node->size);
+		uint8_t* data = tree->work->map(tree->work, node->size, MAP_WRITE);
+		size_t p;
+		for (p = 0; p < node->nPages; ++p) {
+			memcpy(&data[p << mSTATE_PAGE_SHIFT], node->pages[p]->data, node->pages[p]->size);
+		}
+		tree->work->unmap(tree->work, data, node->size);
+		tree->workNode = id;
+	}
+	// Loading dirties the whole core, so the next save rewrites every page anyway
+	mStateIncrementalInvalidate(&tree->incremental);
+	tree->head = id;
+	return mCoreLoadStateNamed(core, tree->work, flags);
+}
+
+bool mStateTreeRemove(struct mStateTree* tree, uint32_t id) {
+	struct mStateNode* node = TableLookup(&tree->nodes, id);
+	if (!node) {
+		return false;
+	}
+	uint32_t* link = _childLink(tree, node->parent);
+	while (*link != id) {
+		struct mStateNode* sibling = TableLookup(&tree->nodes, *link);
+		link = &sibling->nextSibling;
+	}
+	*link = node->nextSibling;
+
+	// Children move up to the removed state's parent
+	uint32_t child = node->firstChild;
+	while (child) {
+		struct mStateNode* childNode = TableLookup(&tree->nodes, child);
+		uint32_t next = childNode->nextSibling;
+		childNode->parent = node->parent;
+		link = _childLink(tree, node->parent);
+		childNode->nextSibling = *link;
+		*link = child;
+		child = next;
+	}
+
+	if (tree->head == id) {
+		tree->head = node->parent;
+	}
+	if (tree->workNode == id) {
+		tree->workNode = 0;
+	}
+	size_t p;
+	for (p = 0; p < node->nPages; ++p) {
+		_derefPage(tree, node->pages[p]);
+	}
+	TableRemove(&tree->nodes, id);
+	_freeNode(id, node, NULL);
+	return true;
+}
+
+const struct mStateNode* mStateTreeGet(const struct mStateTree* tree, uint32_t id) {
+	return TableLookup(&tree->nodes, id);
+}
+
+size_t mStateTreeChildren(const struct mStateTree* tree, uint32_t id, uint32_t* children, size_t max) {
+	uint32_t child;
+	if (id) {
+		const struct mStateNode* node = TableLookup(&tree->nodes, id);
+		if (!node) {
+			return 0;
+		}
+		child = node->firstChild;
+	} else {
+		child = tree->firstRoot;
+	}
+	size_t count = 0;
+	while (child) {
+		if (count < max) {
+			children[count] = child;
+		}
+		++count;
+		child = ((const struct mStateNode*) TableLookup(&tree->nodes, child))->nextSibling;
+	}
+	return count;
+}
@@ -8,8 +8,10 @@
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
 #include <mgba/core/scripting.h>
+#include <mgba/core/state-journal.h>
 #include <mgba/internal/script/lua.h>
 #include <mgba/script.h>
+#include <mgba-util/vfs.h>
 
 #include "script/test.h"
 
@@ -41,6 +43,8 @@ static const uint8_t _fakeGBROM[0x4000] = {
 	[0x105] = 0x66,
 };
 
+#define JOURNAL_PATH "script-journal-test.mjl"
+
 #define SETUP_LUA \
 	struct mScriptContext context; \
 	mScriptContextInit(&context); \
@@ -254,6 +258,77 @@ M_TEST_DEFINE(memoryRead) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryReadBulk) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"values = emu:readMany({ base, { base + 4, 2 }, { base + 8, 4 } })\n"
+		"a8 = values[1]\n"
+		"a16 = values[2]\n"
+		"a32 = values[3]\n"
+		"s = emu:readStruct(base + 4, { x = 1, y = { 2, 2 }, z = { 4, 4 } })\n"
+		"x = s.x\n"
+		"y = s.y\n"
+		"z = s.z\n"
+		"buffer = emu:newBuffer(6)\n"
+		"emu:readInto(buffer, base + 2)\n"
+		"b8 = buffer:read8(0)\n"
+		"b32 = buffer:read32(1)\n"
+		"bEnd = buffer:read32(4)\n"
+	);
+
+	int i;
+	for (i = 0; i < 12; ++i) {
+		core->busWrite8(core, RAM_BASE + i, i + 1);
+	}
+	struct mScriptValue base = mSCRIPT_MAKE_S32(RAM_BASE);
+	lua->setGlobal(lua, "base", &base);
+	assert_true(lua->run(lua));
+
+	TEST_VALUE(S32, "a8", 1);
+	TEST_VALUE(S32, "a16", 0x0605);
+	TEST_VALUE(S32, "a32", 0x0C0B0A09);
+	TEST_VALUE(S32, "x", 6);
+	TEST_VALUE(S32, "y", 0x0807);
+	TEST_VALUE(S32, "z", 0x0C0B0A09);
+	TEST_VALUE(S32, "b8", 3);
+	TEST_VALUE(S32, "b32", 0x07060504);
+	TEST_VALUE(S32, "bEnd", 0);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
+M_TEST_DEFINE(memoryReadBenchmark) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	core->busWrite8(core, RAM_BASE, 1);
+	struct mScriptValue base = mSCRIPT_MAKE_S32(RAM_BASE);
+	lua->setGlobal(lua, "base", &base);
+	TEST_PROGRAM(
+		"local calls = 200000\n"
+		"sum = 0\n"
+		"local start = os.clock()\n"
+		"for i = 1, calls do\n"
+		"	sum = sum + emu:read8(base)\n"
+		"end\n"
+		"rate = calls / math.max(os.clock() - start, 1e-6)\n"
+	);
+	TEST_VALUE(S32, "sum", 200000);
+
+	struct mScriptValue* rate = lua->getGlobal(lua, "rate");
+	assert_non_null(rate);
+	print_message("emu:read8: %.0f calls per second\n", rate->value.f64);
+	mScriptValueDeref(rate);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(memoryWrite) {
 	SETUP_LUA;
 	CREATE_CORE;
@@ -282,6 +357,45 @@ M_TEST_DEFINE(memoryWrite) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryWatch) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	TEST_PROGRAM(
+		"hits = 0\n"
+		"other = 0\n"
+		"id = callbacks:watch(emu.memory.wram, 16, 4, function() hits = hits + 1 end)\n"
+		"callbacks:watch(emu.memory.wram, 18, 8, function() other = other + 1 end)\n"
+	);
+
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 0);
+	TEST_VALUE(S32, "other", 0);
+
+	core->busWrite8(core, RAM_BASE + 17, 1);
+	core->busWrite8(core, RAM_BASE + 19, 2);
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 1);
+	TEST_VALUE(S32, "other", 1);
+
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 1);
+	TEST_VALUE(S32, "other", 1);
+	TEST_PROGRAM("assert(callbacks:stats().watch.calls == 2)");
+	TEST_PROGRAM("assert(callbacks:watch(emu.memory.wram, emu.memory.wram:size() - 2, 4, function() end) == 0)");
+
+	TEST_PROGRAM("callbacks:remove(id)");
+	core->busWrite8(core, RAM_BASE + 16, 3);
+	core->busWrite8(core, RAM_BASE + 24, 4);
+	core->runFrame(core);
+	TEST_VALUE(S32, "hits", 1);
+	TEST_VALUE(S32, "other", 2);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(logging) {
 	SETUP_LUA;
 	struct mScriptTestLogger logger;
@@ -328,6 +442,102 @@ M_TEST_DEFINE(screenshot) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(frameView) {
+	SETUP_LUA;
+	CREATE_CORE;
+	mColor* buffer = malloc(240 * 160 * sizeof(mColor));
+	core->setVideoBuffer(core, buffer, 240);
+	core->reset(core);
+	core->runFrame(core);
+
+	TEST_PROGRAM("view = emu:frameView()");
+	TEST_PROGRAM("assert(view)");
+	TEST_PROGRAM("im = emu:screenshotToImage()");
+	TEST_PROGRAM("assert(view.width == im.width)");
+	TEST_PROGRAM("assert(view.height == im.height)");
+	TEST_PROGRAM("assert(view:hash() == im:hash())");
+	TEST_PROGRAM("assert(im:compare(view) == 0)");
+	TEST_PROGRAM("im:drawImageOpaque(view, 0, 0)");
+
+	// The view is read-only
+	LOAD_PROGRAM("view:setPixel(0, 0, 0xFFFFFFFF)");
+	assert_false(lua->run(lua));
+
+	buffer[0] ^= 0xFFFFFF;
+	TEST_PROGRAM("assert(emu:frameView():compare(im) == 1)");
+
+	// Views end with the frame, since the buffer may be replaced afterwards
+	core->runFrame(core);
+	LOAD_PROGRAM("assert(view.width)");
+	assert_false(lua->run(lua));
+	TEST_PROGRAM("view = emu:frameView()");
+	TEST_PROGRAM("assert(view.width == im.width)");
+
+	mScriptContextDetachCore(&context);
+	LOAD_PROGRAM("assert(view.width)");
+	assert_false(lua->run(lua));
+
+	free(buffer);
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
+M_TEST_DEFINE(stateJournal) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	remove(JOURNAL_PATH);
+	struct mScriptValue base = mSCRIPT_MAKE_S32(RAM_BASE);
+	lua->setGlobal(lua, "base", &base);
+	TEST_PROGRAM("path = '" JOURNAL_PATH "'");
+
+	// Nothing works until a journal is open
+	TEST_PROGRAM("assert(emu:journalSize() == 0)");
+	TEST_PROGRAM("assert(not emu:appendJournal())");
+	TEST_PROGRAM("assert(not emu:flushJournal())");
+	TEST_PROGRAM("assert(not emu:restoreJournal(0))");
+
+	TEST_PROGRAM("assert(emu:openJournal(path))");
+	TEST_PROGRAM(
+		"for i = 1, 5 do\n"
+		"	emu:write32(base, i)\n"
+		"	assert(emu:appendJournal())\n"
+		"end"
+	);
+	TEST_PROGRAM("assert(emu:journalSize() == 5)");
+	TEST_PROGRAM("assert(emu:flushJournal())");
+	TEST_PROGRAM("assert(emu:restoreJournal(2))");
+	TEST_PROGRAM("assert(emu:read32(base) == 3)");
+	TEST_PROGRAM("assert(not emu:restoreJournal(5))");
+	TEST_PROGRAM("assert(emu:closeJournal())");
+	TEST_PROGRAM("assert(emu:journalSize() == 0)");
+
+	// Reopening picks up where the journal left off
+	TEST_PROGRAM("assert(emu:openJournal(path))");
+	TEST_PROGRAM("assert(emu:journalSize() == 5)");
+	TEST_PROGRAM("emu:write32(base, 6)");
+	TEST_PROGRAM("assert(emu:appendJournal())");
+	TEST_PROGRAM("assert(emu:restoreJournal(4))");
+	TEST_PROGRAM("assert(emu:read32(base) == 5)");
+	TEST_PROGRAM("assert(emu:restoreJournal(5))");
+	TEST_PROGRAM("assert(emu:read32(base) == 6)");
+
+	// Detaching the core closes the journal, keeping what was appended
+	mScriptContextDetachCore(&context);
+	struct VFile* vf = VFileOpen(JOURNAL_PATH, O_RDONLY);
+	assert_non_null(vf);
+	struct mStateJournal journal;
+	assert_true(mStateJournalOpen(&journal, vf));
+	assert_int_equal(mStateJournalCount(&journal), 6);
+	assert_true(mStateJournalClose(&journal));
+	vf->close(vf);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+	remove(JOURNAL_PATH);
+}
+
 #ifdef ENABLE_DEBUGGERS
 void _setupBp(struct mCore* core) {
 	switch (core->platform(core)) {
@@ -857,9 +1067,14 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptCore,
 	cmocka_unit_test(detach),
 	cmocka_unit_test(runFrame),
 	cmocka_unit_test(memoryRead),
+	cmocka_unit_test(memoryReadBulk),
+	cmocka_unit_test(memoryReadBenchmark),
 	cmocka_unit_test(memoryWrite),
+	cmocka_unit_test(memoryWatch),
 	cmocka_unit_test(logging),
 	cmocka_unit_test(screenshot),
+	cmocka_unit_test(frameView),
+	cmocka_unit_test(stateJournal),
 #ifdef ENABLE_DEBUGGERS
 #ifdef M_CORE_GBA
 	cmocka_unit_test(basicBreakpointGBA),
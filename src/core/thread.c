@@ -11,6 +11,8 @@
 #include <mgba/core/scripting.h>
 #endif
 #include <mgba/core/serialize.h>
+#include <mgba-util/audio-buffer.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/patch.h>
 #include <mgba-util/vfs.h>
 
@@ -144,7 +146,7 @@ static void _cancelRequest(struct mCoreThreadInternal* threadContext, enum mCore
 
 void _frameStarted(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->runAheadSpeculative || thread->impl->rewind.seeking) {
 		return;
 	}
 	if (thread->core->opts.rewindEnable && thread->core->opts.rewindBufferCapacity > 0) {
@@ -160,7 +162,7 @@ void _frameStarted(void* context) {
 
 void _frameEnded(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->frameHidden) {
 		return;
 	}
 	if (thread->frameCallback) {
@@ -170,7 +172,7 @@ void _frameEnded(void* context) {
 
 void _crashed(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->runAheadSpeculative) {
 		return;
 	}
 	MutexLock(&thread->impl->stateMutex);
@@ -180,7 +182,7 @@ void _crashed(void* context) {
 
 void _coreSleep(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->runAheadSpeculative) {
 		return;
 	}
 	if (thread->sleepCallback) {
@@ -190,7 +192,7 @@ void _coreSleep(void* context) {
 
 void _coreShutdown(void* context) {
 	struct mCoreThread* thread = context;
-	if (!thread) {
+	if (!thread || thread->impl->runAheadSpeculative) {
 		return;
 	}
 	MutexLock(&thread->impl->stateMutex);
@@ -198,6 +200,109 @@ void _coreShutdown(void* context) {
 	MutexUnlock(&thread->impl->stateMutex);
 }
 
+static bool _canRunAhead(struct mCoreThread* threadContext) {
+	return threadContext->core->opts.runAhead > 0 && !threadContext->impl->rewinding;
+}
+
+static void _dropRunAheadSavedata(struct mCoreThreadInternal* impl) {
+	free(impl->runAheadSavedata);
+	impl->runAheadSavedata = NULL;
+	impl->runAheadSavedataSize = 0;
+}
+
+static void _setSpeculative(struct mCoreThread* threadContext, bool speculative) {
+	threadContext->impl->runAheadSpeculative = speculative;
+#ifdef ENABLE_SCRIPTING
+	if (threadContext->scriptContext) {
+		threadContext->scriptContext->speculative = speculative;
+	}
+#endif
+}
+
+static bool _runAheadFrame(struct mCoreThread* threadContext) {
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	size_t stateSize = core->stateSize(core);
+	if (impl->runAheadStateSize < stateSize) {
+		if (impl->runAheadState) {
+			mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		}
+		impl->runAheadState = anonymousMemoryMap(stateSize);
+		if (!impl->runAheadState) {
+			impl->runAheadStateSize = 0;
+			mLOG(STATUS, ERROR, "Could not allocate run-ahead state, disabling run-ahead");
+			core->opts.runAhead = 0;
+			return false;
+		}
+		impl->runAheadStateSize = stateSize;
+	}
+
+	// The real frame and the frames run ahead of it are kept from the frontend,
+	// which only gets to see the last one. Only that one is rendered, the sync
+	// is detached so none of them block on video or audio, and the audio lock
+	// is held so the samples of the speculative frames can be dropped again
+	// without racing the consumer.
+	struct mAudioBuffer* audio = core->getAudioBuffer(core);
+	mCoreSyncLockAudio(&impl->sync);
+	core->setSync(core, NULL);
+	if (core->skipFrames) {
+		core->skipFrames(core, core->opts.runAhead);
+	}
+	impl->frameHidden = true;
+	core->runFrame(core);
+
+	mCoreSaveStateBuffer(core, impl->runAheadState, stateSize, 0);
+	// Savedata isn't part of the state that gets loaded back, so keep a copy
+	// in case the speculative frames write to it. The copy is only refreshed
+	// once the real frames have written to the savedata themselves.
+	uint64_t stamp = 0;
+	if (core->savedataStamp) {
+		stamp = core->savedataStamp(core);
+		if (impl->runAheadSavedata && stamp != impl->runAheadSavedataStamp) {
+			_dropRunAheadSavedata(impl);
+		}
+	} else {
+		_dropRunAheadSavedata(impl);
+	}
+	if (!impl->runAheadSavedata) {
+		impl->runAheadSavedataSize = core->savedataClone(core, &impl->runAheadSavedata);
+		impl->runAheadSavedataStamp = stamp;
+	}
+	struct mAudioBuffer realAudio = *audio;
+	_setSpeculative(threadContext, true);
+	int i;
+	for (i = 0; i < core->opts.runAhead; ++i) {
+		core->runFrame(core);
+	}
+	*audio = realAudio;
+
+	core->setSync(core, &impl->sync);
+	mCoreSyncProduceAudio(&impl->sync, audio);
+	if (threadContext->frameCallback) {
+		threadContext->frameCallback(threadContext);
+	}
+	mCoreSyncPostFrame(&impl->sync);
+
+	mCoreLoadStateBuffer(core, impl->runAheadState, stateSize, 0);
+	if (impl->runAheadSavedataSize) {
+		if (!core->savedataStamp) {
+			void* speculated = NULL;
+			size_t speculatedSize = core->savedataClone(core, &speculated);
+			if (speculatedSize != impl->runAheadSavedataSize || memcmp(speculated, impl->runAheadSavedata, speculatedSize) != 0) {
+				core->savedataRestore(core, impl->runAheadSavedata, impl->runAheadSavedataSize, true);
+			}
+			free(speculated);
+		} else if (core->savedataStamp(core) != stamp) {
+			core->savedataRestore(core, impl->runAheadSavedata, impl->runAheadSavedataSize, true);
+			// The stamp can't be trusted to move on the next real write anymore
+			_dropRunAheadSavedata(impl);
+		}
+	}
+	_setSpeculative(threadContext, false);
+	impl->frameHidden = false;
+	return true;
+}
+
 static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	struct mCoreThread* threadContext = context;
 #ifdef USE_PTHREADS
@@ -296,9 +401,15 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 		{
 			while (impl->state == mTHREAD_RUNNING) {
 				MutexUnlock(&impl->stateMutex);
-				core->runLoop(core);
+				if (!_canRunAhead(threadContext) || !_runAheadFrame(threadContext)) {
+					_dropRunAheadSavedata(impl);
+					core->runLoop(core);
+				}
 				MutexLock(&impl->stateMutex);
 			}
+			// Savedata can be swapped out from under the core while the
+			// thread isn't running, so don't trust the run-ahead copy
+			_dropRunAheadSavedata(impl);
 		}
 
 		while (impl->state >= mTHREAD_MIN_WAITING && impl->state < mTHREAD_EXITING) {
@@ -390,6 +501,12 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	if (core->opts.rewindEnable) {
 		 mCoreRewindContextDeinit(&impl->rewind);
 	}
+	if (impl->runAheadState) {
+		mappedMemoryFree(impl->runAheadState, impl->runAheadStateSize);
+		impl->runAheadState = NULL;
+		impl->runAheadStateSize = 0;
+	}
+	_dropRunAheadSavedata(impl);
 
 	if (threadContext->cleanCallback) {
 		threadContext->cleanCallback(threadContext);
@@ -675,10 +792,30 @@ void mCoreThreadSetRewinding(struct mCoreThread* threadContext, bool rewinding)
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
+bool mCoreThreadRewindSeek(struct mCoreThread* threadContext, unsigned count) {
+	// The thread must be interrupted, or this must be called from it. The frame
+	// drawn at the target is kept away from the sync and the frame callback, so
+	// the caller has to pick the picture up, and its audio is dropped.
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCore* core = threadContext->core;
+	struct mAudioBuffer* audio = core->getAudioBuffer(core);
+	mCoreSyncLockAudio(&impl->sync);
+	struct mAudioBuffer oldAudio = *audio;
+	core->setSync(core, NULL);
+	impl->frameHidden = true;
+	bool success = mCoreRewindSeek(&impl->rewind, core, count);
+	impl->frameHidden = false;
+	core->setSync(core, &impl->sync);
+	*audio = oldAudio;
+	mCoreSyncUnlockAudio(&impl->sync);
+	return success;
+}
+
 void mCoreThreadRewindParamsChanged(struct mCoreThread* threadContext) {
 	struct mCore* core = threadContext->core;
 	if (core->opts.rewindEnable && core->opts.rewindBufferCapacity > 0) {
 		 mCoreRewindContextInit(&threadContext->impl->rewind, core->opts.rewindBufferCapacity, true);
+		 mCoreRewindContextSetBudget(&threadContext->impl->rewind, (size_t) core->opts.rewindBufferMemory << 20);
 	} else {
 		 mCoreRewindContextDeinit(&threadContext->impl->rewind);
 	}
@@ -0,0 +1,412 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/movie.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/vfs.h>
+
+#define MOVIE_MAGIC "mGBAMOVI"
+#define MOVIE_VERSION 1
+
+// Savedata is part of each keyframe so replays don't depend on the save
+// file, but it's never written back to the save file when loading one
+#define KEYFRAME_SAVE_FLAGS (SAVESTATE_SAVEDATA | SAVESTATE_RTC)
+#define KEYFRAME_LOAD_FLAGS SAVESTATE_RTC
+
+struct mMovieHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t platform;
+	uint32_t crc32;
+	uint32_t keyframeInterval;
+	uint32_t frames;
+	uint32_t changes;
+	uint32_t keyframes;
+	uint32_t reserved;
+};
+
+struct mMovieKeyframeHeader {
+	uint32_t frame;
+	uint32_t size;
+	uint64_t offset;
+};
+
+DEFINE_VECTOR(mMovieKeyframeList, struct mMovieKeyframe);
+DEFINE_VECTOR(mMovieKeyChangeList, struct mMovieKeyChange);
+
+static void _mMovieKeysRead(void* context);
+static void _mMovieFrameEnded(void* context);
+
+void mMovieInit(struct mMovie* movie) {
+	memset(movie, 0, sizeof(*movie));
+	movie->keyframeInterval = mMOVIE_KEYFRAME_INTERVAL;
+	UInt32ListInit(&movie->keys, 0);
+	mMovieKeyChangeListInit(&movie->changes, 0);
+	mMovieKeyframeListInit(&movie->keyframes, 0);
+}
+
+static void _clearKeyframes(struct mMovie* movie, size_t first) {
+	size_t i;
+	for (i = first; i < mMovieKeyframeListSize(&movie->keyframes); ++i) {
+		struct mMovieKeyframe* keyframe = mMovieKeyframeListGetPointer(&movie->keyframes, i);
+		keyframe->state->close(keyframe->state);
+	}
+	mMovieKeyframeListResize(&movie->keyframes, (ssize_t) first - (ssize_t) mMovieKeyframeListSize(&movie->keyframes));
+}
+
+void mMovieDeinit(struct mMovie* movie) {
+	_clearKeyframes(movie, 0);
+	UInt32ListDeinit(&movie->keys);
+	mMovieKeyChangeListDeinit(&movie->changes);
+	mMovieKeyframeListDeinit(&movie->keyframes);
+}
+
+void mMovieAttach(struct mMovie* movie, struct mCore* core) {
+	movie->core = core;
+	movie->callbacks = (struct mCoreCallbacks) {
+		.context = movie,
+		.keysRead = _mMovieKeysRead,
+		.videoFrameEnded = _mMovieFrameEnded,
+	};
+	core->addCoreCallbacks(core, &movie->callbacks);
+}
+
+static bool _addKeyframe(struct mMovie* movie) {
+	struct VFile* state = VFileMemChunk(NULL, 0);
+	if (!state) {
+		return false;
+	}
+	if (!mCoreSaveStateNamed(movie->core, state, KEYFRAME_SAVE_FLAGS)) {
+		state->close(state);
+		return false;
+	}
+	struct mMovieKeyframe* keyframe = mMovieKeyframeListAppend(&movie->keyframes);
+	keyframe->frame = movie->frame;
+	keyframe->state = state;
+	return true;
+}
+
+static void _startFrame(struct mMovie* movie) {
+	movie->reads = 0;
+	if (movie->mode == mMOVIE_PLAYING) {
+		movie->frameKeys = *UInt32ListGetPointer(&movie->keys, movie->frame);
+		movie->lastKeys = movie->frameKeys;
+		movie->core->setKeys(movie->core, movie->frameKeys);
+	}
+}
+
+static void _mMovieKeysRead(void* context) {
+	struct mMovie* movie = context;
+	struct mCore* core = movie->core;
+	uint32_t read = movie->reads;
+	uint32_t keys;
+	switch (movie->mode) {
+	case mMOVIE_RECORDING:
+		keys = core->getKeys(core);
+		if (!read) {
+			movie->frameKeys = keys;
+		} else if (keys != movie->lastKeys) {
+			*mMovieKeyChangeListAppend(&movie->changes) = (struct mMovieKeyChange) {
+				.frame = movie->frame,
+				.read = read,
+				.keys = keys,
+			};
+		}
+		movie->lastKeys = keys;
+		break;
+	case mMOVIE_PLAYING:
+		while (movie->nextChange < mMovieKeyChangeListSize(&movie->changes)) {
+			const struct mMovieKeyChange* change = mMovieKeyChangeListGetConstPointer(&movie->changes, movie->nextChange);
+			if (change->frame != movie->frame || change->read != read) {
+				break;
+			}
+			movie->lastKeys = change->keys;
+			++movie->nextChange;
+		}
+		core->setKeys(core, movie->lastKeys);
+		break;
+	case mMOVIE_IDLE:
+		return;
+	}
+	++movie->reads;
+}
+
+static void _mMovieFrameEnded(void* context) {
+	struct mMovie* movie = context;
+	switch (movie->mode) {
+	case mMOVIE_RECORDING:
+		*UInt32ListAppend(&movie->keys) = movie->reads ? movie->frameKeys : movie->core->getKeys(movie->core);
+		++movie->frame;
+		if (movie->keyframeInterval && !(movie->frame % movie->keyframeInterval)) {
+			_addKeyframe(movie);
+		}
+		break;
+	case mMOVIE_PLAYING:
+		++movie->frame;
+		if (movie->frame >= UInt32ListSize(&movie->keys)) {
+			movie->mode = mMOVIE_IDLE;
+		}
+		break;
+	case mMOVIE_IDLE:
+		return;
+	}
+	_startFrame(movie);
+}
+
+bool mMovieRecord(struct mMovie* movie) {
+	if (!movie->core) {
+		return false;
+	}
+	struct mCore* core = movie->core;
+	_clearKeyframes(movie, 0);
+	UInt32ListClear(&movie->keys);
+	mMovieKeyChangeListClear(&movie->changes);
+	movie->platform = core->platform(core);
+	movie->crc32 = 0;
+	core->checksum(core, &movie->crc32, mCHECKSUM_CRC32);
+	movie->frame = 0;
+	movie->nextChange = 0;
+	if (!_addKeyframe(movie)) {
+		movie->mode = mMOVIE_IDLE;
+		return false;
+	}
+	movie->mode = mMOVIE_RECORDING;
+	_startFrame(movie);
+	return true;
+}
+
+bool mMoviePlay(struct mMovie* movie) {
+	if (!movie->core || !UInt32ListSize(&movie->keys)) {
+		return false;
+	}
+	uint32_t crc32 = 0;
+	movie->core->checksum(movie->core, &crc32, mCHECKSUM_CRC32);
+	if (movie->platform != (uint32_t) movie->core->platform(movie->core) || movie->crc32 != crc32) {
+		return false;
+	}
+	movie->mode = mMOVIE_PLAYING;
+	if (!mMovieSeek(movie, 0)) {
+		movie->mode = mMOVIE_IDLE;
+		return false;
+	}
+	return true;
+}
+
+void mMovieStop(struct mMovie* movie) {
+	movie->mode = mMOVIE_IDLE;
+}
+
+bool mMovieSeek(struct mMovie* movie, uint32_t frame) {
+	size_t frames = UInt32ListSize(&movie->keys);
+	if (!movie->core || frame > frames || !mMovieKeyframeListSize(&movie->keyframes)) {
+		return false;
+	}
+	size_t i;
+	for (i = mMovieKeyframeListSize(&movie->keyframes); i > 1; --i) {
+		if (mMovieKeyframeListGetConstPointer(&movie->keyframes, i - 1)->frame <= frame) {
+			break;
+		}
+	}
+	const struct mMovieKeyframe* keyframe = mMovieKeyframeListGetConstPointer(&movie->keyframes, i - 1);
+	if (!mCoreLoadStateNamed(movie->core, keyframe->state, KEYFRAME_LOAD_FLAGS)) {
+		return false;
+	}
+
+	// Replay recorded input from the keyframe up to the target frame
+	enum mMovieMode mode = movie->mode;
+	movie->frame = keyframe->frame;
+	for (movie->nextChange = 0; movie->nextChange < mMovieKeyChangeListSize(&movie->changes); ++movie->nextChange) {
+		if (mMovieKeyChangeListGetConstPointer(&movie->changes, movie->nextChange)->frame >= movie->frame) {
+			break;
+		}
+	}
+	if (movie->frame < frames) {
+		movie->mode = mMOVIE_PLAYING;
+		_startFrame(movie);
+		while (movie->frame < frame) {
+			movie->core->runFrame(movie->core);
+		}
+	}
+	movie->mode = mode;
+
+	switch (mode) {
+	case mMOVIE_RECORDING:
+		// Recording continues from here, replacing everything after it
+		UInt32ListResize(&movie->keys, (ssize_t) frame - (ssize_t) frames);
+		for (i = movie->nextChange; i < mMovieKeyChangeListSize(&movie->changes); ++i) {
+			if (mMovieKeyChangeListGetConstPointer(&movie->changes, i)->frame >= frame) {
+				break;
+			}
+		}
+		mMovieKeyChangeListResize(&movie->changes, (ssize_t) i - (ssize_t) mMovieKeyChangeListSize(&movie->changes));
+		for (i = 0; i < mMovieKeyframeListSize(&movie->keyframes); ++i) {
+			if (mMovieKeyframeListGetConstPointer(&movie->keyframes, i)->frame > frame) {
+				break;
+			}
+		}
+		_clearKeyframes(movie, i);
+		break;
+	case mMOVIE_PLAYING:
+		if (frame >= frames) {
+			movie->mode = mMOVIE_IDLE;
+		}
+		break;
+	case mMOVIE_IDLE:
+		break;
+	}
+	_startFrame(movie);
+	return true;
+}
+
+size_t mMovieFrameCount(const struct mMovie* movie) {
+	return UInt32ListSize(&movie->keys);
+}
+
+bool mMovieLoad(struct mMovie* movie, struct VFile* vf) {
+	struct mMovieHeader header;
+	if (vf->seek(vf, 0, SEEK_SET) < 0 || vf->read(vf, &header, sizeof(header)) != sizeof(header) ||
+	    memcmp(header.magic, MOVIE_MAGIC, sizeof(header.magic)) != 0) {
+		return false;
+	}
+	uint32_t version;
+	uint32_t frames;
+	uint32_t changes;
+	uint32_t keyframes;
+	LOAD_32LE(version, 0, &header.version);
+	LOAD_32LE(frames, 0, &header.frames);
+	LOAD_32LE(changes, 0, &header.changes);
+	LOAD_32LE(keyframes, 0, &header.keyframes);
+	ssize_t size = vf->size(vf);
+	if (version != MOVIE_VERSION || !keyframes || size < 0 ||
+	    sizeof(header) + (uint64_t) frames * 4 + (uint64_t) changes * 12 + (uint64_t) keyframes * sizeof(struct mMovieKeyframeHeader) > (uint64_t) size) {
+		return false;
+	}
+
+	movie->mode = mMOVIE_IDLE;
+	_clearKeyframes(movie, 0);
+	LOAD_32LE(movie->platform, 0, &header.platform);
+	LOAD_32LE(movie->crc32, 0, &header.crc32);
+	LOAD_32LE(movie->keyframeInterval, 0, &header.keyframeInterval);
+	UInt32ListResize(&movie->keys, (ssize_t) frames - (ssize_t) UInt32ListSize(&movie->keys));
+	mMovieKeyChangeListResize(&movie->changes, (ssize_t) changes - (ssize_t) mMovieKeyChangeListSize(&movie->changes));
+
+	bool success = vf->read(vf, UInt32ListGetPointer(&movie->keys, 0), frames * 4) == frames * 4;
+	size_t i;
+	for (i = 0; success && i < frames; ++i) {
+		uint32_t* keys = UInt32ListGetPointer(&movie->keys, i);
+		LOAD_32LE(*keys, 0, keys);
+	}
+	for (i = 0; success && i < changes; ++i) {
+		uint32_t buffer[3];
+		struct mMovieKeyChange* change = mMovieKeyChangeListGetPointer(&movie->changes, i);
+		success = vf->read(vf, buffer, sizeof(buffer)) == sizeof(buffer);
+		LOAD_32LE(change->frame, 0, &buffer[0]);
+		LOAD_32LE(change->read, 0, &buffer[1]);
+		LOAD_32LE(change->keys, 0, &buffer[2]);
+	}
+
+	struct mMovieKeyframeHeader* headers = calloc(keyframes, sizeof(*headers));
+	success = success && headers && vf->read(vf, headers, keyframes * sizeof(*headers)) == (ssize_t) (keyframes * sizeof(*headers));
+	for (i = 0; success && i < keyframes; ++i) {
+		uint32_t frame;
+		uint32_t stateSize;
+		uint64_t offset;
+		LOAD_32LE(frame, 0, &headers[i].frame);
+		LOAD_32LE(stateSize, 0, &headers[i].size);
+		LOAD_64LE(offset, 0, &headers[i].offset);
+		if (frame > frames || (i && frame <= mMovieKeyframeListGetConstPointer(&movie->keyframes, i - 1)->frame) ||
+		    offset > (uint64_t) size || stateSize > size - offset) {
+			success = false;
+			break;
+		}
+		struct VFile* state = VFileMemChunk(NULL, stateSize);
+		if (!state) {
+			success = false;
+			break;
+		}
+		void* data = state->map(state, stateSize, MAP_WRITE);
+		success = vf->seek(vf, offset, SEEK_SET) >= 0 && vf->read(vf, data, stateSize) == (ssize_t) stateSize;
+		state->unmap(state, data, stateSize);
+		struct mMovieKeyframe* keyframe = mMovieKeyframeListAppend(&movie->keyframes);
+		keyframe->frame = frame;
+		keyframe->state = state;
+	}
+	free(headers);
+	if (!success || mMovieKeyframeListGetConstPointer(&movie->keyframes, 0)->frame != 0) {
+		_clearKeyframes(movie, 0);
+		UInt32ListClear(&movie->keys);
+		mMovieKeyChangeListClear(&movie->changes);
+		return false;
+	}
+	return true;
+}
+
+bool mMovieSave(const struct mMovie* movie, struct VFile* vf) {
+	struct mMovieHeader header = {0};
+	uint32_t frames = UInt32ListSize(&movie->keys);
+	uint32_t changes = mMovieKeyChangeListSize(&movie->changes);
+	uint32_t keyframes = mMovieKeyframeListSize(&movie->keyframes);
+	memcpy(header.magic, MOVIE_MAGIC, sizeof(header.magic));
+	STORE_32LE(MOVIE_VERSION, 0, &header.version);
+	STORE_32LE(movie->platform, 0, &header.platform);
+	STORE_32LE(movie->crc32, 0, &header.crc32);
+	STORE_32LE(movie->keyframeInterval, 0, &header.keyframeInterval);
+	STORE_32LE(frames, 0, &header.frames);
+	STORE_32LE(changes, 0, &header.changes);
+	STORE_32LE(keyframes, 0, &header.keyframes);
+	if (vf->seek(vf, 0, SEEK_SET) < 0) {
+		return false;
+	}
+	vf->truncate(vf, 0);
+	if (vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	size_t i;
+	for (i = 0; i < frames; ++i) {
+		uint32_t keys;
+		STORE_32LE(*UInt32ListGetConstPointer(&movie->keys, i), 0, &keys);
+		if (vf->write(vf, &keys, sizeof(keys)) != sizeof(keys)) {
+			return false;
+		}
+	}
+	for (i = 0; i < changes; ++i) {
+		const struct mMovieKeyChange* change = mMovieKeyChangeListGetConstPointer(&movie->changes, i);
+		uint32_t buffer[3];
+		STORE_32LE(change->frame, 0, &buffer[0]);
+		STORE_32LE(change->read, 0, &buffer[1]);
+		STORE_32LE(change->keys, 0, &buffer[2]);
+		if (vf->write(vf, buffer, sizeof(buffer)) != sizeof(buffer)) {
+			return false;
+		}
+	}
+
+	uint64_t offset = vf->seek(vf, 0, SEEK_CUR) + keyframes * sizeof(struct mMovieKeyframeHeader);
+	for (i = 0; i < keyframes; ++i) {
+		const struct mMovieKeyframe* keyframe = mMovieKeyframeListGetConstPointer(&movie->keyframes, i);
+		struct mMovieKeyframeHeader buffer;
+		uint32_t stateSize = keyframe->state->size(keyframe->state);
+		STORE_32LE(keyframe->frame, 0, &buffer.frame);
+		STORE_32LE(stateSize, 0, &buffer.size);
+		STORE_64LE(offset, 0, &buffer.offset);
+		if (vf->write(vf, &buffer, sizeof(buffer)) != sizeof(buffer)) {
+			return false;
+		}
+		offset += stateSize;
+	}
+	for (i = 0; i < keyframes; ++i) {
+		struct VFile* state = mMovieKeyframeListGetConstPointer(&movie->keyframes, i)->state;
+		size_t stateSize = state->size(state);
+		void* data = state->map(state, stateSize, MAP_READ);
+		bool success = vf->write(vf, data, stateSize) == (ssize_t) stateSize;
+		state->unmap(state, data, stateSize);
+		if (!success) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -747,6 +747,11 @@ static void _GBCoreStep(struct mCore* core) {
 	} while (cpu->executionState != SM83_CORE_FETCH);
 }
 
+static void _GBCoreSkipFrames(struct mCore* core, int frames) {
+	struct GB* gb = core->board;
+	gb->video.frameskipCounter = frames;
+}
+
 static size_t _GBCoreStateSize(struct mCore* core) {
 	UNUSED(core);
 	return sizeof(struct GBSerializedState);
@@ -1227,6 +1232,12 @@ static bool _GBCoreSavedataRestore(struct mCore* core, const void* sram, size_t
 	return true;
 }
 
+static uint64_t _GBCoreSavedataStamp(struct mCore* core) {
+	struct GB* gb = core->board;
+	// Frames that write savedata move the dirt age to their frame count
+	return ((uint64_t) gb->sramDirtAge << 2) | gb->sramDirty;
+}
+
 static size_t _GBCoreListVideoLayers(const struct mCore* core, const struct mCoreChannelInfo** info) {
 	UNUSED(core);
 	if (info) {
@@ -1365,9 +1376,11 @@ struct mCore* GBCoreCreate(void) {
 	core->runFrame = _GBCoreRunFrame;
 	core->runLoop = _GBCoreRunLoop;
 	core->step = _GBCoreStep;
+	core->skipFrames = _GBCoreSkipFrames;
 	core->stateSize = _GBCoreStateSize;
 	core->loadState = _GBCoreLoadState;
 	core->saveState = _GBCoreSaveState;
+	core->saveStateIncremental = NULL;
 	core->loadExtraState = _GBCoreLoadExtraState;
 	core->saveExtraState = _GBCoreSaveExtraState;
 	core->setKeys = _GBCoreSetKeys;
@@ -1394,6 +1407,8 @@ struct mCore* GBCoreCreate(void) {
 	core->rawWrite32 = _GBCoreRawWrite32;
 	core->listMemoryBlocks = _GBListMemoryBlocks;
 	core->getMemoryBlock = _GBGetMemoryBlock;
+	core->collectMemoryStores = NULL;
+	core->memoryBlockStoredSince = NULL;
 	core->listRegisters = _GBCoreListRegisters;
 	core->readRegister = _GBCoreReadRegister;
 	core->writeRegister = _GBCoreWriteRegister;
@@ -1409,6 +1424,7 @@ struct mCore* GBCoreCreate(void) {
 	core->cheatDevice = _GBCoreCheatDevice;
 	core->savedataClone = _GBCoreSavedataClone;
 	core->savedataRestore = _GBCoreSavedataRestore;
+	core->savedataStamp = _GBCoreSavedataStamp;
 	core->listVideoLayers = _GBCoreListVideoLayers;
 	core->listAudioChannels = _GBCoreListAudioChannels;
 	core->enableVideoLayer = _GBCoreEnableVideoLayer;
@@ -909,9 +909,46 @@ static void GBVideoSoftwareRendererEnableSGBBorder(struct GBVideoRenderer* rende
 	}
 }
 
+static inline uint64_t _spreadTileBits(uint8_t bits, bool xFlip) {
+	uint64_t spread = bits * 0x0101010101010101ULL;
+	spread &= xFlip ? 0x8040201008040201ULL : 0x0102040810204080ULL;
+	return ((spread + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
+
+// Decodes a 2bpp tile row into eight color indices, one per byte, leftmost pixel in the lowest byte
+static inline uint64_t _decodeTileRow(const uint8_t* tileRow, bool xFlip) {
+	return _spreadTileBits(tileRow[0], xFlip) | (_spreadTileBits(tileRow[1], xFlip) << 1);
+}
+
+static inline uint64_t _fetchBackgroundTile(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, uint8_t* data, int topX, int topY, int bottomY, unsigned* p) {
+	uint8_t* attr = &maps[GB_SIZE_VRAM_BANK0];
+	int localY = bottomY;
+	bool xFlip = false;
+	int bgTile;
+	if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
+		bgTile = maps[topX + topY];
+	} else {
+		bgTile = ((int8_t*) maps)[topX + topY];
+	}
+	if (renderer->model >= GB_MODEL_CGB) {
+		GBObjAttributes attrs = attr[topX + topY];
+		*p |= GBObjAttributesGetCGBPalette(attrs) * 4;
+		if (GBObjAttributesIsPriority(attrs) && GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
+			*p |= OBJ_PRIORITY;
+		}
+		if (GBObjAttributesIsBank(attrs)) {
+			data += GB_SIZE_VRAM_BANK0;
+		}
+		if (GBObjAttributesIsYFlip(attrs)) {
+			localY = 7 - bottomY;
+		}
+		xFlip = GBObjAttributesIsXFlip(attrs);
+	}
+	return _decodeTileRow(&data[(bgTile * 8 + localY) * 2], xFlip);
+}
+
 static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, int startX, int endX, int sx, int sy, bool highlight) {
 	uint8_t* data = renderer->d.vram;
-	uint8_t* attr = &maps[GB_SIZE_VRAM_BANK0];
 	if (!GBRegisterLCDCIsTileData(renderer->lcdc)) {
 		data += 0x1000;
 	}
@@ -921,91 +958,29 @@ static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer
 		startX = 0;
 	}
 	int x;
+	uint64_t pixels;
+	unsigned p;
 	if ((startX + sx) & 7) {
 		int startX2 = startX + 8 - ((startX + sx) & 7);
-		for (x = startX; x < startX2; ++x) {
-			uint8_t* localData = data;
-			int localY = bottomY;
-			int topX = ((x + sx) >> 3) & 0x1F;
-			int bottomX = 7 - ((x + sx) & 7);
-			int bgTile;
-			if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
-				bgTile = maps[topX + topY];
-			} else {
-				bgTile = ((int8_t*) maps)[topX + topY];
-			}
-			int p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
-			if (renderer->model >= GB_MODEL_CGB) {
-				GBObjAttributes attrs = attr[topX + topY];
-				p |= GBObjAttributesGetCGBPalette(attrs) * 4;
-				if (GBObjAttributesIsPriority(attrs) && GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
-					p |= OBJ_PRIORITY;
-				}
-				if (GBObjAttributesIsBank(attrs)) {
-					localData += GB_SIZE_VRAM_BANK0;
-				}
-				if (GBObjAttributesIsYFlip(attrs)) {
-					localY = 7 - bottomY;
-				}
-				if (GBObjAttributesIsXFlip(attrs)) {
-					bottomX = 7 - bottomX;
-				}
-			}
-			uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-			uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
+		p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
+		pixels = _fetchBackgroundTile(renderer, maps, data, ((startX + sx) >> 3) & 0x1F, topY, bottomY, &p);
+		pixels >>= ((startX + sx) & 7) * 8;
+		for (x = startX; x < startX2; ++x, pixels >>= 8) {
+			renderer->row[x] = p | (pixels & 3);
 		}
 		startX = startX2;
 	}
 	for (x = startX; x < endX; x += 8) {
-		uint8_t* localData = data;
-		int localY = bottomY;
-		int topX = ((x + sx) >> 3) & 0x1F;
-		int bgTile;
-		if (GBRegisterLCDCIsTileData(renderer->lcdc)) {
-			bgTile = maps[topX + topY];
-		} else {
-			bgTile = ((int8_t*) maps)[topX + topY];
-		}
-		int p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
-		if (renderer->model >= GB_MODEL_CGB) {
-			GBObjAttributes attrs = attr[topX + topY];
-			p |= GBObjAttributesGetCGBPalette(attrs) * 4;
-			if (GBObjAttributesIsPriority(attrs) && GBRegisterLCDCIsBgEnable(renderer->lcdc)) {
-				p |= OBJ_PRIORITY;
-			}
-			if (GBObjAttributesIsBank(attrs)) {
-				localData += GB_SIZE_VRAM_BANK0;
-			}
-			if (GBObjAttributesIsYFlip(attrs)) {
-				localY = 7 - bottomY;
-			}
-			if (GBObjAttributesIsXFlip(attrs)) {
-				uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-				uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-				renderer->row[x + 0] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-				renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-				renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-				renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-				renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-				renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-				renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-				renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-				continue;
-			}
-		}
-		uint8_t tileDataLower = localData[(bgTile * 8 + localY) * 2];
-		uint8_t tileDataUpper = localData[(bgTile * 8 + localY) * 2 + 1];
-		renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		renderer->row[x + 0] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+		p = highlight ? PAL_HIGHLIGHT_BG : PAL_BG;
+		pixels = _fetchBackgroundTile(renderer, maps, data, ((x + sx) >> 3) & 0x1F, topY, bottomY, &p);
+		renderer->row[x + 0] = p | (pixels & 3);
+		renderer->row[x + 1] = p | ((pixels >> 8) & 3);
+		renderer->row[x + 2] = p | ((pixels >> 16) & 3);
+		renderer->row[x + 3] = p | ((pixels >> 24) & 3);
+		renderer->row[x + 4] = p | ((pixels >> 32) & 3);
+		renderer->row[x + 5] = p | ((pixels >> 40) & 3);
+		renderer->row[x + 6] = p | ((pixels >> 48) & 3);
+		renderer->row[x + 7] = p | ((pixels >> 56) & 3);
 	}
 }
 
@@ -1057,96 +1032,23 @@ static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* rende
 	} else {
 		p |= (GBObjAttributesGetPalette(obj->obj.attr) + 8) * 4;
 	}
-	int bottomX;
-	int x = startX;
 	int objTile = obj->obj.tile + tileOffset;
-	if ((x - objX) & 7) {
-		for (; x < endX; ++x) {
-			if (GBObjAttributesIsXFlip(obj->obj.attr)) {
-				bottomX = (x - objX) & 7;
-			} else {
-				bottomX = 7 - ((x - objX) & 7);
-			}
-			uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-			uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-			tileDataUpper >>= bottomX;
-			tileDataLower >>= bottomX;
-			unsigned current = renderer->row[x];
-			if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-				renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-			}
-		}
-	} else if (GBObjAttributesIsXFlip(obj->obj.attr)) {
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		unsigned current;
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 1] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 6] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
-		}
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
-		}
-	} else {
-		uint8_t tileDataLower = data[(objTile * 8 + bottomY) * 2];
-		uint8_t tileDataUpper = data[(objTile * 8 + bottomY) * 2 + 1];
-		unsigned current;
-		current = renderer->row[x + 7];
-		if (((tileDataUpper | tileDataLower) & 1) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 7] = p | ((tileDataUpper & 1) << 1) | (tileDataLower & 1);
-		}
-		current = renderer->row[x + 6];
-		if (((tileDataUpper | tileDataLower) & 2) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 6] = p | (tileDataUpper & 2) | ((tileDataLower & 2) >> 1);
-		}
-		current = renderer->row[x + 5];
-		if (((tileDataUpper | tileDataLower) & 4) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 5] = p | ((tileDataUpper & 4) >> 1) | ((tileDataLower & 4) >> 2);
-		}
-		current = renderer->row[x + 4];
-		if (((tileDataUpper | tileDataLower) & 8) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 4] = p | ((tileDataUpper & 8) >> 2) | ((tileDataLower & 8) >> 3);
-		}
-		current = renderer->row[x + 3];
-		if (((tileDataUpper | tileDataLower) & 16) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 3] = p | ((tileDataUpper & 16) >> 3) | ((tileDataLower & 16) >> 4);
-		}
-		current = renderer->row[x + 2];
-		if (((tileDataUpper | tileDataLower) & 32) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 2] = p | ((tileDataUpper & 32) >> 4) | ((tileDataLower & 32) >> 5);
-		}
-		current = renderer->row[x + 1];
-		if (((tileDataUpper | tileDataLower) & 64) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x + 1] = p | ((tileDataUpper & 64) >> 5) | ((tileDataLower & 64) >> 6);
+	const uint8_t* tileRow = &data[(objTile * 8 + bottomY) * 2];
+	if (!(tileRow[0] | tileRow[1])) {
+		// Fully transparent row
+		return;
+	}
+	uint64_t pixels = _decodeTileRow(tileRow, GBObjAttributesIsXFlip(obj->obj.attr));
+	pixels >>= (startX - ix) * 8;
+	int x;
+	for (x = startX; x < endX; ++x, pixels >>= 8) {
+		unsigned color = pixels & 3;
+		if (!color) {
+			continue;
 		}
-		current = renderer->row[x];
-		if (((tileDataUpper | tileDataLower) & 128) && !(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
-			renderer->row[x] = p | ((tileDataUpper & 128) >> 6) | ((tileDataLower & 128) >> 7);
+		unsigned current = renderer->row[x];
+		if (!(current & mask) && (current & mask2) <= OBJ_PRIORITY) {
+			renderer->row[x] = p | color;
 		}
 	}
 }
@@ -54,6 +54,9 @@ static void _RegisterRamReset(struct GBA* gba) {
 	if (registers & 0x10) {
 		memset(gba->video.oam.raw, 0, GBA_SIZE_OAM);
 	}
+	if (registers & 0x0B) {
+		GBAMemoryMarkAllDirty(&gba->memory);
+	}
 	if (registers & 0x20) {
 		cpu->memory.store16(cpu, GBA_BASE_IO | GBA_REG_SIOCNT, 0x0000, 0);
 		cpu->memory.store16(cpu, GBA_BASE_IO | GBA_REG_RCNT, RCNT_INITIAL, 0);
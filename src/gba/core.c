@@ -860,6 +860,11 @@ static void _GBACoreStep(struct mCore* core) {
 	ARMRun(core->cpu);
 }
 
+static void _GBACoreSkipFrames(struct mCore* core, int frames) {
+	struct GBA* gba = core->board;
+	gba->video.frameskipCounter = frames;
+}
+
 static size_t _GBACoreStateSize(struct mCore* core) {
 	UNUSED(core);
 	return sizeof(struct GBASerializedState);
@@ -874,6 +879,11 @@ static bool _GBACoreSaveState(struct mCore* core, void* state) {
 	return true;
 }
 
+static bool _GBACoreSaveStateIncremental(struct mCore* core, void* state, uint32_t* epoch, uint32_t* changedPages) {
+	*epoch = GBASerializeIncremental(core->board, state, *epoch, changedPages);
+	return true;
+}
+
 static bool _GBACoreLoadExtraState(struct mCore* core, const struct mStateExtdata* extdata) {
 	struct GBA* gba = core->board;
 	struct mStateExtdataItem item;
@@ -882,7 +892,7 @@ static bool _GBACoreLoadExtraState(struct mCore* core, const struct mStateExtdat
 		if ((uint32_t) item.size > sizeof(uint32_t)) {
 			uint32_t type;
 			LOAD_32(type, 0, item.data);
-			if (type == gba->video.renderer->rendererId(gba->video.renderer)) {
+			if (gba->video.renderer->rendererId && type == gba->video.renderer->rendererId(gba->video.renderer)) {
 				ok = gba->video.renderer->loadState(gba->video.renderer,
 				                                    (void*) ((uintptr_t) item.data + sizeof(uint32_t)),
 				                                    item.size - sizeof(type)) && ok;
@@ -912,7 +922,10 @@ static bool _GBACoreSaveExtraState(struct mCore* core, struct mStateExtdata* ext
 	struct GBA* gba = core->board;
 	void* buffer = NULL;
 	size_t size = 0;
-	gba->video.renderer->saveState(gba->video.renderer, &buffer, &size);
+	// The dummy renderer used without a video buffer has no state to save
+	if (gba->video.renderer->saveState) {
+		gba->video.renderer->saveState(gba->video.renderer, &buffer, &size);
+	}
 	if (size > 0 && buffer) {
 		struct mStateExtdataItem item;
 		item.size = size + sizeof(uint32_t);
@@ -1183,6 +1196,43 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static uint32_t _GBACoreCollectMemoryStores(struct mCore* core) {
+	struct GBA* gba = core->board;
+	return GBAMemoryCollectDirtyPages(&gba->memory);
+}
+
+static bool _GBACoreMemoryBlockStoredSince(struct mCore* core, size_t id, uint32_t offset, uint32_t length, uint32_t epoch) {
+	struct GBA* gba = core->board;
+	unsigned page;
+	uint32_t size;
+	switch (id) {
+	case GBA_REGION_EWRAM:
+		page = GBA_DIRTY_PAGE_EWRAM;
+		size = GBA_SIZE_EWRAM;
+		break;
+	case GBA_REGION_IWRAM:
+		page = GBA_DIRTY_PAGE_IWRAM;
+		size = GBA_SIZE_IWRAM;
+		break;
+	case GBA_REGION_VRAM:
+		page = GBA_DIRTY_PAGE_VRAM;
+		size = GBA_SIZE_VRAM;
+		break;
+	default:
+		return true;
+	}
+	if (!length || (uint64_t) offset + length > size) {
+		return true;
+	}
+	unsigned last = page + ((offset + length - 1) >> GBA_DIRTY_PAGE_SHIFT);
+	for (page += offset >> GBA_DIRTY_PAGE_SHIFT; page <= last; ++page) {
+		if (gba->memory.dirtyPageEpoch[page] > epoch) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static size_t _GBACoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBARegisters;
@@ -1479,6 +1529,12 @@ static bool _GBACoreSavedataRestore(struct mCore* core, const void* sram, size_t
 	return success;
 }
 
+static uint64_t _GBACoreSavedataStamp(struct mCore* core) {
+	struct GBA* gba = core->board;
+	// Frames that write savedata move the dirt age to their frame count
+	return ((uint64_t) gba->memory.savedata.dirtAge << 2) | gba->memory.savedata.dirty;
+}
+
 static size_t _GBACoreListVideoLayers(const struct mCore* core, const struct mCoreChannelInfo** info) {
 	UNUSED(core);
 	if (info) {
@@ -1654,9 +1710,11 @@ struct mCore* GBACoreCreate(void) {
 	core->runFrame = _GBACoreRunFrame;
 	core->runLoop = _GBACoreRunLoop;
 	core->step = _GBACoreStep;
+	core->skipFrames = _GBACoreSkipFrames;
 	core->stateSize = _GBACoreStateSize;
 	core->loadState = _GBACoreLoadState;
 	core->saveState = _GBACoreSaveState;
+	core->saveStateIncremental = _GBACoreSaveStateIncremental;
 	core->loadExtraState = _GBACoreLoadExtraState;
 	core->saveExtraState = _GBACoreSaveExtraState;
 	core->setKeys = _GBACoreSetKeys;
@@ -1683,6 +1741,8 @@ struct mCore* GBACoreCreate(void) {
 	core->rawWrite32 = _GBACoreRawWrite32;
 	core->listMemoryBlocks = _GBACoreListMemoryBlocks;
 	core->getMemoryBlock = _GBACoreGetMemoryBlock;
+	core->collectMemoryStores = _GBACoreCollectMemoryStores;
+	core->memoryBlockStoredSince = _GBACoreMemoryBlockStoredSince;
 	core->listRegisters = _GBACoreListRegisters;
 	core->readRegister = _GBACoreReadRegister;
 	core->writeRegister = _GBACoreWriteRegister;
@@ -1698,6 +1758,7 @@ struct mCore* GBACoreCreate(void) {
 	core->cheatDevice = _GBACoreCheatDevice;
 	core->savedataClone = _GBACoreSavedataClone;
 	core->savedataRestore = _GBACoreSavedataRestore;
+	core->savedataStamp = _GBACoreSavedataStamp;
 	core->listVideoLayers = _GBACoreListVideoLayers;
 	core->listAudioChannels = _GBACoreListAudioChannels;
 	core->enableVideoLayer = _GBACoreEnableVideoLayer;
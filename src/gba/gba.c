@@ -284,6 +284,7 @@ void GBAReset(struct ARMCore* cpu) {
 	if (GBAIsMB(gba->mbVf) && !isELF) {
 		gba->mbVf->seek(gba->mbVf, 0, SEEK_SET);
 		gba->mbVf->read(gba->mbVf, gba->memory.wram, GBA_SIZE_EWRAM);
+		GBAMemoryMarkAllDirty(&gba->memory);
 	}
 
 	gba->lastJump = 0;
@@ -412,6 +413,7 @@ bool GBALoadMB(struct GBA* gba, struct VFile* vf) {
 	vf->seek(vf, 0, SEEK_SET);
 	memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
 	off_t read = vf->read(vf, gba->memory.wram, GBA_SIZE_EWRAM);
+	GBAMemoryMarkAllDirty(&gba->memory);
 	if (read < 0) {
 		return false;
 	}
@@ -126,6 +126,7 @@ void GBAMemoryReset(struct GBA* gba) {
 	}
 
 	memset(gba->memory.io, 0, sizeof(gba->memory.io));
+	GBAMemoryMarkAllDirty(&gba->memory);
 	GBAAdjustWaitstates(gba, 0);
 	GBAAdjustEWRAMWaitstates(gba, 0x0D00);
 
@@ -762,12 +763,21 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	return value;
 }
 
+#define MARK_DIRTY(PAGE) \
+	memory->dirtyPages[(PAGE) >> 5] |= 1U << ((PAGE) & 31)
+
+#define MARK_DIRTY_EWRAM(OFFSET) MARK_DIRTY(GBA_DIRTY_PAGE_EWRAM + ((OFFSET) >> GBA_DIRTY_PAGE_SHIFT))
+#define MARK_DIRTY_IWRAM(OFFSET) MARK_DIRTY(GBA_DIRTY_PAGE_IWRAM + ((OFFSET) >> GBA_DIRTY_PAGE_SHIFT))
+#define MARK_DIRTY_VRAM(OFFSET) MARK_DIRTY(GBA_DIRTY_PAGE_VRAM + ((OFFSET) >> GBA_DIRTY_PAGE_SHIFT))
+
 #define STORE_EWRAM \
 	STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram); \
+	MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 4)); \
 	wait += waitstatesRegion[GBA_REGION_EWRAM];
 
 #define STORE_IWRAM \
-	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+	STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram); \
+	MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 4));
 
 #define STORE_IO \
 	GBAIOWrite32(gba, address & (OFFSET_MASK - 3), value);
@@ -789,6 +799,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram); \
 			if (oldValue != value) { \
 				STORE_32(value, address & 0x00017FFC, gba->video.vram); \
+				MARK_DIRTY_VRAM(address & 0x00017FFC); \
 				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) + 2); \
 				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC)); \
 			} \
@@ -797,6 +808,7 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 		LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram); \
 		if (oldValue != value) { \
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram); \
+			MARK_DIRTY_VRAM(address & 0x0001FFFC); \
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) + 2); \
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC)); \
 		} \
@@ -889,10 +901,12 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 2));
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 2));
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite(gba, address & (OFFSET_MASK - 1), value);
@@ -913,12 +927,14 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 			LOAD_16(oldValue, address & 0x00017FFE, gba->video.vram);
 			if (value != oldValue) {
 				STORE_16(value, address & 0x00017FFE, gba->video.vram);
+				MARK_DIRTY_VRAM(address & 0x00017FFE);
 				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 			}
 		} else {
 			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
 			if (value != oldValue) {
 				STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+				MARK_DIRTY_VRAM(address & 0x0001FFFE);
 				gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 			}
 		}
@@ -1034,10 +1050,12 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 	switch (address >> BASE_OFFSET) {
 	case GBA_REGION_EWRAM:
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 1));
 		wait = memory->waitstatesNonseq16[GBA_REGION_EWRAM];
 		break;
 	case GBA_REGION_IWRAM:
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		GBAIOWrite8(gba, address & OFFSET_MASK, value);
@@ -1053,6 +1071,7 @@ void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCo
 		oldValue = gba->video.renderer->vram[(address & 0x1FFFE) >> 1];
 		if (oldValue != (((uint8_t) value) | (value << 8))) {
 			gba->video.renderer->vram[(address & 0x1FFFE) >> 1] = ((uint8_t) value) | (value << 8);
+			MARK_DIRTY_VRAM(address & 0x0001FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		}
 		if (gba->video.stallMask) {
@@ -1232,10 +1251,12 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_EWRAM - 4), memory->wram);
 		STORE_32(value, address & (GBA_SIZE_EWRAM - 4), memory->wram);
+		MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 4));
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_32(oldValue, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
 		STORE_32(value, address & (GBA_SIZE_IWRAM - 4), memory->iwram);
+		MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 4));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch32: 0x%08X", address);
@@ -1250,11 +1271,13 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		if ((address & 0x0001FFFF) < GBA_SIZE_VRAM) {
 			LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram);
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x0001FFFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) | 2);
 		} else {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram);
 			STORE_32(value, address & 0x00017FFC, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x00017FFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFC);
 			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) | 2);
 		}
@@ -1306,10 +1329,12 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_EWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_EWRAM - 2), memory->wram);
 		STORE_16(value, address & (GBA_SIZE_EWRAM - 2), memory->wram);
+		MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 2));
 		break;
 	case GBA_REGION_IWRAM:
 		LOAD_16(oldValue, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
 		STORE_16(value, address & (GBA_SIZE_IWRAM - 2), memory->iwram);
+		MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 2));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch16: 0x%08X", address);
@@ -1323,10 +1348,12 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 		if ((address & 0x0001FFFF) < GBA_SIZE_VRAM) {
 			LOAD_16(oldValue, address & 0x0001FFFE, gba->video.vram);
 			STORE_16(value, address & 0x0001FFFE, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x0001FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		} else {
 			LOAD_16(oldValue, address & 0x00017FFE, gba->video.vram);
 			STORE_16(value, address & 0x00017FFE, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x00017FFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 		}
 		break;
@@ -1388,10 +1415,12 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case GBA_REGION_EWRAM:
 		oldValue = ((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)];
 		((int8_t*) memory->wram)[address & (GBA_SIZE_EWRAM - 1)] = value;
+		MARK_DIRTY_EWRAM(address & (GBA_SIZE_EWRAM - 1));
 		break;
 	case GBA_REGION_IWRAM:
 		oldValue = ((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)];
 		((int8_t*) memory->iwram)[address & (GBA_SIZE_IWRAM - 1)] = value;
+		MARK_DIRTY_IWRAM(address & (GBA_SIZE_IWRAM - 1));
 		break;
 	case GBA_REGION_IO:
 		mLOG(GBA_MEM, STUB, "Unimplemented memory Patch8: 0x%08X", address);
@@ -1407,11 +1436,13 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 			LOAD_16(alignedValue, address & 0x0001FFFE, gba->video.vram);
 			MUNGE8;
 			STORE_16(alignedValue, address & 0x0001FFFE, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x0001FFFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFE);
 		} else {
 			LOAD_16(alignedValue, address & 0x00017FFE, gba->video.vram);
 			MUNGE8;
 			STORE_16(alignedValue, address & 0x00017FFE, gba->video.vram);
+			MARK_DIRTY_VRAM(address & 0x00017FFE);
 			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFE);
 		}
 		break;
@@ -1892,14 +1923,44 @@ int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra) {
 	return stall;
 }
 
-void GBAMemorySerialize(const struct GBAMemory* memory, struct GBASerializedState* state) {
-	memcpy(state->wram, memory->wram, GBA_SIZE_EWRAM);
-	memcpy(state->iwram, memory->iwram, GBA_SIZE_IWRAM);
+void GBAMemoryMarkAllDirty(struct GBAMemory* memory) {
+	memset(memory->dirtyPages, 0xFF, sizeof(memory->dirtyPages));
+}
+
+uint32_t GBAMemoryCollectDirtyPages(struct GBAMemory* memory) {
+	// Stamp every page written since the last collection with a new epoch so
+	// that each snapshot consumer can compare against the epoch it last saw
+	uint32_t epoch = ++memory->dirtyEpoch;
+	size_t i;
+	for (i = 0; i < sizeof(memory->dirtyPages) / sizeof(*memory->dirtyPages); ++i) {
+		uint32_t bits = memory->dirtyPages[i];
+		memory->dirtyPages[i] = 0;
+		while (bits) {
+			unsigned page = i * 32 + ctz32(bits);
+			bits &= bits - 1;
+			if (page < GBA_DIRTY_PAGES) {
+				memory->dirtyPageEpoch[page] = epoch;
+			}
+		}
+	}
+	return epoch;
+}
+
+void GBAMemoryLoadPages(struct GBAMemory* memory, unsigned page, void* dest, const void* src, size_t size) {
+	// Loading a state that mostly matches the current one, such as when
+	// running ahead, shouldn't make every page look written
+	size_t offset;
+	for (offset = 0; offset < size; offset += 1 << GBA_DIRTY_PAGE_SHIFT, ++page) {
+		if (memcmp((uint8_t*) dest + offset, (const uint8_t*) src + offset, 1 << GBA_DIRTY_PAGE_SHIFT) != 0) {
+			memcpy((uint8_t*) dest + offset, (const uint8_t*) src + offset, 1 << GBA_DIRTY_PAGE_SHIFT);
+			MARK_DIRTY(page);
+		}
+	}
 }
 
 void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedState* state) {
-	memcpy(memory->wram, state->wram, GBA_SIZE_EWRAM);
-	memcpy(memory->iwram, state->iwram, GBA_SIZE_IWRAM);
+	GBAMemoryLoadPages(memory, GBA_DIRTY_PAGE_EWRAM, memory->wram, state->wram, GBA_SIZE_EWRAM);
+	GBAMemoryLoadPages(memory, GBA_DIRTY_PAGE_IWRAM, memory->iwram, state->iwram, GBA_SIZE_IWRAM);
 }
 
 void _pristineCow(struct GBA* gba) {
@@ -17,6 +17,16 @@
 	localX = x; \
 	localY = y;
 
+#define BACKGROUND_BITMAP_ITERATE_UNCHECKED \
+	x += background->dx; \
+	y += background->dy; \
+	localX = x; \
+	localY = y;
+
+#define MODE_2_COORD_UNCHECKED \
+	localX = x; \
+	localY = y;
+
 #define MODE_2_COORD_OVERFLOW \
 	localX = x & (sizeAdjusted - 1); \
 	localY = y & (sizeAdjusted - 1); \
@@ -54,7 +64,9 @@
 	}
 
 #define DRAW_BACKGROUND_MODE_2(BLEND, OBJWIN) \
-	if (background->overflow) { \
+	if (mosaicH <= 1 && inBounds) { \
+		MODE_2_LOOP(MODE_2_NO_MOSAIC, MODE_2_COORD_UNCHECKED, BLEND, OBJWIN); \
+	} else if (background->overflow) { \
 		if (mosaicH > 1) { \
 			localX &= sizeAdjusted - 1; \
 			localY &= sizeAdjusted - 1; \
@@ -76,6 +88,20 @@
 		} \
 	}
 
+// x and y are the coordinates one step before the first pixel, as set up by BACKGROUND_BITMAP_INIT.
+// Affine stepping is linear, so if both ends of the span are in bounds then so is every pixel between them.
+static inline bool _affineSpanInBounds(int32_t x, int32_t y, int32_t dx, int32_t dy, int count, int32_t width, int32_t height) {
+	if (count <= 0) {
+		return false;
+	}
+	int32_t startX = x + dx;
+	int32_t startY = y + dy;
+	int32_t endX = x + dx * count;
+	int32_t endY = y + dy * count;
+	return startX >= 0 && startX < width && endX >= 0 && endX < width &&
+	       startY >= 0 && startY < height && endY >= 0 && endY < height;
+}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	int sizeAdjusted = 0x8000 << background->size;
 
@@ -88,6 +114,7 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
+	bool inBounds = _affineSpanInBounds(x, y, background->dx, background->dy, renderer->end - renderer->start, sizeAdjusted, sizeAdjusted);
 
 	if (!objwinSlowPath) {
 		if (!(flags & FLAG_TARGET_2)) {
@@ -104,45 +131,73 @@ void GBAVideoSoftwareRendererDrawBackgroundMode2(struct GBAVideoSoftwareRenderer
 	}
 }
 
+#define MODE_3_LOOP(ITERATE) \
+	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
+		ITERATE; \
+		\
+		if (!mosaicWait) { \
+			LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram); \
+			color = variant ? _variantFrom555(renderer, color) : mColorFrom555(color); \
+			mosaicWait = mosaicH; \
+		} else { \
+			--mosaicWait; \
+		} \
+		\
+		uint32_t current = *pixel; \
+		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) { \
+			unsigned mergedFlags = flags; \
+			if (current & FLAG_OBJWIN) { \
+				mergedFlags = objwinFlags; \
+			} \
+			_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current); \
+		} \
+	}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode3(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
-	uint32_t color = renderer->normalPalette[0];
+	uint32_t color = variant ? renderer->variantPalette[0] : renderer->normalPalette[0];
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < GBA_VIDEO_HORIZONTAL_PIXELS && (localY >> 8) < GBA_VIDEO_VERTICAL_PIXELS) {
 		LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
-		color = mColorFrom555(color);
+		color = variant ? _variantFrom555(renderer, color) : mColorFrom555(color);
 	}
 
 	int outX;
 	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
-
-		if (!mosaicWait) {
-			LOAD_16(color, ((localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS) << 1, renderer->d.vram);
-			color = mColorFrom555(color);
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
-		}
-
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
-		}
+	if (!background->mosaic && _affineSpanInBounds(x, y, background->dx, background->dy, renderer->end - renderer->start, GBA_VIDEO_HORIZONTAL_PIXELS << 8, GBA_VIDEO_VERTICAL_PIXELS << 8)) {
+		MODE_3_LOOP(BACKGROUND_BITMAP_ITERATE_UNCHECKED);
+	} else {
+		MODE_3_LOOP(BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS));
 	}
 }
 
+#define MODE_4_LOOP(ITERATE) \
+	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
+		ITERATE; \
+		\
+		if (!mosaicWait) { \
+			color = ((uint8_t*)renderer->d.vram)[offset + (localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS]; \
+			\
+			mosaicWait = mosaicH; \
+		} else { \
+			--mosaicWait; \
+		} \
+		\
+		uint32_t current = *pixel; \
+		if (color && IS_WRITABLE(current)) { \
+			if (!objwinSlowPath) { \
+				_compositeBlendNoObjwin(renderer, pixel, palette[color] | flags, current); \
+			} else if (background->objwinForceEnable || (!(current & FLAG_OBJWIN)) == background->objwinOnly) { \
+				mColor* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette; \
+				unsigned mergedFlags = flags; \
+				if (current & FLAG_OBJWIN) { \
+					mergedFlags = objwinFlags; \
+				} \
+				_compositeBlendObjwin(renderer, pixel, currentPalette[color] | mergedFlags, current); \
+			} \
+		} \
+	}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
@@ -157,72 +212,53 @@ void GBAVideoSoftwareRendererDrawBackgroundMode4(struct GBAVideoSoftwareRenderer
 
 	int outX;
 	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS);
-
-		if (!mosaicWait) {
-			color = ((uint8_t*)renderer->d.vram)[offset + (localX >> 8) + (localY >> 8) * GBA_VIDEO_HORIZONTAL_PIXELS];
-
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
-		}
-
-		uint32_t current = *pixel;
-		if (color && IS_WRITABLE(current)) {
-			if (!objwinSlowPath) {
-				_compositeBlendNoObjwin(renderer, pixel, palette[color] | flags, current);
-			} else if (background->objwinForceEnable || (!(current & FLAG_OBJWIN)) == background->objwinOnly) {
-				mColor* currentPalette = (current & FLAG_OBJWIN) ? objwinPalette : palette;
-				unsigned mergedFlags = flags;
-				if (current & FLAG_OBJWIN) {
-					mergedFlags = objwinFlags;
-				}
-				_compositeBlendObjwin(renderer, pixel, currentPalette[color] | mergedFlags, current);
-			}
-		}
+	if (!background->mosaic && _affineSpanInBounds(x, y, background->dx, background->dy, renderer->end - renderer->start, GBA_VIDEO_HORIZONTAL_PIXELS << 8, GBA_VIDEO_VERTICAL_PIXELS << 8)) {
+		MODE_4_LOOP(BACKGROUND_BITMAP_ITERATE_UNCHECKED);
+	} else {
+		MODE_4_LOOP(BACKGROUND_BITMAP_ITERATE(GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS));
 	}
 }
 
+#define MODE_5_LOOP(ITERATE) \
+	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) { \
+		ITERATE; \
+		\
+		if (!mosaicWait) { \
+			LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram); \
+			color = variant ? _variantFrom555(renderer, color) : mColorFrom555(color); \
+			mosaicWait = mosaicH; \
+		} else { \
+			--mosaicWait; \
+		} \
+		\
+		uint32_t current = *pixel; \
+		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) { \
+			unsigned mergedFlags = flags; \
+			if (current & FLAG_OBJWIN) { \
+				mergedFlags = objwinFlags; \
+			} \
+			_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current); \
+		} \
+	}
+
 void GBAVideoSoftwareRendererDrawBackgroundMode5(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background, int inY) {
 	BACKGROUND_BITMAP_INIT;
 
-	uint32_t color = renderer->normalPalette[0];
+	uint32_t color = variant ? renderer->variantPalette[0] : renderer->normalPalette[0];
 	uint32_t offset = 0;
 	if (GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt)) {
 		offset = 0xA000;
 	}
 	if (mosaicWait && localX >= 0 && localY >= 0 && (localX >> 8) < 160 && (localY >> 8) < 128) {
 		LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram);
-		color = mColorFrom555(color);
+		color = variant ? _variantFrom555(renderer, color) : mColorFrom555(color);
 	}
 
 	int outX;
 	uint32_t* pixel;
-	for (outX = renderer->start, pixel = &renderer->row[outX]; outX < renderer->end; ++outX, ++pixel) {
-		BACKGROUND_BITMAP_ITERATE(160, 128);
-
-		if (!mosaicWait) {
-			LOAD_16(color, offset + (localX >> 8) * 2 + (localY >> 8) * 320, renderer->d.vram);
-			color = mColorFrom555(color);
-			mosaicWait = mosaicH;
-		} else {
-			--mosaicWait;
-		}
-
-		uint32_t current = *pixel;
-		if (!objwinSlowPath || (!(current & FLAG_OBJWIN)) != background->objwinOnly) {
-			unsigned mergedFlags = flags;
-			if (current & FLAG_OBJWIN) {
-				mergedFlags = objwinFlags;
-			}
-			if (!variant) {
-				_compositeBlendObjwin(renderer, pixel, color | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_BRIGHTEN) {
-				_compositeBlendObjwin(renderer, pixel, _brighten(color, renderer->bldy) | mergedFlags, current);
-			} else if (renderer->blendEffect == BLEND_DARKEN) {
-				_compositeBlendObjwin(renderer, pixel, _darken(color, renderer->bldy) | mergedFlags, current);
-			}
-		}
+	if (!background->mosaic && _affineSpanInBounds(x, y, background->dx, background->dy, renderer->end - renderer->start, 160 << 8, 128 << 8)) {
+		MODE_5_LOOP(BACKGROUND_BITMAP_ITERATE_UNCHECKED);
+	} else {
+		MODE_5_LOOP(BACKGROUND_BITMAP_ITERATE(160, 128));
 	}
 }
@@ -380,7 +380,7 @@ void GBAVideoSoftwareRendererPostprocessSprite(struct GBAVideoSoftwareRenderer*
 	uint32_t* pixel = &renderer->row[renderer->start];
 	uint32_t flags = FLAG_TARGET_2 * renderer->target2Obj;
 
-	int objwinSlowPath = GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt);
+	int objwinSlowPath = renderer->objwinActive;
 	bool objwinDisable = false;
 	bool objwinOnly = false;
 	if (objwinSlowPath) {
@@ -34,6 +34,11 @@ void GBAVideoSoftwareRendererPostprocessSprite(struct GBAVideoSoftwareRenderer*
 static inline unsigned _brighten(unsigned color, int y);
 static inline unsigned _darken(unsigned color, int y);
 
+// Converts a raw BGR555 color into the current brightened or darkened output color
+static inline mColor _variantFrom555(const struct GBAVideoSoftwareRenderer* renderer, uint16_t value) {
+	return renderer->variantChannels[0][M_R5(value)] | renderer->variantChannels[1][M_G5(value)] | renderer->variantChannels[2][M_B5(value)];
+}
+
 // We stash the priority on the top bits so we can do a one-operator comparison
 // The lower the number, the higher the priority, and sprites take precedence over backgrounds
 // We want to do special processing if the color pixel is target 1, however
@@ -154,13 +159,13 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 
 // TODO: Remove UNUSEDs after implementing OBJWIN for modes 3 - 5
 #define PREPARE_OBJWIN                                                                            \
-	int objwinSlowPath = GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt);                     \
+	int objwinSlowPath = renderer->objwinActive;                                                  \
 	mColor* objwinPalette = renderer->normalPalette;                                             \
 	if (renderer->d.highlightAmount && background->highlight) {                                   \
 		objwinPalette = renderer->highlightPalette;                                               \
 	}                                                                                             \
 	UNUSED(objwinPalette);                                                                        \
-	if (objwinSlowPath) {                                                                         \
+	if (GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt)) {                                    \
 		if (background->target1 && GBAWindowControlIsBlendEnable(renderer->objwin.packed) &&      \
 		    (renderer->blendEffect == BLEND_BRIGHTEN || renderer->blendEffect == BLEND_DARKEN)) { \
 			objwinPalette = renderer->variantPalette;                                             \
@@ -211,7 +216,7 @@ static inline void _compositeNoBlendNoObjwin(struct GBAVideoSoftwareRenderer* re
 	!softwareRenderer->d.disableBG[X] && \
 	(softwareRenderer->bg[X].enabled == ENABLED_MAX && \
 	(GBAWindowControlIsBg ## X ## Enable(softwareRenderer->currentWindow.packed) || \
-	(GBARegisterDISPCNTIsObjwinEnable(softwareRenderer->dispcnt) && GBAWindowControlIsBg ## X ## Enable (softwareRenderer->objwin.packed))) && \
+	(softwareRenderer->objwinActive && GBAWindowControlIsBg ## X ## Enable (softwareRenderer->objwin.packed))) && \
 	softwareRenderer->bg[X].priority == priority)
 
 static inline unsigned _brighten(unsigned color, int y) {
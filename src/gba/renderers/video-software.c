@@ -10,6 +10,7 @@
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/renderers/cache-set.h>
 
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 
 #define DIRTY_SCANLINE(R, Y) R->scanlineDirty[Y >> 5] |= (1U << (Y & 0x1F))
@@ -506,9 +507,25 @@ static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer,
 #endif
 }
 
+static bool _spanHasObjwin(const struct GBAVideoSoftwareRenderer* renderer) {
+	int x;
+	for (x = renderer->start; x < renderer->end; ++x) {
+		if (renderer->row[x] & FLAG_OBJWIN) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static void GBAVideoSoftwareRendererPrepareWindow(struct GBAVideoSoftwareRenderer* renderer) {
-	int objwinSlowPath = GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt);
-	if (objwinSlowPath) {
+	renderer->objwinActive = GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt);
+	// A span with no OBJWIN pixels is governed by its own window control alone,
+	// so let the layers take their plain paths instead of testing every pixel.
+	// Modes 3 and 5 still treat OBJWIN specially, so leave those alone.
+	if (renderer->objwinActive && GBARegisterDISPCNTGetMode(renderer->dispcnt) != 3 && GBARegisterDISPCNTGetMode(renderer->dispcnt) != 5) {
+		renderer->objwinActive = _spanHasObjwin(renderer);
+	}
+	if (renderer->objwinActive) {
 		renderer->bg[0].objwinForceEnable = GBAWindowControlIsBg0Enable(renderer->objwin.packed) &&
 		    GBAWindowControlIsBg0Enable(renderer->currentWindow.packed);
 		renderer->bg[0].objwinOnly = !GBAWindowControlIsBg0Enable(renderer->objwin.packed);
@@ -1016,19 +1033,48 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 	}
 }
 
+static void _cleanSpriteRows(struct GBAVideoSoftwareRenderer* renderer) {
+	memset(renderer->spriteRows, 0, sizeof(renderer->spriteRows));
+	int i;
+	for (i = 0; i < renderer->oamMax; ++i) {
+		const struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+		int y = sprite->y > 0 ? sprite->y : 0;
+		int endY = sprite->endY < GBA_VIDEO_VERTICAL_PIXELS ? sprite->endY : GBA_VIDEO_VERTICAL_PIXELS;
+		for (; y < endY; ++y) {
+			renderer->spriteRows[y][i >> 5] |= 1U << (i & 31);
+		}
+	}
+}
+
+static inline int _nextSpriteInRow(const uint32_t* row, int i) {
+	while (i < 128) {
+		uint32_t bits = row[i >> 5] >> (i & 31);
+		if (bits) {
+			return i + ctz32(bits);
+		}
+		i = (i | 31) + 1;
+	}
+	return i;
+}
+
 int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y) {
 	int w;
 	int spriteLayers = 0;
 	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
 		if (renderer->oamDirty) {
 			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
+			_cleanSpriteRows(renderer);
 			renderer->oamDirty = false;
 		}
 		int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
 		int mosaicY = y - (y % mosaicV);
 		int lastIndex = 0;
 		int i;
-		for (i = 0; i < renderer->oamMax; ++i) {
+		// Sprites that don't intersect this scanline are skipped entirely. The cycle
+		// cost of skipped OAM entries telescopes into the next visible sprite's index
+		// delta, so the cycle limit behaves the same as walking every entry.
+		const uint32_t* row = renderer->spriteRows[y];
+		for (i = _nextSpriteInRow(row, 0); i < 128; i = _nextSpriteInRow(row, i + 1)) {
 			struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
 			int localY = y;
 			renderer->end = 0;
@@ -1037,9 +1083,6 @@ int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRendere
 			if (renderer->spriteCyclesRemaining <= 0) {
 				break;
 			}
-			if (y < sprite->y || y >= sprite->endY) {
-				continue;
-			}
 			if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
 				localY = mosaicY;
 				if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
@@ -1069,6 +1112,21 @@ int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRendere
 
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer) {
 	int i;
+	int channel;
+	// Channels don't interact when brightening or darkening, so bitmap modes
+	// can build variant colors from three per-channel lookups
+	for (channel = 0; channel < 3; ++channel) {
+		mColor mask = mColorFrom555(0x1F << (channel * 5));
+		for (i = 0; i < 32; ++i) {
+			mColor color = mColorFrom555(i << (channel * 5));
+			if (renderer->blendEffect == BLEND_BRIGHTEN) {
+				color = _brighten(color, renderer->bldy);
+			} else if (renderer->blendEffect == BLEND_DARKEN) {
+				color = _darken(color, renderer->bldy);
+			}
+			renderer->variantChannels[channel][i] = color & mask;
+		}
+	}
 	if (renderer->blendEffect == BLEND_BRIGHTEN) {
 		for (i = 0; i < 512; ++i) {
 			renderer->variantPalette[i] = _brighten(renderer->normalPalette[i], renderer->bldy);
@@ -25,6 +25,36 @@ struct GBABundledState {
 };
 
 void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
+	GBASerializeIncremental(gba, state, 0, NULL);
+}
+
+static const uint8_t* _dirtyPageSource(struct GBA* gba, unsigned page) {
+	if (page >= GBA_DIRTY_PAGE_EWRAM) {
+		return (const uint8_t*) gba->memory.wram + ((page - GBA_DIRTY_PAGE_EWRAM) << GBA_DIRTY_PAGE_SHIFT);
+	}
+	if (page >= GBA_DIRTY_PAGE_IWRAM) {
+		return (const uint8_t*) gba->memory.iwram + ((page - GBA_DIRTY_PAGE_IWRAM) << GBA_DIRTY_PAGE_SHIFT);
+	}
+	return (const uint8_t*) gba->video.vram + ((page - GBA_DIRTY_PAGE_VRAM) << GBA_DIRTY_PAGE_SHIFT);
+}
+
+uint32_t GBASerializeIncremental(struct GBA* gba, struct GBASerializedState* state, uint32_t since, uint32_t* changedPages) {
+	uint32_t epoch = GBAMemoryCollectDirtyPages(&gba->memory);
+	if (changedPages) {
+		memset(changedPages, 0, sizeof(*changedPages) * ((GBA_DIRTY_PAGES + 31) / 32));
+		changedPages[0] = 1;
+	}
+	unsigned page;
+	for (page = GBA_DIRTY_PAGE_VRAM; page < GBA_DIRTY_PAGES; ++page) {
+		if (since && gba->memory.dirtyPageEpoch[page] <= since) {
+			continue;
+		}
+		memcpy((uint8_t*) state + (page << GBA_DIRTY_PAGE_SHIFT), _dirtyPageSource(gba, page), 1 << GBA_DIRTY_PAGE_SHIFT);
+		if (changedPages) {
+			changedPages[page >> 5] |= 1U << (page & 31);
+		}
+	}
+
 	STORE_32(GBASavestateMagic + GBASavestateVersion, 0, &state->versionMagic);
 	STORE_32(gba->biosChecksum, 0, &state->biosChecksum);
 	STORE_32(gba->romCrc32, 0, &state->romCrc32);
@@ -81,7 +111,6 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	STORE_32(miscFlags, 0, &state->miscFlags);
 	STORE_32(gba->biosStall, 0, &state->biosStall);
 
-	GBAMemorySerialize(&gba->memory, state);
 	GBAIOSerialize(gba, state);
 	GBAUnlCartSerialize(gba, state);
 	GBAVideoSerialize(&gba->video, state);
@@ -91,6 +120,7 @@ void GBASerialize(struct GBA* gba, struct GBASerializedState* state) {
 	if (gba->memory.matrix.size) {
 		GBAMatrixSerialize(gba, state);
 	}
+	return epoch;
 }
 
 bool GBADeserialize(struct GBA* gba, const struct GBASerializedState* state) {
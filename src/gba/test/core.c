@@ -6,7 +6,47 @@
 #include "util/test/suite.h"
 
 #include <mgba/core/core.h>
+#include <mgba/core/rewind.h>
+#include <mgba/core/serialize.h>
+#include <mgba/core/state-journal.h>
+#include <mgba/core/state-tree.h>
 #include <mgba/gba/core.h>
+#include <mgba/gba/interface.h>
+#include <mgba/feature/movie.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba-util/vfs.h>
+
+static mColor _videoBuffer[GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS];
+
+M_TEST_SUITE_SETUP(GBACore) {
+	struct mCore* core = GBACoreCreate();
+	if (!core || !core->init(core)) {
+		return -1;
+	}
+	mCoreInitConfig(core, NULL);
+	core->setVideoBuffer(core, _videoBuffer, GBA_VIDEO_HORIZONTAL_PIXELS);
+	*state = core;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBACore) {
+	if (!*state) {
+		return 0;
+	}
+	struct mCore* core = *state;
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+// Tests that use the shared core start from a clean reset, without any
+// callbacks left behind by earlier tests
+static int _resetCore(void** state) {
+	struct mCore* core = *state;
+	core->clearCoreCallbacks(core);
+	core->reset(core);
+	return 0;
+}
 
 M_TEST_DEFINE(create) {
 	struct mCore* core = GBACoreCreate();
@@ -44,8 +84,361 @@ M_TEST_DEFINE(loadNullROM) {
 	core->deinit(core);
 }
 
-M_TEST_SUITE_DEFINE(GBACore,
+M_TEST_DEFINE(incrementalState) {
+	struct mCore* core = *state;
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mStateIncremental incremental;
+	mStateIncrementalInit(&incremental);
+	assert_true(mCoreSaveStateIncremental(core, vf, 0, &incremental));
+
+	core->busWrite32(core, 0x03000100, 0x12345678);
+	core->busWrite8(core, 0x02010000, 0xA5);
+	assert_true(mCoreSaveStateIncremental(core, vf, 0, &incremental));
+	assert_true(incremental.changedPages[0] & 1);
+	assert_false(incremental.changedPages[0] & 2);
+
+	size_t stateSize = core->stateSize(core);
+	void* full = calloc(1, stateSize);
+	assert_true(core->saveState(core, full));
+	void* mapped = vf->map(vf, stateSize, MAP_READ);
+	assert_memory_equal(mapped, full, stateSize);
+	vf->unmap(vf, mapped, stateSize);
+
+	free(full);
+	mStateIncrementalDeinit(&incremental);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(stateBuffer) {
+	struct mCore* core = *state;
+
+	size_t stateSize = core->stateSize(core);
+	void* buffer = malloc(stateSize);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, stateSize - 1, 0), stateSize);
+	core->busWrite32(core, 0x02000000, 0x12345678);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, stateSize, 0), stateSize);
+	core->busWrite32(core, 0x02000000, 0);
+	assert_false(mCoreLoadStateBuffer(core, buffer, stateSize - 1, 0));
+	assert_true(mCoreLoadStateBuffer(core, buffer, stateSize, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 0x12345678);
+
+	free(buffer);
+}
+
+M_TEST_DEFINE(loadStateStores) {
+	struct mCore* core = *state;
+
+	size_t stateSize = core->stateSize(core);
+	void* buffer = malloc(stateSize);
+	core->busWrite32(core, 0x02000000, 0x12345678);
+	assert_int_equal(mCoreSaveStateBuffer(core, buffer, stateSize, 0), stateSize);
+	core->busWrite32(core, 0x02000000, 0);
+	uint32_t epoch = core->collectMemoryStores(core);
+	assert_true(mCoreLoadStateBuffer(core, buffer, stateSize, 0));
+	core->collectMemoryStores(core);
+
+	// Only memory that the state actually changed counts as stored to
+	assert_true(core->memoryBlockStoredSince(core, GBA_REGION_EWRAM, 0, 4, epoch));
+	assert_false(core->memoryBlockStoredSince(core, GBA_REGION_EWRAM, 0x1000, GBA_SIZE_EWRAM - 0x1000, epoch));
+	assert_false(core->memoryBlockStoredSince(core, GBA_REGION_IWRAM, 0, GBA_SIZE_IWRAM, epoch));
+	assert_false(core->memoryBlockStoredSince(core, GBA_REGION_VRAM, 0, GBA_SIZE_VRAM, epoch));
+
+	free(buffer);
+}
+
+M_TEST_DEFINE(rawStateLayout) {
+	struct mCore* core = *state;
+
+	core->busWrite32(core, 0x02000000, 0x12345678);
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(core, vf, SAVESTATE_METADATA));
+	core->busWrite32(core, 0x02000000, 0);
+
+	size_t stateSize = core->stateSize(core);
+	size_t size = vf->size(vf);
+	const uint8_t* data = vf->map(vf, size, MAP_READ);
+	size_t offset;
+	size_t items = 0;
+	uint64_t nextItem = 0;
+	for (offset = stateSize; offset + sizeof(struct mStateExtdataHeader) <= size; offset += sizeof(struct mStateExtdataHeader)) {
+		uint32_t tag;
+		int32_t itemSize;
+		uint64_t itemOffset;
+		LOAD_32LE(tag, offsetof(struct mStateExtdataHeader, tag), &data[offset]);
+		LOAD_32LE(itemSize, offsetof(struct mStateExtdataHeader, size), &data[offset]);
+		LOAD_64LE(itemOffset, offsetof(struct mStateExtdataHeader, offset), &data[offset]);
+		if (!tag) {
+			break;
+		}
+		// Items are packed back to back after the header terminator
+		if (items) {
+			assert_int_equal(itemOffset, nextItem);
+		}
+		nextItem = itemOffset + itemSize;
+		++items;
+	}
+	assert_true(items >= 2);
+	uint64_t firstItem;
+	LOAD_64LE(firstItem, offsetof(struct mStateExtdataHeader, offset), &data[stateSize]);
+	assert_int_equal(firstItem, offset + sizeof(struct mStateExtdataHeader));
+	assert_int_equal(nextItem, size);
+	vf->unmap(vf, (void*) data, size);
+
+	assert_true(mCoreLoadStateNamed(core, vf, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 0x12345678);
+
+	struct mStateExtdata extdata;
+	struct mStateExtdataItem item;
+	mStateExtdataInit(&extdata);
+	assert_true(mCoreExtractExtdata(core, vf, &extdata));
+	assert_true(mStateExtdataGet(&extdata, EXTDATA_META_CREATOR, &item));
+	assert_int_equal(((const char*) item.data)[item.size - 1], '\0');
+	mStateExtdataDeinit(&extdata);
+
+	vf->close(vf);
+}
+
+#ifdef USE_PNG
+M_TEST_DEFINE(pngState) {
+	struct mCore* core = *state;
+
+	// Large enough to span several compression chunks
+	uint32_t address;
+	for (address = 0; address < 0x40000; address += 4) {
+		core->busWrite32(core, 0x02000000 + address, address * 0x9E3779B1);
+	}
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCoreSaveStateNamed(core, vf, SAVESTATE_SCREENSHOT));
+	for (address = 0; address < 0x40000; address += 4) {
+		core->busWrite32(core, 0x02000000 + address, 0);
+	}
+	assert_true(mCoreLoadStateNamed(core, vf, SAVESTATE_SCREENSHOT));
+	assert_int_equal(core->busRead32(core, 0x02000000 + 0x100), 0x100 * 0x9E3779B1);
+	assert_int_equal(core->busRead32(core, 0x02000000 + 0x3FFFC), 0x3FFFC * 0x9E3779B1);
+
+	vf->close(vf);
+}
+#endif
+
+M_TEST_DEFINE(rewindSeek) {
+	struct mCore* core = *state;
+
+	struct mCoreRewindContext rewind = {0};
+	mCoreRewindContextInit(&rewind, 200, false);
+	unsigned i;
+	for (i = 0; i < 150; ++i) {
+		core->busWrite32(core, 0x02000000, i);
+		core->busWrite8(core, 0x03000000 + i, i);
+		mCoreRewindAppend(&rewind, core);
+	}
+	assert_int_equal(rewind.size, 150);
+
+	// Crosses at least one keyframe
+	assert_true(mCoreRewindRestore(&rewind, core, 100));
+	assert_int_equal(core->busRead32(core, 0x02000000), 49);
+	assert_int_equal(core->busRead8(core, 0x03000031), 49);
+	assert_int_equal(core->busRead8(core, 0x03000032), 0);
+	assert_true(mCoreRewindRestore(&rewind, core, 1));
+	assert_int_equal(core->busRead32(core, 0x02000000), 48);
+
+	// Seeking draws the target frame without moving off of the target state
+	mColor stale;
+	memset(&stale, 0xA5, sizeof(stale));
+	for (i = 0; i < GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS; ++i) {
+		_videoBuffer[i] = stale;
+	}
+	assert_true(mCoreRewindSeek(&rewind, core, 8));
+	assert_int_equal(core->busRead32(core, 0x02000000), 40);
+	assert_int_equal(rewind.size, 41);
+	assert_false(rewind.seeking);
+	assert_int_not_equal(_videoBuffer[GBA_VIDEO_HORIZONTAL_PIXELS * (GBA_VIDEO_VERTICAL_PIXELS - 1)], stale);
+
+	// Restoring past the oldest entry stops there
+	assert_true(mCoreRewindRestore(&rewind, core, 1000));
+	assert_int_equal(core->busRead32(core, 0x02000000), 0);
+	assert_int_equal(rewind.size, 1);
+
+	mCoreRewindContextDeinit(&rewind);
+}
+
+M_TEST_DEFINE(stateTree) {
+	struct mCore* core = *state;
+
+	struct mStateTree tree;
+	mStateTreeInit(&tree);
+	uint32_t root = mStateTreeSave(&tree, core, 0);
+	assert_int_not_equal(root, 0);
+	size_t pages = tree.uniquePages;
+
+	core->busWrite32(core, 0x02000000, 1);
+	uint32_t a = mStateTreeSave(&tree, core, 0);
+	assert_int_not_equal(a, 0);
+	assert_int_equal(mStateTreeGet(&tree, a)->parent, root);
+	// Only the header and the touched WRAM page differ
+	assert_true(tree.uniquePages <= pages + 2);
+
+	assert_true(mStateTreeLoad(&tree, core, root, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 0);
+	core->busWrite32(core, 0x02000000, 2);
+	uint32_t b = mStateTreeSave(&tree, core, 0);
+	assert_int_equal(mStateTreeGet(&tree, b)->parent, root);
+
+	uint32_t children[4];
+	assert_int_equal(mStateTreeChildren(&tree, root, children, 4), 2);
+
+	assert_true(mStateTreeLoad(&tree, core, a, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 1);
+
+	assert_true(mStateTreeRemove(&tree, root));
+	assert_int_equal(mStateTreeGet(&tree, a)->parent, 0);
+	assert_int_equal(mStateTreeChildren(&tree, 0, children, 4), 2);
+	assert_true(mStateTreeLoad(&tree, core, b, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 2);
+
+	mStateTreeDeinit(&tree);
+}
+
+static ssize_t (*_journalWrite)(struct VFile* vf, const void* buffer, size_t size);
+static size_t _journalWriteBudget;
+
+// Writes until the budget runs out, then comes up short like a full disk
+static ssize_t _journalWriteLimited(struct VFile* vf, const void* buffer, size_t size) {
+	if (size > _journalWriteBudget) {
+		size = _journalWriteBudget;
+	}
+	_journalWriteBudget -= size;
+	return _journalWrite(vf, buffer, size);
+}
+
+M_TEST_DEFINE(stateJournal) {
+	struct mCore* core = *state;
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mStateJournal journal;
+	assert_true(mStateJournalOpen(&journal, vf));
+	journal.rebaseInterval = 4;
+	uint32_t i;
+	for (i = 0; i < 10; ++i) {
+		core->busWrite32(core, 0x02000000, i);
+		assert_true(mStateJournalAppendCore(&journal, core, 0));
+	}
+	assert_true(mStateJournalClose(&journal));
+	// Only every fourth checkpoint is stored in full
+	assert_true((size_t) vf->size(vf) < core->stateSize(core) * 4);
+
+	assert_true(mStateJournalOpen(&journal, vf));
+	assert_int_equal(mStateJournalCount(&journal), 10);
+	assert_int_equal(mStateJournalEntryListGetConstPointer(&journal.entries, 5)->base, 4);
+	assert_true(mStateJournalLoad(&journal, core, 6, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 6);
+
+	// Appending after reopening replaces the old index
+	core->busWrite32(core, 0x02000000, 10);
+	assert_true(mStateJournalAppendCore(&journal, core, 0));
+	assert_true(mStateJournalClose(&journal));
+
+	struct VFile* out = VFileMemChunk(NULL, 0);
+	assert_true(mStateJournalOpen(&journal, vf));
+	assert_int_equal(mStateJournalCount(&journal), 11);
+	assert_true(mStateJournalExtract(&journal, 9, out));
+	assert_true(mStateJournalClose(&journal));
+	core->busWrite32(core, 0x02000000, 0);
+	assert_true(mCoreLoadStateNamed(core, out, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 9);
+
+	// Without an index, the records are recovered by scanning
+	vf->truncate(vf, vf->size(vf) - 16);
+	assert_true(mStateJournalOpen(&journal, vf));
+	assert_int_equal(mStateJournalCount(&journal), 11);
+	assert_true(mStateJournalLoad(&journal, core, 10, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 10);
+
+	// Failed writes leave nothing behind past the last complete record
+	size_t end = journal.end;
+	_journalWrite = vf->write;
+	vf->write = _journalWriteLimited;
+	_journalWriteBudget = 64;
+	core->busWrite32(core, 0x02000000, 11);
+	assert_false(mStateJournalAppendCore(&journal, core, 0));
+	assert_int_equal(vf->size(vf), end);
+	assert_int_equal(mStateJournalCount(&journal), 11);
+	_journalWriteBudget = 8;
+	assert_false(mStateJournalFlush(&journal));
+	assert_int_equal(vf->size(vf), end);
+	vf->write = _journalWrite;
+	assert_true(mStateJournalAppendCore(&journal, core, 0));
+	assert_true(mStateJournalClose(&journal));
+
+	assert_true(mStateJournalOpen(&journal, vf));
+	assert_int_equal(mStateJournalCount(&journal), 12);
+	assert_true(mStateJournalLoad(&journal, core, 11, 0));
+	assert_int_equal(core->busRead32(core, 0x02000000), 11);
+	mStateJournalClose(&journal);
+
+	out->close(out);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(movie) {
+	struct mCore* core = *state;
+
+	struct mMovie movie;
+	mMovieInit(&movie);
+	mMovieAttach(&movie, core);
+	movie.keyframeInterval = 30;
+	assert_true(mMovieRecord(&movie));
+	uint32_t i;
+	for (i = 0; i < 100; ++i) {
+		core->setKeys(core, i & 0x3FF);
+		core->runFrame(core);
+	}
+	mMovieStop(&movie);
+	assert_int_equal(mMovieFrameCount(&movie), 100);
+	assert_int_equal(mMovieKeyframeListSize(&movie.keyframes), 4);
+	size_t size;
+	void* iwram = core->getMemoryBlock(core, GBA_REGION_IWRAM, &size);
+	uint8_t* expected = malloc(size);
+	memcpy(expected, iwram, size);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mMovieSave(&movie, vf));
+	assert_true(mMovieLoad(&movie, vf));
+	assert_int_equal(mMovieFrameCount(&movie), 100);
+
+	core->setKeys(core, 0);
+	core->runFrame(core);
+	assert_true(mMoviePlay(&movie));
+	for (i = 0; i < 50; ++i) {
+		assert_int_equal(core->getKeys(core), i & 0x3FF);
+		core->runFrame(core);
+	}
+
+	// Seeking replays from the nearest keyframe and ends up in the same place
+	assert_true(mMovieSeek(&movie, 100));
+	assert_int_equal(movie.mode, mMOVIE_IDLE);
+	assert_memory_equal(core->getMemoryBlock(core, GBA_REGION_IWRAM, &size), expected, size);
+	assert_true(mMovieSeek(&movie, 75));
+	assert_int_equal(core->getKeys(core), 75);
+
+	free(expected);
+	vf->close(vf);
+	mMovieDeinit(&movie);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBACore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
-	cmocka_unit_test(loadNullROM))
+	cmocka_unit_test(loadNullROM),
+	cmocka_unit_test_setup(incrementalState, _resetCore),
+	cmocka_unit_test_setup(stateBuffer, _resetCore),
+	cmocka_unit_test_setup(loadStateStores, _resetCore),
+	cmocka_unit_test_setup(rawStateLayout, _resetCore),
+#ifdef USE_PNG
+	cmocka_unit_test_setup(pngState, _resetCore),
+#endif
+	cmocka_unit_test_setup(rewindSeek, _resetCore),
+	cmocka_unit_test_setup(stateTree, _resetCore),
+	cmocka_unit_test_setup(stateJournal, _resetCore),
+	cmocka_unit_test_setup(movie, _resetCore))
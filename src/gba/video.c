@@ -405,7 +405,6 @@ static void GBAVideoDummyRendererPutPixels(struct GBAVideoRenderer* renderer, si
 }
 
 void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState* state) {
-	memcpy(state->vram, video->vram, GBA_SIZE_VRAM);
 	memcpy(state->oam, video->oam.raw, GBA_SIZE_OAM);
 	memcpy(state->pram, video->palette, GBA_SIZE_PALETTE_RAM);
 	STORE_32(video->event.when - mTimingCurrentTime(&video->p->timing), 0, &state->video.nextEvent);
@@ -420,7 +419,7 @@ void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState*
 }
 
 void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state) {
-	memcpy(video->vram, state->vram, GBA_SIZE_VRAM);
+	GBAMemoryLoadPages(&video->p->memory, GBA_DIRTY_PAGE_VRAM, video->vram, state->vram, GBA_SIZE_VRAM);
 	uint16_t value;
 	int i;
 	for (i = 0; i < GBA_SIZE_OAM; i += 2) {
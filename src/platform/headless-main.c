@@ -23,49 +23,107 @@
 #endif
 
 #include <mgba/feature/commandline.h>
+#include <mgba/feature/movie.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define HEADLESS_OPTIONS "S:R:N:j:"
+#define HEADLESS_MAX_INSTANCES 4096
+
+// Frames an instance runs before its worker lets other instances have a turn
+#define HEADLESS_SLICE_FRAMES 60
 
-#define HEADLESS_OPTIONS "S:R:"
 static const char* const headlessUsage =
 	"Additional options:\n"
 	"  -S SWI           Run until specified SWI call before exiting\n"
 	"  -R REGISTER      General purpose register to return as exit code\n"
+	"  -N COUNT         Run COUNT instances of the game, each with its own scripts\n"
+#ifndef DISABLE_THREADING
+	"  -j JOBS          Number of threads to run the instances on\n"
+#endif
 #ifdef ENABLE_SCRIPTING
 	"  --script FILE    Run a script on start. Can be passed multiple times\n"
 #endif
+	"  --movie FILE     Record the input to a movie FILE. Only one instance can be run\n"
 	;
 
 struct HeadlessOpts {
 	int exitSwiImmediate;
 	char* returnCodeRegister;
 	struct StringList scripts;
+	char* movie;
+	unsigned instances;
+	unsigned jobs;
+};
+
+struct HeadlessInstance {
+	struct mCore* core;
+	unsigned index;
+	struct mCoreCallbacks callbacks;
+	bool exiting;
+	int exitCode;
+	struct mMovie* movie;
+	struct VFile* movieFile;
+#ifdef ENABLE_SCRIPTING
+	bool hasScripts;
+	struct mScriptContext scriptContext;
+#endif
+};
+
+// A file that is read once and then handed to every instance
+struct HeadlessImage {
+	struct VFile* vf;
+	void* data;
+	size_t size;
+};
+
+struct HeadlessQueue {
+	Mutex mutex;
+	struct HeadlessInstance** instances;
+	size_t capacity;
+	size_t head;
+	size_t size;
 };
 
 static void _headlessShutdown(int signal);
 static bool _parseHeadlessOpts(struct mSubParser* parser, int option, const char* arg);
 static bool _parseLongHeadlessOpts(struct mSubParser* parser, const char* option, const char* arg);
 static bool _parseSwi(const char* regStr, int* oSwi);
+static bool _parseCount(const char* countStr, unsigned* oCount);
+
+static bool _headlessCheckResiger(struct mCore* core);
+static bool _headlessLoad(struct HeadlessInstance* instance, const struct mArguments* args, const struct mCoreConfig* config);
+static bool _headlessStart(struct HeadlessInstance* instance, const struct mArguments* args, const struct HeadlessOpts* opts, const struct HeadlessImage* savestate, const struct HeadlessImage* scripts);
+static bool _headlessRecordMovie(struct HeadlessInstance* instance, const char* path);
+static void _headlessSaveMovie(struct HeadlessInstance* instance);
+static void _headlessRunBatch(unsigned jobs);
 
-static bool _headlessCheckResiger(void);
+static bool _headlessImageMap(struct HeadlessImage* image, struct VFile* vf);
+static void _headlessImageUnmap(struct HeadlessImage* image);
 
-static struct mCore* core;
+static struct HeadlessInstance* _instances;
+static unsigned _nInstances;
 
 static bool _dispatchExiting = false;
 static int _exitCode = 0;
 static struct mStandardLogger _logger;
 
+static int _exitSwiImmediate;
+static char* _returnCodeRegister;
+
 static void _headlessCallback(void* context);
 #ifdef M_CORE_GBA
 static void _headlessSwi16(struct ARMCore* cpu, int immediate);
 static void _headlessSwi32(struct ARMCore* cpu, int immediate);
 
-static int _exitSwiImmediate;
-static char* _returnCodeRegister;
-
 void (*_armSwi16)(struct ARMCore* cpu, int immediate);
 void (*_armSwi32)(struct ARMCore* cpu, int immediate);
 #endif
@@ -77,7 +135,7 @@ int main(int argc, char * argv[]) {
 	int uncleanExit = 1;
 	size_t i;
 
-	struct HeadlessOpts headlessOpts = { 3, NULL };
+	struct HeadlessOpts headlessOpts = { 3, NULL, .instances = 1 };
 	StringListInit(&headlessOpts.scripts, 0);
 	struct mSubParser subparser = {
 		.usage = headlessUsage,
@@ -89,6 +147,20 @@ int main(int argc, char * argv[]) {
 				.name = "script",
 				.arg = true,
 			},
+			{
+				.name = "instances",
+				.arg = true,
+				.shortEquiv = 'N',
+			},
+			{
+				.name = "jobs",
+				.arg = true,
+				.shortEquiv = 'j',
+			},
+			{
+				.name = "movie",
+				.arg = true,
+			},
 			{0}
 		},
 		.opts = &headlessOpts
@@ -96,7 +168,7 @@ int main(int argc, char * argv[]) {
 
 	struct mArguments args;
 	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
-	if (!args.fname) {
+	if (!args.fname || (headlessOpts.movie && headlessOpts.instances > 1)) {
 		parsed = false;
 	}
 	if (!parsed || args.showHelp) {
@@ -109,39 +181,187 @@ int main(int argc, char * argv[]) {
 		uncleanExit = 0;
 		goto argsExit;
 	}
-	core = mCoreFind(args.fname);
-	if (!core) {
-		goto argsExit;
-	}
-	core->init(core);
-	mCoreInitConfig(core, "headless");
-	mArgumentsApply(&args, NULL, 0, &core->config);
 
-	mCoreConfigSetDefaultValue(&core->config, "idleOptimization", "remove");
-	mCoreConfigSetDefaultIntValue(&core->config, "logToStdout", true);
-	mCoreLoadConfig(core);
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "headless");
+	mCoreConfigLoad(&config);
+	mArgumentsApply(&args, NULL, 0, &config);
+
+	mCoreConfigSetDefaultValue(&config, "idleOptimization", "remove");
+	mCoreConfigSetDefaultIntValue(&config, "logToStdout", true);
 
 	mStandardLoggerInit(&_logger);
-	mStandardLoggerConfig(&_logger, &core->config);
+	mStandardLoggerConfig(&_logger, &config);
 	mLogSetDefaultLogger(&_logger.d);
 
-	struct mCoreCallbacks callbacks = {0};
-
+	_exitSwiImmediate = headlessOpts.exitSwiImmediate;
 	_returnCodeRegister = headlessOpts.returnCodeRegister;
-	if (!_headlessCheckResiger()) {
-		goto loadError;
+
+#ifdef ENABLE_DEBUGGERS
+	struct mDebugger debugger;
+	bool hasDebugger = false;
+#endif
+
+	// Savestates and scripts are only read once, no matter how many
+	// instances there are. ROMs are still opened by each instance, since
+	// some cartridges write back into ROM; mapping the same file privately
+	// lets the OS share the pages until that happens.
+	struct HeadlessImage savestate = {0};
+	if (args.savestate) {
+		_headlessImageMap(&savestate, VFileOpen(args.savestate, O_RDONLY));
 	}
+	struct HeadlessImage* scripts = NULL;
+#ifdef ENABLE_SCRIPTING
+	scripts = calloc(StringListSize(&headlessOpts.scripts) + 1, sizeof(*scripts));
+	for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
+		const char* script = *StringListGetPointer(&headlessOpts.scripts, i);
+		if (!_headlessImageMap(&scripts[i], VFileOpen(script, O_RDONLY))) {
+			mLOG(STATUS, ERROR, "Failed to load script \"%s\"", script);
+			goto loadError;
+		}
+	}
+#endif
+
+	_nInstances = headlessOpts.instances;
+	_instances = calloc(_nInstances, sizeof(*_instances));
+	for (i = 0; i < _nInstances; ++i) {
+		struct HeadlessInstance* instance = &_instances[i];
+		instance->index = i;
+		if (!_headlessLoad(instance, &args, &config)) {
+			goto loadError;
+		}
 
+#ifdef ENABLE_DEBUGGERS
+		if (_nInstances == 1) {
+			mDebuggerInit(&debugger);
+			hasDebugger = mArgumentsApplyDebugger(&args, instance->core, &debugger);
+
+			if (hasDebugger) {
+				mDebuggerAttach(&debugger, instance->core);
+				mDebuggerEnter(&debugger, DEBUGGER_ENTER_MANUAL, NULL);
+			} else {
+				mDebuggerDeinit(&debugger);
+			}
+		}
+#endif
+
+		if (!_headlessStart(instance, &args, &headlessOpts, &savestate, scripts)) {
+			goto loadError;
+		}
+		if (headlessOpts.movie && !_headlessRecordMovie(instance, headlessOpts.movie)) {
+			goto loadError;
+		}
+	}
+
+	if (_nInstances == 1) {
+		struct mCore* core = _instances[0].core;
+#ifdef ENABLE_DEBUGGERS
+		if (hasDebugger) {
+			do {
+				mDebuggerRun(&debugger);
+			} while (!_dispatchExiting && !_instances[0].exiting && debugger.state != DEBUGGER_SHUTDOWN);
+		} else
+#endif
+		do {
+			core->runLoop(core);
+		} while (!_dispatchExiting && !_instances[0].exiting);
+	} else {
+		_headlessRunBatch(headlessOpts.jobs);
+	}
+	cleanExit = true;
+
+	// Report the first instance that failed, if any did
+	for (i = 0; i < _nInstances && !_exitCode; ++i) {
+		_exitCode = _instances[i].exitCode;
+	}
+
+loadError:
+	for (i = 0; i < _nInstances; ++i) {
+		struct HeadlessInstance* instance = &_instances[i];
+		if (!instance->core) {
+			continue;
+		}
+		instance->core->unloadROM(instance->core);
+#ifdef ENABLE_SCRIPTING
+		if (instance->hasScripts) {
+			mScriptContextDeinit(&instance->scriptContext);
+		}
+#endif
+	}
+
+#ifdef ENABLE_DEBUGGERS
+	if (hasDebugger) {
+		_instances[0].core->detachDebugger(_instances[0].core);
+		mDebuggerDeinit(&debugger);
+	}
+#endif
+
+	for (i = 0; i < _nInstances; ++i) {
+		struct mCore* core = _instances[i].core;
+		if (core) {
+			mCoreConfigDeinit(&core->config);
+			core->deinit(core);
+		}
+		// Movies can only be freed once their core's callbacks are gone
+		_headlessSaveMovie(&_instances[i]);
+	}
+	free(_instances);
+
+#ifdef ENABLE_SCRIPTING
+	for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
+		_headlessImageUnmap(&scripts[i]);
+	}
+#endif
+	free(scripts);
+	_headlessImageUnmap(&savestate);
+
+	mStandardLoggerDeinit(&_logger);
+	mCoreConfigDeinit(&config);
+	if (_returnCodeRegister) {
+		free(_returnCodeRegister);
+	}
+
+argsExit:
+	for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
+		free(*StringListGetPointer(&headlessOpts.scripts, i));
+	}
+	StringListDeinit(&headlessOpts.scripts);
+	free(headlessOpts.movie);
+	mArgumentsDeinit(&args);
+
+	return cleanExit ? _exitCode : uncleanExit;
+}
+
+static bool _headlessLoad(struct HeadlessInstance* instance, const struct mArguments* args, const struct mCoreConfig* config) {
+	// Only the first instance needs to look at the file to find its platform
+	struct mCore* core;
+	if (instance->index) {
+		core = mCoreCreate(_instances[0].core->platform(_instances[0].core));
+	} else {
+		core = mCoreFind(args->fname);
+	}
+	if (!core) {
+		return false;
+	}
+	core->init(core);
+	instance->core = core;
+	mCoreInitConfig(core, "headless");
+	mCoreLoadForeignConfig(core, config);
+
+	if (!_headlessCheckResiger(core)) {
+		return false;
+	}
+
+	instance->callbacks.context = instance;
 	switch (core->platform(core)) {
 #ifdef M_CORE_GBA
 	case mPLATFORM_GBA:
 		((struct GBA*) core->board)->hardCrash = false;
-		_exitSwiImmediate = headlessOpts.exitSwiImmediate;
 
 		if (_exitSwiImmediate == 3) {
 			// Hook into SWI 3 (shutdown)
-			callbacks.shutdown = _headlessCallback;
-			core->addCoreCallbacks(core, &callbacks);
+			instance->callbacks.shutdown = _headlessCallback;
+			core->addCoreCallbacks(core, &instance->callbacks);
 		} else {
 			// Custom SWI hooks
 			_armSwi16 = ((struct GBA*) core->board)->cpu->irqh.swi16;
@@ -153,113 +373,227 @@ int main(int argc, char * argv[]) {
 #endif
 #ifdef M_CORE_GB
 	case mPLATFORM_GB:
-		callbacks.shutdown = _headlessCallback;
-		core->addCoreCallbacks(core, &callbacks);
+		instance->callbacks.shutdown = _headlessCallback;
+		core->addCoreCallbacks(core, &instance->callbacks);
 		break;
 #endif
 	default:
-		goto loadError;
-	}
-
-	if (!mCoreLoadFile(core, args.fname)) {
-		goto loadError;
+		return false;
 	}
 
-#ifdef ENABLE_DEBUGGERS
-	struct mDebugger debugger;
-	mDebuggerInit(&debugger);
-	bool hasDebugger = mArgumentsApplyDebugger(&args, core, &debugger);
-
-	if (hasDebugger) {
-		mDebuggerAttach(&debugger, core);
-		mDebuggerEnter(&debugger, DEBUGGER_ENTER_MANUAL, NULL);
-	} else {
-		mDebuggerDeinit(&debugger);
-	}
-#endif
+	return mCoreLoadFile(core, args->fname);
+}
 
+static bool _headlessStart(struct HeadlessInstance* instance, const struct mArguments* args, const struct HeadlessOpts* opts, const struct HeadlessImage* savestate, const struct HeadlessImage* scripts) {
+	struct mCore* core = instance->core;
 	core->reset(core);
 
-	mArgumentsApplyFileLoads(&args, core);
+	mArgumentsApplyFileLoads(args, core);
 
-	struct VFile* savestate = NULL;
-	if (args.savestate) {
-		savestate = VFileOpen(args.savestate, O_RDONLY);
-	}
-	if (savestate) {
-		mCoreLoadStateNamed(core, savestate, 0);
-		savestate->close(savestate);
+	if (savestate->vf) {
+		struct VFile* vf = VFileFromConstMemory(savestate->data, savestate->size);
+		if (vf) {
+			mCoreLoadStateNamed(core, vf, 0);
+			vf->close(vf);
+		}
 	}
 
 #ifdef ENABLE_SCRIPTING
-	struct mScriptContext scriptContext;
+	if (!StringListSize(&opts->scripts)) {
+		return true;
+	}
 
-	if (StringListSize(&headlessOpts.scripts)) {
-		mScriptContextInit(&scriptContext);
-		mScriptContextAttachStdlib(&scriptContext);
-		mScriptContextAttachImage(&scriptContext);
-		mScriptContextAttachLogger(&scriptContext, NULL);
-		mScriptContextAttachSocket(&scriptContext);
+	struct mScriptContext* scriptContext = &instance->scriptContext;
+	mScriptContextInit(scriptContext);
+	instance->hasScripts = true;
+	mScriptContextAttachStdlib(scriptContext);
+	mScriptContextAttachImage(scriptContext);
+	mScriptContextAttachLogger(scriptContext, NULL);
+	mScriptContextAttachSocket(scriptContext);
 #ifdef USE_JSON_C
-		mScriptContextAttachStorage(&scriptContext);
+	mScriptContextAttachStorage(scriptContext);
 #endif
-		mScriptContextRegisterEngines(&scriptContext);
-
-		mScriptContextAttachCore(&scriptContext, core);
+	mScriptContextExportNamespace(scriptContext, "headless", (struct mScriptKVPair[]) {
+		mSCRIPT_KV_PAIR(instance, mScriptValueCreateFromUInt(instance->index)),
+		mSCRIPT_KV_PAIR(instances, mScriptValueCreateFromUInt(_nInstances)),
+		mSCRIPT_KV_SENTINEL
+	});
+	mScriptContextSetDocstring(scriptContext, "headless", "Information about the instances run by the headless frontend");
+	mScriptContextSetDocstring(scriptContext, "headless.instance", "Index of this instance, starting from 0");
+	mScriptContextSetDocstring(scriptContext, "headless.instances", "Number of instances running the same scripts");
+	mScriptContextRegisterEngines(scriptContext);
+
+	mScriptContextAttachCore(scriptContext, core);
 
-		for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
-			if (!mScriptContextLoadFile(&scriptContext, *StringListGetPointer(&headlessOpts.scripts, i))) {
-				mLOG(STATUS, ERROR, "Failed to load script \"%s\"", *StringListGetPointer(&headlessOpts.scripts, i));
-				goto scriptsError;
-			}
+	size_t i;
+	for (i = 0; i < StringListSize(&opts->scripts); ++i) {
+		const char* script = *StringListGetConstPointer(&opts->scripts, i);
+		struct VFile* vf = VFileFromConstMemory(scripts[i].data, scripts[i].size);
+		bool loaded = vf && mScriptContextLoadVF(scriptContext, script, vf);
+		if (vf) {
+			vf->close(vf);
+		}
+		if (!loaded) {
+			mLOG(STATUS, ERROR, "Failed to load script \"%s\"", script);
+			return false;
 		}
 	}
+#else
+	UNUSED(opts);
+	UNUSED(scripts);
 #endif
+	return true;
+}
 
-#ifdef ENABLE_DEBUGGERS
-	if (hasDebugger) {
-		do {
-			mDebuggerRun(&debugger);
-		} while (!_dispatchExiting && debugger.state != DEBUGGER_SHUTDOWN);
-	} else
-#endif
-	do {
-		core->runLoop(core);
-	} while (!_dispatchExiting);
-	cleanExit = true;
+// The movie is attached after any scripts, so it records the keys they set
+static bool _headlessRecordMovie(struct HeadlessInstance* instance, const char* path) {
+	instance->movieFile = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!instance->movieFile) {
+		mLOG(STATUS, ERROR, "Failed to open movie \"%s\"", path);
+		return false;
+	}
+	instance->movie = malloc(sizeof(*instance->movie));
+	mMovieInit(instance->movie);
+	mMovieAttach(instance->movie, instance->core);
+	if (!mMovieRecord(instance->movie)) {
+		mLOG(STATUS, ERROR, "Failed to start recording movie \"%s\"", path);
+		return false;
+	}
+	return true;
+}
 
-scriptsError:
-	core->unloadROM(core);
+static void _headlessSaveMovie(struct HeadlessInstance* instance) {
+	if (instance->movie) {
+		if (instance->movie->mode == mMOVIE_RECORDING) {
+			mMovieStop(instance->movie);
+			if (!mMovieSave(instance->movie, instance->movieFile)) {
+				mLOG(STATUS, ERROR, "Failed to save movie");
+			}
+		}
+		mMovieDeinit(instance->movie);
+		free(instance->movie);
+		instance->movie = NULL;
+	}
+	if (instance->movieFile) {
+		instance->movieFile->close(instance->movieFile);
+		instance->movieFile = NULL;
+	}
+}
 
-#ifdef ENABLE_SCRIPTING
-	if (StringListSize(&headlessOpts.scripts)) {
-		mScriptContextDeinit(&scriptContext);
+static void _headlessWork(struct HeadlessQueue* queue) {
+	struct HeadlessInstance* instance = NULL;
+	while (true) {
+		// Instances that are still running go to the back of the queue, so
+		// every instance gets a turn even when there are fewer workers
+		MutexLock(&queue->mutex);
+		if (instance && !instance->exiting) {
+			queue->instances[(queue->head + queue->size) % queue->capacity] = instance;
+			++queue->size;
+		}
+		instance = NULL;
+		if (queue->size && !_dispatchExiting) {
+			instance = queue->instances[queue->head];
+			queue->head = (queue->head + 1) % queue->capacity;
+			--queue->size;
+		}
+		MutexUnlock(&queue->mutex);
+		if (!instance) {
+			break;
+		}
+
+		struct mCore* core = instance->core;
+		int frame;
+		for (frame = 0; frame < HEADLESS_SLICE_FRAMES && !instance->exiting && !_dispatchExiting; ++frame) {
+			core->runFrame(core);
+		}
 	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _headlessWorkerThread(void* context) {
+	ThreadSetName("Headless worker");
+	_headlessWork(context);
+	THREAD_EXIT(0);
+}
+
+static unsigned _headlessCpuCount(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+#endif
+}
 #endif
 
-#ifdef ENABLE_DEBUGGERS
-	if (hasDebugger) {
-		core->detachDebugger(core);
-		mDebuggerDeinit(&debugger);
+static void _headlessRunBatch(unsigned jobs) {
+	struct HeadlessQueue queue = {
+		.instances = calloc(_nInstances, sizeof(struct HeadlessInstance*)),
+		.capacity = _nInstances,
+		.head = 0,
+		.size = _nInstances,
+	};
+	MutexInit(&queue.mutex);
+	size_t i;
+	for (i = 0; i < _nInstances; ++i) {
+		queue.instances[i] = &_instances[i];
 	}
-#endif
 
-loadError:
-	mStandardLoggerDeinit(&_logger);
-	mCoreConfigDeinit(&core->config);
-	core->deinit(core);
-	if (_returnCodeRegister) {
-		free(_returnCodeRegister);
+#ifndef DISABLE_THREADING
+	if (!jobs) {
+		jobs = _headlessCpuCount();
 	}
+	if (jobs > _nInstances) {
+		jobs = _nInstances;
+	}
+	// The main thread is one of the workers
+	Thread* threads = calloc(jobs, sizeof(*threads));
+	unsigned nThreads;
+	for (nThreads = 0; nThreads + 1 < jobs; ++nThreads) {
+		if (ThreadCreate(&threads[nThreads], _headlessWorkerThread, &queue)) {
+			mLOG(STATUS, WARN, "Could only start %u of %u worker threads", nThreads + 1, jobs);
+			break;
+		}
+	}
+	_headlessWork(&queue);
+	for (i = 0; i < nThreads; ++i) {
+		ThreadJoin(&threads[i]);
+	}
+	free(threads);
+#else
+	UNUSED(jobs);
+	_headlessWork(&queue);
+#endif
 
-argsExit:
-	for (i = 0; i < StringListSize(&headlessOpts.scripts); ++i) {
-		free(*StringListGetPointer(&headlessOpts.scripts, i));
+	MutexDeinit(&queue.mutex);
+	free(queue.instances);
+}
+
+static bool _headlessImageMap(struct HeadlessImage* image, struct VFile* vf) {
+	if (!vf) {
+		return false;
 	}
-	StringListDeinit(&headlessOpts.scripts);
-	mArgumentsDeinit(&args);
+	ssize_t size = vf->size(vf);
+	void* data = size > 0 ? vf->map(vf, size, MAP_READ) : NULL;
+	if (!data) {
+		vf->close(vf);
+		return false;
+	}
+	image->vf = vf;
+	image->data = data;
+	image->size = size;
+	return true;
+}
 
-	return cleanExit ? _exitCode : uncleanExit;
+static void _headlessImageUnmap(struct HeadlessImage* image) {
+	if (!image->vf) {
+		return;
+	}
+	image->vf->unmap(image->vf, image->data, image->size);
+	image->vf->close(image->vf);
+	image->vf = NULL;
 }
 
 static void _headlessShutdown(int signal) {
@@ -267,7 +601,7 @@ static void _headlessShutdown(int signal) {
 	_dispatchExiting = true;
 }
 
-static bool _headlessCheckResiger(void) {
+static bool _headlessCheckResiger(struct mCore* core) {
 	if (!_returnCodeRegister) {
 		return true;
 	}
@@ -313,32 +647,41 @@ static bool _headlessCheckResiger(void) {
 	return true;
 }
 
-static void _headlessCallback(void* context) {
-	UNUSED(context);
+static void _headlessExit(struct HeadlessInstance* instance) {
 	if (_returnCodeRegister) {
-		core->readRegister(core, _returnCodeRegister, &_exitCode);
+		instance->core->readRegister(instance->core, _returnCodeRegister, &instance->exitCode);
 	}
-	_dispatchExiting = true;
+	instance->exiting = true;
+}
+
+static void _headlessCallback(void* context) {
+	_headlessExit(context);
 }
 
 #ifdef M_CORE_GBA
-static void _headlessSwi16(struct ARMCore* cpu, int immediate) {
-	if (immediate == _exitSwiImmediate) {
-		if (_returnCodeRegister) {
-			core->readRegister(core, _returnCodeRegister, &_exitCode);
+static struct HeadlessInstance* _headlessFindInstance(struct ARMCore* cpu) {
+	unsigned i;
+	for (i = 0; i < _nInstances; ++i) {
+		if (_instances[i].core && _instances[i].core->cpu == cpu) {
+			return &_instances[i];
 		}
-		_dispatchExiting = true;
+	}
+	return NULL;
+}
+
+static void _headlessSwi16(struct ARMCore* cpu, int immediate) {
+	struct HeadlessInstance* instance;
+	if (immediate == _exitSwiImmediate && (instance = _headlessFindInstance(cpu))) {
+		_headlessExit(instance);
 		return;
 	}
 	_armSwi16(cpu, immediate);
 }
 
 static void _headlessSwi32(struct ARMCore* cpu, int immediate) {
-	if (immediate == _exitSwiImmediate) {
-		if (_returnCodeRegister) {
-			core->readRegister(core, _returnCodeRegister, &_exitCode);
-		}
-		_dispatchExiting = true;
+	struct HeadlessInstance* instance;
+	if (immediate == _exitSwiImmediate && (instance = _headlessFindInstance(cpu))) {
+		_headlessExit(instance);
 		return;
 	}
 	_armSwi32(cpu, immediate);
@@ -354,6 +697,10 @@ static bool _parseHeadlessOpts(struct mSubParser* parser, int option, const char
 	case 'R':
 		opts->returnCodeRegister = strdup(arg);
 		return true;
+	case 'N':
+		return _parseCount(arg, &opts->instances) && opts->instances <= HEADLESS_MAX_INSTANCES;
+	case 'j':
+		return _parseCount(arg, &opts->jobs);
 	default:
 		return false;
 	}
@@ -365,6 +712,11 @@ static bool _parseLongHeadlessOpts(struct mSubParser* parser, const char* option
 		*StringListAppend(&opts->scripts) = strdup(arg);
 		return true;
 	}
+	if (strcmp(option, "movie") == 0) {
+		free(opts->movie);
+		opts->movie = strdup(arg);
+		return true;
+	}
 	return false;
 }
 
@@ -377,3 +729,13 @@ static bool _parseSwi(const char* swiStr, int* oSwi) {
 	*oSwi = swi;
 	return true;
 }
+
+static bool _parseCount(const char* countStr, unsigned* oCount) {
+	char* parseEnd;
+	long count = strtol(countStr, &parseEnd, 0);
+	if (errno || count < 1 || count > INT_MAX || *parseEnd) {
+		return false;
+	}
+	*oCount = count;
+	return true;
+}
@@ -64,6 +64,9 @@ static void _updateRotation(struct mRotationSource* source);
 static int32_t _readTiltX(struct mRotationSource* source);
 static int32_t _readTiltY(struct mRotationSource* source);
 static int32_t _readGyroZ(struct mRotationSource* source);
+static bool _prepareRunAhead(void);
+static void _runAhead(void);
+static void _dropRunAheadSavedata(void);
 
 static struct mCore* core;
 static mColor* outputBuffer = NULL;
@@ -104,6 +107,12 @@ static bool audioLowPassEnabled = false;
 static int32_t audioLowPassRange = 0;
 static int32_t audioLowPassLeftPrev = 0;
 static int32_t audioLowPassRightPrev = 0;
+static void* runAheadState = NULL;
+static size_t runAheadStateSize = 0;
+static void* runAheadSavedata = NULL;
+static size_t runAheadSavedataSize = 0;
+static uint64_t runAheadSavedataStamp = 0;
+static bool runAheadSpeculative = false;
 
 static const int keymap[] = {
 	RETRO_DEVICE_ID_JOYPAD_A,
@@ -315,6 +324,12 @@ static void _reloadSettings(void) {
 		opts.frameskip = strtol(var.value, NULL, 10);
 	}
 
+	var.key = "mgba_run_ahead";
+	var.value = 0;
+	if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+		opts.runAhead = strtol(var.value, NULL, 10);
+	}
+
 	_loadAudioLowPassFilterSettings();
 
 	var.key = "mgba_idle_optimization";
@@ -567,6 +582,13 @@ void retro_run(void) {
 			core->reloadConfigOption(core, "frameskip", NULL);
 		}
 
+		var.key = "mgba_run_ahead";
+		var.value = 0;
+		if (environCallback(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+			core->opts.runAhead = strtol(var.value, NULL, 10);
+			mCoreConfigSetIntValue(&core->config, "runAhead", core->opts.runAhead);
+		}
+
 #ifdef M_CORE_GB
 		_updateGbPal();
 #endif
@@ -608,10 +630,20 @@ void retro_run(void) {
 		}
 	}
 
+	bool runAhead = core->opts.runAhead > 0 && _prepareRunAhead();
+	if (runAhead && core->skipFrames) {
+		/* Only the last frame run ahead is shown, so skip rendering the rest */
+		core->skipFrames(core, core->opts.runAhead);
+	}
 	core->runFrame(core);
-	unsigned width, height;
-	core->currentVideoSize(core, &width, &height);
-	videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+	if (runAhead) {
+		_runAhead();
+	} else {
+		_dropRunAheadSavedata();
+		unsigned width, height;
+		core->currentVideoSize(core, &width, &height);
+		videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+	}
 
 #ifdef M_CORE_GBA
 	if (core->platform(core) == mPLATFORM_GBA) {
@@ -645,6 +677,83 @@ void retro_run(void) {
 #endif
 }
 
+static void _dropRunAheadSavedata(void) {
+	free(runAheadSavedata);
+	runAheadSavedata = NULL;
+	runAheadSavedataSize = 0;
+}
+
+static bool _prepareRunAhead(void) {
+	size_t stateSize = core->stateSize(core);
+	if (runAheadStateSize < stateSize) {
+		if (runAheadState) {
+			mappedMemoryFree(runAheadState, runAheadStateSize);
+		}
+		runAheadState = anonymousMemoryMap(stateSize);
+		if (!runAheadState) {
+			runAheadStateSize = 0;
+			mLOG(STATUS, ERROR, "Could not allocate run-ahead state, disabling run-ahead");
+			core->opts.runAhead = 0;
+			return false;
+		}
+		runAheadStateSize = stateSize;
+	}
+	return true;
+}
+
+/* Run ahead of the frame that was just emulated with the
+ * same input and show the last frame reached, then go back.
+ * Audio generated while running ahead is thrown away */
+static void _runAhead(void) {
+	size_t stateSize = core->stateSize(core);
+	mCoreSaveStateBuffer(core, runAheadState, stateSize, 0);
+	/* Savedata isn't part of the state that gets loaded back, so
+	 * keep a copy, refreshed only once the game has written to it */
+	uint64_t stamp = 0;
+	if (core->savedataStamp) {
+		stamp = core->savedataStamp(core);
+		if (runAheadSavedata && stamp != runAheadSavedataStamp) {
+			_dropRunAheadSavedata();
+		}
+	} else {
+		_dropRunAheadSavedata();
+	}
+	if (!runAheadSavedata) {
+		runAheadSavedataSize = core->savedataClone(core, &runAheadSavedata);
+		runAheadSavedataStamp = stamp;
+	}
+
+	struct mAudioBuffer* buffer = core->getAudioBuffer(core);
+	struct mAudioBuffer realAudio = *buffer;
+	runAheadSpeculative = true;
+	int i;
+	for (i = 0; i < core->opts.runAhead; ++i) {
+		core->runFrame(core);
+	}
+	runAheadSpeculative = false;
+
+	unsigned width, height;
+	core->currentVideoSize(core, &width, &height);
+	videoCallback(outputBuffer, width, height, BYTES_PER_PIXEL * 256);
+
+	mCoreLoadStateBuffer(core, runAheadState, stateSize, 0);
+	*buffer = realAudio;
+	if (runAheadSavedataSize) {
+		if (!core->savedataStamp) {
+			void* speculated = NULL;
+			size_t speculatedSize = core->savedataClone(core, &speculated);
+			if (speculatedSize != runAheadSavedataSize || memcmp(speculated, runAheadSavedata, speculatedSize) != 0) {
+				core->savedataRestore(core, runAheadSavedata, runAheadSavedataSize, true);
+			}
+			free(speculated);
+		} else if (core->savedataStamp(core) != stamp) {
+			core->savedataRestore(core, runAheadSavedata, runAheadSavedataSize, true);
+			/* The stamp can't be trusted to move on the next write anymore */
+			_dropRunAheadSavedata();
+		}
+	}
+}
+
 static void _setupMaps(struct mCore* core) {
 #ifdef M_CORE_GBA
 	if (core->platform(core) == mPLATFORM_GBA) {
@@ -834,6 +943,7 @@ static void _setupMaps(struct mCore* core) {
 
 void retro_reset(void) {
 	core->reset(core);
+	_dropRunAheadSavedata();
 	mRumbleIntegratorReset(&rumble);
 	_setupMaps(core);
 }
@@ -1000,6 +1110,12 @@ void retro_unload_game(void) {
 	data = 0;
 	mappedMemoryFree(savedata, GBA_SIZE_FLASH1M);
 	savedata = 0;
+	if (runAheadState) {
+		mappedMemoryFree(runAheadState, runAheadStateSize);
+		runAheadState = NULL;
+		runAheadStateSize = 0;
+	}
+	_dropRunAheadSavedata();
 }
 
 size_t retro_serialize_size(void) {
@@ -1038,6 +1154,7 @@ bool retro_unserialize(const void* data, size_t size) {
 	struct VFile* vfm = VFileFromConstMemory(data, size);
 	bool success = mCoreLoadStateNamed(core, vfm, SAVESTATE_RTC);
 	vfm->close(vfm);
+	_dropRunAheadSavedata();
 	return success;
 }
 
@@ -1236,6 +1353,9 @@ void GBARetroLog(struct mLogger* logger, int category, enum mLogLevel level, con
 /* Used only for GB/GBC content */
 static void _postAudioBuffer(struct mAVStream* stream, struct mAudioBuffer* buffer) {
 	UNUSED(stream);
+	if (runAheadSpeculative) {
+		return;
+	}
 	int produced = mAudioBufferRead(buffer, audioSampleBuffer, GB_SAMPLES);
 	if (produced > 0) {
 		if (audioLowPassEnabled) {
@@ -304,6 +304,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
       },
       "0"
    },
+   {
+      "mgba_run_ahead",
+      "Run-Ahead",
+      NULL,
+      "Hide the game's internal input lag by running this many frames ahead every frame and showing the result. Each frame of run-ahead costs a full extra frame of emulation.",
+      NULL,
+      "performance",
+      {
+         { "0", "disabled" },
+         { "1", NULL },
+         { "2", NULL },
+         { "3", NULL },
+         { "4", NULL },
+         { NULL, NULL },
+      },
+      "0"
+   },
    { NULL, NULL, NULL, NULL, NULL, NULL, {{0}}, NULL },
 };
 
@@ -144,6 +144,7 @@ ConfigController::ConfigController(QObject* parent)
 	m_opts.rewindEnable = false;
 	m_opts.rewindBufferCapacity = 300;
 	m_opts.rewindBufferInterval = 1;
+	m_opts.rewindBufferMemory = 64;
 	m_opts.useBios = true;
 	m_opts.suspendScreensaver = true;
 	m_opts.lockAspectRatio = true;
@@ -314,6 +314,13 @@ void CoreController::loadConfig(ConfigController* config) {
 
 	mCoreLoadForeignConfig(m_threadContext.core, config->config());
 
+	m_runAhead = m_threadContext.core->opts.runAhead;
+	QVariant gameRunAhead = config->getQtOption(runAheadKey(m_crc32), "runAhead");
+	if (gameRunAhead.isValid()) {
+		m_runAhead = gameRunAhead.toInt();
+	}
+	updateRunAhead();
+
 	QSize sizeAfter = screenDimensions();
 	m_activeBuffer.resize(sizeAfter.width() * sizeAfter.height() * sizeof(mColor));
 	m_threadContext.core->setVideoBuffer(m_threadContext.core, reinterpret_cast<mColor*>(m_activeBuffer.data()), sizeAfter.width());
@@ -372,6 +379,7 @@ void CoreController::setMultiplayerController(MultiplayerController* controller)
 	}
 	clearMultiplayerController();
 	m_multiplayer = controller;
+	updateRunAhead();
 	if (!mCoreThreadHasStarted(&m_threadContext)) {
 		return;
 	}
@@ -387,6 +395,12 @@ void CoreController::clearMultiplayerController() {
 	}
 	m_multiplayer->detachGame(this);
 	m_multiplayer = nullptr;
+	updateRunAhead();
+}
+
+void CoreController::updateRunAhead() {
+	// Frames that are run ahead and thrown away must not reach a recording or a link partner
+	m_threadContext.core->opts.runAhead = (m_avStreaming || m_multiplayer) ? 0 : m_runAhead;
 }
 
 mCacheSet* CoreController::graphicCaches() {
@@ -572,7 +586,13 @@ void CoreController::rewind(int states) {
 	if (!states) {
 		states = INT_MAX;
 	}
-	mCoreRewindRestore(&m_threadContext.impl->rewind, m_threadContext.core, states);
+	if (mCoreThreadRewindSeek(&m_threadContext, states) && !m_hwaccel) {
+		unsigned width, height;
+		m_threadContext.core->currentVideoSize(m_threadContext.core, &width, &height);
+
+		QMutexLocker locker(&m_bufferMutex);
+		memcpy(m_completeBuffer.data(), m_activeBuffer.constData(), width * height * BYTES_PER_PIXEL);
+	}
 	interrupter.resume();
 	emit frameAvailable();
 	emit rewound();
@@ -1144,11 +1164,15 @@ void CoreController::setBattleChipFlavor(int flavor) {
 void CoreController::setAVStream(mAVStream* stream) {
 	Interrupter interrupter(this);
 	m_threadContext.core->setAVStream(m_threadContext.core, stream);
+	m_avStreaming = true;
+	updateRunAhead();
 }
 
 void CoreController::clearAVStream() {
 	Interrupter interrupter(this);
 	m_threadContext.core->setAVStream(m_threadContext.core, nullptr);
+	m_avStreaming = false;
+	updateRunAhead();
 }
 
 void CoreController::clearOverride() {
@@ -97,6 +97,7 @@ public:
 	QString title() { return m_dbTitle.isNull() ? m_internalTitle : m_dbTitle; }
 	QString intenralTitle() { return m_internalTitle; }
 	QString dbTitle() { return m_dbTitle; }
+	uint32_t crc32() const { return m_crc32; }
 
 	mPlatform platform() const;
 	QSize screenDimensions() const;
@@ -105,6 +106,7 @@ public:
 	bool hardwareAccelerated() const { return m_hwaccel; }
 
 	void loadConfig(ConfigController*);
+	static QString runAheadKey(uint32_t crc32) { return QString::number(crc32, 16); }
 
 	mCheatDevice* cheatDevice() { return m_threadContext.core->cheatDevice(m_threadContext.core); }
 
@@ -250,6 +252,7 @@ private:
 	void updatePlayerSave();
 
 	void updateFastForward();
+	void updateRunAhead();
 
 	void updateROMInfo();
 
@@ -306,6 +309,8 @@ private:
 
 	bool m_audioSync = AUDIO_SYNC;
 	bool m_videoSync = VIDEO_SYNC;
+	int m_runAhead = 0;
+	bool m_avStreaming = false;
 
 	bool m_autosave;
 	bool m_autoload;
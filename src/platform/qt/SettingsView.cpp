@@ -512,6 +512,8 @@ void SettingsView::updateConfig() {
 	saveSetting("rewindEnable", m_ui.rewind);
 	saveSetting("rewindBufferCapacity", m_ui.rewindCapacity);
 	saveSetting("rewindBufferInterval", m_ui.rewindBufferInterval);
+	saveSetting("runAhead", m_ui.runAhead);
+	saveSetting("rewindBufferMemory", m_ui.rewindBufferMemory);
 	saveSetting("resampleVideo", m_ui.resampleVideo);
 	saveSetting("allowOpposingDirections", m_ui.allowOpposingDirections);
 	saveSetting("suspendScreensaver", m_ui.suspendScreensaver);
@@ -736,6 +738,8 @@ void SettingsView::reloadConfig() {
 	loadSetting("rewindEnable", m_ui.rewind);
 	loadSetting("rewindBufferCapacity", m_ui.rewindCapacity);
 	loadSetting("rewindBufferInterval", m_ui.rewindBufferInterval);
+	loadSetting("runAhead", m_ui.runAhead);
+	loadSetting("rewindBufferMemory", m_ui.rewindBufferMemory);
 	loadSetting("resampleVideo", m_ui.resampleVideo);
 	loadSetting("allowOpposingDirections", m_ui.allowOpposingDirections);
 	loadSetting("suspendScreensaver", m_ui.suspendScreensaver);
@@ -913,6 +913,7 @@ void Window::gameStarted() {
 
 	reloadAudioDriver();
 	multiplayerChanged();
+	updateRunAhead();
 	updateTitle();
 
 	m_hitUnimplementedBiosCall = false;
@@ -1008,6 +1009,7 @@ void Window::gameStopped() {
 		Q_UNUSED(controller);
 	});
 	detachWidget();
+	updateRunAhead();
 	updateTitle();
 
 	if (m_pendingClose) {
@@ -1539,6 +1541,38 @@ void Window::setupMenu(QMenuBar* menubar) {
 	}, "emu", QKeySequence("Ctrl+B"));
 	m_nonMpActions.append(frameRewind);
 
+	m_actions.addMenu(tr("Run-&ahead"), "runAhead", "emu");
+	ConfigOption* runAhead = m_config->addOption("runAhead");
+	runAhead->connect([this](const QVariant&) {
+		reloadConfig();
+		updateRunAhead();
+	}, this);
+	for (int i = 0; i <= 4; ++i) {
+		QString text = i ? tr("%n frame(s)", nullptr, i) : tr("Off");
+		auto action = m_actions.addAction(text, QString("runAhead.%1").arg(i), [this, i]() {
+			if (m_controller && m_runAheadPerGame->isActive()) {
+				m_config->setQtOption(CoreController::runAheadKey(m_controller->crc32()), i, "runAhead");
+				reloadConfig();
+				updateRunAhead();
+			} else {
+				m_config->setOption("runAhead", i);
+			}
+		}, "runAhead");
+		action->setExclusive();
+		m_runAheadFrames[i] = action;
+	}
+	m_actions.addSeparator("runAhead");
+	m_runAheadPerGame = addGameAction(tr("Use for this game only"), "runAheadPerGame", [this](bool perGame) {
+		QVariant frames;
+		if (perGame) {
+			frames = m_config->getOption("runAhead").toInt();
+		}
+		m_config->setQtOption(CoreController::runAheadKey(m_controller->crc32()), frames, "runAhead");
+		reloadConfig();
+		updateRunAhead();
+	}, "runAhead");
+	updateRunAhead();
+
 	m_actions.addSeparator("emu");
 
 	m_actions.addMenu(tr("Solar sensor"), "solar", "emu");
@@ -1954,6 +1988,11 @@ void Window::setupOptions() {
 		reloadConfig();
 	}, this);
 
+	ConfigOption* rewindBufferMemory = m_config->addOption("rewindBufferMemory");
+	rewindBufferMemory->connect([this](const QVariant&) {
+		reloadConfig();
+	}, this);
+
 	ConfigOption* allowOpposingDirections = m_config->addOption("allowOpposingDirections");
 	allowOpposingDirections->connect([this](const QVariant&) {
 		reloadConfig();
@@ -2373,6 +2412,22 @@ void Window::updateMute() {
 	m_controller->overrideMute(mute);
 }
 
+void Window::updateRunAhead() {
+	int frames = m_config->getOption("runAhead").toInt();
+	bool perGame = false;
+	if (m_controller) {
+		QVariant gameFrames = m_config->getQtOption(CoreController::runAheadKey(m_controller->crc32()), "runAhead");
+		if (gameFrames.isValid()) {
+			frames = gameFrames.toInt();
+			perGame = true;
+		}
+	}
+	for (auto iter = m_runAheadFrames.begin(); iter != m_runAheadFrames.end(); ++iter) {
+		iter.value()->setActive(iter.key() == frames);
+	}
+	m_runAheadPerGame->setActive(perGame);
+}
+
 void Window::setLogo() {
 	m_screenWidget->setPixmap(m_logo);
 	m_screenWidget->setDimensions(m_logo.width(), m_logo.height());
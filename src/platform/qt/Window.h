@@ -164,6 +164,7 @@ private slots:
 
 	void updateFrame();
 	void updateMute();
+	void updateRunAhead();
 
 	void setLogo();
 
@@ -214,6 +215,8 @@ private:
 	QMultiMap<mPlatform, std::shared_ptr<Action>> m_platformActions;
 	std::shared_ptr<Action> m_multiWindow;
 	QMap<int, std::shared_ptr<Action>> m_frameSizes;
+	QMap<int, std::shared_ptr<Action>> m_runAheadFrames;
+	std::shared_ptr<Action> m_runAheadPerGame;
 
 	LogController m_log{0};
 	LogView* m_logView;
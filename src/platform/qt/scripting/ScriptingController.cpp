@@ -26,6 +26,8 @@
 #include <mgba-util/math.h>
 #include <mgba-util/string.h>
 
+#include <algorithm>
+
 using namespace QGBA;
 
 ScriptingController::ScriptingController(ConfigController* config, QObject* parent)
@@ -176,6 +178,63 @@ void ScriptingController::openAutorunEdit() {
 	emit autorunScriptsOpened(view);
 }
 
+void ScriptingController::setProfiling(bool enable) {
+	CoreController::Interrupter interrupter(m_controller);
+	m_profiling = enable;
+	mScriptContextSetProfiling(&m_scriptContext, enable);
+}
+
+void ScriptingController::showProfile() {
+	struct CallbackProfile {
+		uint32_t id;
+		QString callback;
+		uint64_t calls;
+		uint64_t usec;
+		uint64_t deferred;
+	};
+	QList<CallbackProfile> callbacks;
+	QList<QPair<uint64_t, QString>> functions;
+	{
+		CoreController::Interrupter interrupter(m_controller);
+		mScriptContextEnumerateCallbackProfiles(&m_scriptContext, [](const mScriptCallbackProfile* profile, void* user) {
+			static_cast<QList<CallbackProfile>*>(user)->append({
+				profile->id,
+				QString::fromUtf8(profile->callback),
+				profile->calls,
+				profile->usec,
+				profile->deferred
+			});
+		}, &callbacks);
+		mScriptContextEnumerateFunctionProfiles(&m_scriptContext, [](const char* function, uint64_t samples, void* user) {
+			static_cast<QList<QPair<uint64_t, QString>>*>(user)->append(qMakePair(samples, QString::fromUtf8(function)));
+		}, &functions);
+	}
+
+	std::sort(callbacks.begin(), callbacks.end(), [](const CallbackProfile& a, const CallbackProfile& b) {
+		return a.usec > b.usec;
+	});
+	std::sort(functions.begin(), functions.end(), [](const QPair<uint64_t, QString>& a, const QPair<uint64_t, QString>& b) {
+		return a.first > b.first;
+	});
+
+	if (!m_profiling) {
+		emit warn(tr("Profiling is disabled, so these results may be out of date"));
+	}
+	emit log(tr("Callbacks by total time:"));
+	for (const auto& profile : callbacks) {
+		emit log(tr("  #%1 %2: %3 calls, %4 ms, deferred %5 times")
+			.arg(profile.id)
+			.arg(profile.callback)
+			.arg(profile.calls)
+			.arg(profile.usec / 1000.0, 0, 'f', 3)
+			.arg(profile.deferred));
+	}
+	emit log(tr("Functions by samples:"));
+	for (const auto& function : functions) {
+		emit log(tr("  %1: %2").arg(function.second).arg(function.first));
+	}
+}
+
 void ScriptingController::flushStorage() {
 #ifdef USE_JSON_C
 	mScriptStorageFlushAll(&m_scriptContext);
@@ -358,6 +417,9 @@ void ScriptingController::init() {
 	mScriptContextAttachStorage(&m_scriptContext);
 #endif
 	mScriptContextRegisterEngines(&m_scriptContext);
+	if (m_profiling) {
+		mScriptContextSetProfiling(&m_scriptContext, true);
+	}
 
 	mScriptContextAttachLogger(&m_scriptContext, &m_logger);
 	m_bufferModel->attachToContext(&m_scriptContext);
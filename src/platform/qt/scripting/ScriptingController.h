@@ -49,6 +49,7 @@ public:
 
 	mScriptContext* context() { return &m_scriptContext; }
 	ScriptingTextBufferModel* textBufferModel() const { return m_bufferModel; }
+	bool isProfiling() const { return m_profiling; }
 
 	QString getFilenameFilters() const;
 
@@ -67,6 +68,9 @@ public slots:
 	void runCode(const QString& code);
 	void openAutorunEdit();
 
+	void setProfiling(bool enable);
+	void showProfile();
+
 	void flushStorage();
 
 protected:
@@ -105,6 +109,7 @@ private:
 	ConfigController* m_config = nullptr;
 
 	QTimer m_storageFlush;
+	bool m_profiling = false;
 };
 
 }
@@ -42,6 +42,9 @@ ScriptingView::ScriptingView(ScriptingController* controller, ConfigController*
 	connect(m_ui.loadMostRecent, &QAction::triggered, this, &ScriptingView::loadMostRecent);
 	connect(m_ui.editAutorunScripts, &QAction::triggered, controller, &ScriptingController::openAutorunEdit);
 	connect(m_ui.reset, &QAction::triggered, controller, &ScriptingController::reset);
+	m_ui.profile->setChecked(controller->isProfiling());
+	connect(m_ui.profile, &QAction::toggled, controller, &ScriptingController::setProfiling);
+	connect(m_ui.showProfile, &QAction::triggered, controller, &ScriptingController::showProfile);
 
 	m_mruFiles = m_config->getMRU(ConfigController::MRU::Script);
 	updateMRU();
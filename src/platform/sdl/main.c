@@ -56,6 +56,7 @@ int main(int argc, char** argv) {
 		.rewindEnable = true,
 		.rewindBufferCapacity = 600,
 		.rewindBufferInterval = 1,
+		.rewindBufferMemory = 64,
 		.audioBuffers = 1024,
 		.videoSync = false,
 		.audioSync = true,
@@ -9,8 +9,14 @@
 #include <mgba/core/serialize.h>
 #include <mgba/gb/core.h>
 #include <mgba/gba/core.h>
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/renderers/video-software.h>
+#endif
 
 #include <mgba/feature/commandline.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/socket.h>
 #include <mgba-util/string.h>
 #include <mgba-util/vfs.h>
@@ -41,15 +47,17 @@ size_t romBufferSize;
 #include <inttypes.h>
 #include <sys/time.h>
 
-#define PERF_OPTIONS "DF:L:NPS:T"
+#define PERF_OPTIONS "A:DF:L:NPRS:T"
 #define PERF_USAGE \
 	"Benchmark options:\n" \
+	"  -A MODE          Benchmark only the GBA background renderer in affine MODE (1-5)\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
 	"  -N               Disable video rendering entirely\n" \
 	"  -T               Use threaded video rendering\n" \
 	"  -P               CSV output, useful for parsing\n" \
 	"  -S SEC           Run for SEC in-game seconds before exiting\n" \
 	"  -L FILE          Load a savestate when starting the test\n" \
+	"  -R               Save and reload a savestate in memory every frame\n" \
 	"  -D               Act as a server"
 
 struct PerfOpts {
@@ -60,24 +68,31 @@ struct PerfOpts {
 	unsigned frames;
 	char* savestate;
 	bool server;
+	bool stateBench;
+	int affineMode;
 };
 
 #ifdef __SWITCH__
 TimeType __nx_time_type = TimeType_LocalSystemClock;
 #endif
 
-static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet);
+static void _mPerfRunloop(struct mCore* context, int* frames, bool quiet, void* stateBuffer, size_t stateSize);
 static void _mPerfShutdown(int signal);
 static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* arg);
 static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
 static bool _mPerfRunCore(const char* fname, const struct mArguments*, const struct PerfOpts*);
 static bool _mPerfRunServer(const struct mArguments*, const struct PerfOpts*);
+#ifdef M_CORE_GBA
+static bool _mPerfRunAffine(const struct PerfOpts*);
+#endif
 
 static bool _dispatchExiting = false;
 static struct VFile* _savestate = 0;
 static void* _outputBuffer = NULL;
 static Socket _socket = INVALID_SOCKET;
 static Socket _server = INVALID_SOCKET;
+static uint64_t _saveDuration = 0;
+static uint64_t _loadDuration = 0;
 
 int main(int argc, char** argv) {
 #ifdef __3DS__
@@ -121,7 +136,7 @@ int main(int argc, char** argv) {
 	struct mLogger logger = { .log = _log };
 	mLogSetDefaultLogger(&logger);
 
-	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false };
+	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false, false, 0 };
 	struct mSubParser subparser = {
 		.usage = PERF_USAGE,
 		.parse = _parsePerfOpts,
@@ -131,7 +146,7 @@ int main(int argc, char** argv) {
 
 	struct mArguments args = {};
 	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
-	if (!args.fname && !perfOpts.server) {
+	if (!args.fname && !perfOpts.server && !perfOpts.affineMode) {
 		parsed = false;
 	}
 	if (!parsed || args.showHelp) {
@@ -161,6 +176,10 @@ int main(int argc, char** argv) {
 	}
 	if (perfOpts.server) {
 		didFail = !_mPerfRunServer(&args, &perfOpts);
+#ifdef M_CORE_GBA
+	} else if (perfOpts.affineMode) {
+		didFail = !_mPerfRunAffine(&perfOpts);
+#endif
 	} else {
 		didFail = !_mPerfRunCore(args.fname, &args, &perfOpts);
 	}
@@ -227,6 +246,15 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	struct mGameInfo info;
 	core->getGameInfo(core, &info);
 
+	void* stateBuffer = NULL;
+	size_t stateSize = 0;
+	if (perfOpts->stateBench) {
+		stateSize = core->stateSize(core);
+		stateBuffer = anonymousMemoryMap(stateSize);
+	}
+	_saveDuration = 0;
+	_loadDuration = 0;
+
 	int frames = perfOpts->frames;
 	if (!frames) {
 		frames = perfOpts->duration * 60;
@@ -234,11 +262,15 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	struct timeval tv;
 	gettimeofday(&tv, 0);
 	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
-	_mPerfRunloop(core, &frames, perfOpts->csv);
+	_mPerfRunloop(core, &frames, perfOpts->csv, stateBuffer, stateSize);
 	gettimeofday(&tv, 0);
 	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
 	uint64_t duration = end - start;
 
+	if (stateBuffer) {
+		mappedMemoryFree(stateBuffer, stateSize);
+	}
+
 	mCoreConfigFreeOpts(&opts);
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
@@ -261,6 +293,9 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 		}
 	} else {
 		printf("%u frames in %" PRIu64 " microseconds: %g fps (%gx)\n", frames, duration, scaledFrames / duration, scaledFrames / (duration * 60.f));
+		if (perfOpts->stateBench && _saveDuration && _loadDuration) {
+			printf("%u savestates: %g saves/s, %g loads/s\n", frames, scaledFrames / _saveDuration, scaledFrames / _loadDuration);
+		}
 	}
 #ifdef __SWITCH__
 	consoleUpdate(NULL);
@@ -269,7 +304,123 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	return true;
 }
 
-static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet) {
+static uint64_t _now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+}
+
+#ifdef M_CORE_GBA
+static void _mPerfAffineSetup(struct GBAVideoRenderer* renderer, int mode, int32_t refX) {
+	static const struct {
+		int width;
+		int height;
+	} layers[] = {
+		[1] = { 512, 512 },
+		[2] = { 512, 512 },
+		[3] = { GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS },
+		[4] = { GBA_VIDEO_HORIZONTAL_PIXELS, GBA_VIDEO_VERTICAL_PIXELS },
+		[5] = { 160, 128 },
+	};
+	// Scale the layer to cover the screen without leaving it, so every span is in bounds unless offset
+	uint16_t pa = (layers[mode].width << 8) / GBA_VIDEO_HORIZONTAL_PIXELS;
+	uint16_t pd = (layers[mode].height << 8) / GBA_VIDEO_VERTICAL_PIXELS;
+
+	renderer->reset(renderer);
+	renderer->writeVideoRegister(renderer, GBA_REG_DISPCNT, mode | 0x0400);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2CNT, 0x8800); // 512x512, map at 0x4000
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2PA, pa);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2PB, 0);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2PC, 0);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2PD, pd);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2X_LO, refX & 0xFFFF);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2X_HI, (refX >> 16) & 0x0FFF);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2Y_LO, 0);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2Y_HI, 0);
+}
+
+static bool _mPerfRunAffine(const struct PerfOpts* perfOpts) {
+	if (perfOpts->affineMode < 1 || perfOpts->affineMode > 5) {
+		return false;
+	}
+	int frames = perfOpts->frames;
+	if (!frames) {
+		frames = perfOpts->duration * 60;
+	}
+	if (!frames) {
+		frames = 600;
+	}
+
+	uint16_t* vram = anonymousMemoryMap(GBA_SIZE_VRAM);
+	uint16_t* palette = calloc(512, sizeof(*palette));
+	union GBAOAM* oam = calloc(1, sizeof(*oam));
+	if (!vram || !palette || !oam) {
+		if (vram) {
+			mappedMemoryFree(vram, GBA_SIZE_VRAM);
+		}
+		free(palette);
+		free(oam);
+		return false;
+	}
+	uint32_t seed = 1;
+	size_t i;
+	for (i = 0; i < GBA_SIZE_VRAM / 2; ++i) {
+		seed = seed * 1103515245 + 12345;
+		vram[i] = seed >> 16;
+	}
+	for (i = 0; i < 512; ++i) {
+		palette[i] = (i * 0x1234) & 0x7FFF;
+	}
+
+	struct GBAVideoSoftwareRenderer renderer;
+	GBAVideoSoftwareRendererCreate(&renderer);
+	renderer.d.vram = vram;
+	renderer.d.palette = palette;
+	renderer.d.oam = oam;
+	renderer.outputBuffer = _outputBuffer;
+	renderer.outputBufferStride = 256;
+	renderer.d.init(&renderer.d);
+
+	// The offset case clips the left edge of each span, which takes the checked path
+	static const struct {
+		const char* name;
+		int32_t refX;
+	} cases[] = {
+		{ "inbounds", 0 },
+		{ "clipped", -8 << 8 },
+	};
+	size_t c;
+	for (c = 0; c < sizeof(cases) / sizeof(*cases) && !_dispatchExiting; ++c) {
+		_mPerfAffineSetup(&renderer.d, perfOpts->affineMode, cases[c].refX);
+		uint64_t start = _now();
+		int frame;
+		for (frame = 0; frame < frames && !_dispatchExiting; ++frame) {
+			// Dirty every scanline so none are skipped as unchanged
+			renderer.d.writeVRAM(&renderer.d, 0);
+			int y;
+			for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+				renderer.d.drawScanline(&renderer.d, y);
+			}
+			renderer.d.finishFrame(&renderer.d);
+		}
+		uint64_t duration = _now() - start;
+		float scaledFrames = frame * 1000000.f;
+		if (perfOpts->csv) {
+			printf("affine-mode%i-%s,%i,%" PRIu64 ",software\n", perfOpts->affineMode, cases[c].name, frame, duration);
+		} else {
+			printf("mode %i %s: %i frames in %" PRIu64 " microseconds: %g fps\n", perfOpts->affineMode, cases[c].name, frame, duration, scaledFrames / duration);
+		}
+	}
+
+	renderer.d.deinit(&renderer.d);
+	mappedMemoryFree(vram, GBA_SIZE_VRAM);
+	free(palette);
+	free(oam);
+	return true;
+}
+#endif
+
+static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet, void* stateBuffer, size_t stateSize) {
 	struct timeval lastEcho;
 	gettimeofday(&lastEcho, 0);
 	int duration = *frames;
@@ -277,6 +428,14 @@ static void _mPerfRunloop(struct mCore* core, int* frames, bool quiet) {
 	int lastFrames = 0;
 	while (!_dispatchExiting) {
 		core->runFrame(core);
+		if (stateBuffer) {
+			uint64_t start = _now();
+			mCoreSaveStateBuffer(core, stateBuffer, stateSize, 0);
+			uint64_t saved = _now();
+			mCoreLoadStateBuffer(core, stateBuffer, stateSize, 0);
+			_saveDuration += saved - start;
+			_loadDuration += _now() - saved;
+		}
 		++*frames;
 		++lastFrames;
 		if (!quiet) {
@@ -361,6 +520,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'A':
+		opts->affineMode = strtol(arg, 0, 10);
+		return !errno && opts->affineMode >= 1 && opts->affineMode <= 5;
 	case 'D':
 		opts->server = true;
 		return true;
@@ -373,6 +535,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'P':
 		opts->csv = true;
 		return true;
+	case 'R':
+		opts->stateBench = true;
+		return true;
 	case 'S':
 		opts->duration = strtoul(arg, 0, 10);
 		return !errno;
@@ -42,8 +42,37 @@ struct mScriptCallbackInfo {
 	const char* callback;
 	uint32_t id;
 	bool oneshot;
+	struct mScriptWatch* watch;
+	uint64_t calls;
+	uint64_t usec;
+	uint64_t deferred;
 };
 
+struct mScriptCallbackEntry {
+	uint32_t id;
+	struct mScriptValue* fn;
+	bool oneshot;
+};
+
+DECLARE_VECTOR(mScriptCallbackEntryList, struct mScriptCallbackEntry);
+DEFINE_VECTOR(mScriptCallbackEntryList, struct mScriptCallbackEntry);
+
+// All callbacks registered under one name, along with a flat copy of them
+// that is rebuilt only after a callback is added or removed
+struct mScriptCallbackDispatch {
+	struct Table callbacks;
+	struct mScriptCallbackEntryList entries;
+	bool dirty;
+	int depth;
+	struct mScriptFrame frame;
+	struct mScriptCallbackStats stats;
+	// The first callback skipped by the frame budget, where the next
+	// trigger starts so that later callbacks aren't starved
+	uint32_t resumeId;
+};
+
+DEFINE_VECTOR(mScriptWatchList, struct mScriptWatch*);
+
 static void _engineContextDestroy(void* ctx) {
 	struct mScriptEngineContext* context = ctx;
 	context->destroy(context);
@@ -79,8 +108,9 @@ static void _contextFindForFile(const char* key, void* value, void* user) {
 	}
 }
 
-static void _freeTable(void* data) {
-	struct Table* table = data;
+static void _freeDispatch(void* data) {
+	struct mScriptCallbackDispatch* dispatch = data;
+	struct Table* table = &dispatch->callbacks;
 
 	struct TableIterator iter;
 	if (TableIteratorStart(table, &iter)) {
@@ -91,7 +121,65 @@ static void _freeTable(void* data) {
 	}
 
 	TableDeinit(table);
-	free(table);
+	mScriptCallbackEntryListDeinit(&dispatch->entries);
+	mScriptFrameDeinit(&dispatch->frame);
+	free(dispatch);
+}
+
+static int _entryCompare(const void* a, const void* b) {
+	const struct mScriptCallbackEntry* ea = a;
+	const struct mScriptCallbackEntry* eb = b;
+	if (ea->id == eb->id) {
+		return 0;
+	}
+	return ea->id < eb->id ? -1 : 1;
+}
+
+static int _idCompare(const void* a, const void* b) {
+	uint32_t ia = *(const uint32_t*) a;
+	uint32_t ib = *(const uint32_t*) b;
+	if (ia == ib) {
+		return 0;
+	}
+	return ia < ib ? -1 : 1;
+}
+
+static void _rebuildDispatch(struct mScriptCallbackDispatch* dispatch) {
+	mScriptCallbackEntryListClear(&dispatch->entries);
+	struct TableIterator iter;
+	if (TableIteratorStart(&dispatch->callbacks, &iter)) {
+		do {
+			struct mScriptCallbackInfo* info = TableIteratorGetValue(&dispatch->callbacks, &iter);
+			*mScriptCallbackEntryListAppend(&dispatch->entries) = (struct mScriptCallbackEntry) {
+				.id = info->id,
+				.fn = info->fn,
+				.oneshot = info->oneshot,
+			};
+		} while (TableIteratorNext(&dispatch->callbacks, &iter));
+	}
+	// Call back in the order the callbacks were added
+	qsort(mScriptCallbackEntryListGetPointer(&dispatch->entries, 0), mScriptCallbackEntryListSize(&dispatch->entries), sizeof(struct mScriptCallbackEntry), _entryCompare);
+	dispatch->dirty = false;
+}
+
+static uint64_t _dispatchTime(void) {
+#ifdef _MSC_VER
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart * 1000000 / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return 1000000LL * tv.tv_sec + tv.tv_usec;
+#endif
+}
+
+static void _freeWatch(struct mScriptWatch* watch) {
+	mScriptValueDeref(watch->domain);
+	free(watch->shadow);
+	free(watch);
 }
 
 void mScriptContextInit(struct mScriptContext* context) {
@@ -105,12 +193,22 @@ void mScriptContextInit(struct mScriptContext* context) {
 	mScriptListInit(&context->refPool, 0);
 	TableInit(&context->weakrefs, 0, (void (*)(void*)) mScriptValueDeref);
 	context->nextWeakref = 1;
-	HashTableInit(&context->callbacks, 0, _freeTable);
+	HashTableInit(&context->callbacks, 0, _freeDispatch);
 	TableInit(&context->callbackId, 0, free);
 	context->nextCallbackId = 1;
+	mScriptWatchListInit(&context->watches, 0);
+	context->watchesDirty = false;
+	context->watchEpoch = 0;
+	context->profiling = false;
+	context->frameBudget = 0;
+	context->frameBudgetUsed = 0;
+	context->frameBudgetDefer = false;
+	context->frameBudgetWarned = false;
 	context->constants = NULL;
 	HashTableInit(&context->docstrings, 0, NULL);
 	context->threadDepth = 0;
+	memset(&context->pool, 0, sizeof(context->pool));
+	context->speculative = false;
 }
 
 void mScriptContextDeinit(struct mScriptContext* context) {
@@ -120,8 +218,22 @@ void mScriptContextDeinit(struct mScriptContext* context) {
 	mScriptListDeinit(&context->refPool);
 	HashTableDeinit(&context->callbacks);
 	TableDeinit(&context->callbackId);
+	size_t i;
+	for (i = 0; i < mScriptWatchListSize(&context->watches); ++i) {
+		_freeWatch(*mScriptWatchListGetPointer(&context->watches, i));
+	}
+	mScriptWatchListDeinit(&context->watches);
 	HashTableDeinit(&context->engines);
 	HashTableDeinit(&context->docstrings);
+
+	for (i = 0; i < mSCRIPT_POOL_CLASSES; ++i) {
+		while (context->pool.blocks[i]) {
+			void* block = context->pool.blocks[i];
+			context->pool.blocks[i] = *(void**) block;
+			free(block);
+		}
+		context->pool.count[i] = 0;
+	}
 }
 
 void mScriptContextFillPool(struct mScriptContext* context, struct mScriptValue* value) {
@@ -247,41 +359,213 @@ void mScriptContextDisownWeakref(struct mScriptContext* context, uint32_t weakre
 	poolEntry->refs = mSCRIPT_VALUE_UNREF;
 }
 
+static bool _overFrameBudget(const struct mScriptContext* context) {
+	return context->frameBudget && context->frameBudgetUsed > context->frameBudget;
+}
+
+static void _accountCallback(struct mScriptContext* context, struct mScriptCallbackDispatch* dispatch, const char* callback, uint32_t id, uint64_t usec) {
+	if (context->profiling) {
+		// The callback may have removed itself
+		struct mScriptCallbackInfo* info = TableLookup(&dispatch->callbacks, id);
+		if (info) {
+			++info->calls;
+			info->usec += usec;
+		}
+	}
+	context->frameBudgetUsed += usec;
+	if (_overFrameBudget(context) && !context->frameBudgetWarned) {
+		mLOG(SCRIPT, WARN, "Callback %u (%s) went over the frame budget of %" PRIu64 " us", id, callback, context->frameBudget);
+		context->frameBudgetWarned = true;
+	}
+}
+
 void mScriptContextTriggerCallback(struct mScriptContext* context, const char* callback, struct mScriptList* args) {
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
+	if (context->speculative) {
 		return;
 	}
-	struct TableIterator iter;
-	if (!TableIteratorStart(table, &iter)) {
+	struct mScriptCallbackDispatch* dispatch = HashTableLookup(&context->callbacks, callback);
+	if (!dispatch) {
+		return;
+	}
+	// The entry list can't be rebuilt while an outer trigger is walking it
+	if (dispatch->dirty && !dispatch->depth) {
+		_rebuildDispatch(dispatch);
+	}
+	if (!mScriptCallbackEntryListSize(&dispatch->entries)) {
 		return;
 	}
 
-	struct UInt32List oneshots;
-	UInt32ListInit(&oneshots, 0);
-	do {
-		struct mScriptFrame frame;
-		struct mScriptCallbackInfo* info = TableIteratorGetValue(table, &iter);
-		struct mScriptValue* fn = mScriptContextAccessWeakref(context, info->fn);
+	uint64_t start = _dispatchTime();
+	struct mScriptFrame localFrame;
+	struct mScriptFrame* frame = &dispatch->frame;
+	if (args || dispatch->depth) {
+		frame = &localFrame;
+		mScriptFrameInit(frame);
+	}
+	++dispatch->depth;
+	++dispatch->stats.triggers;
+	bool timed = context->profiling || context->frameBudget;
+
+	size_t nEntries = mScriptCallbackEntryListSize(&dispatch->entries);
+	size_t first = 0;
+	if (!args && dispatch->resumeId) {
+		for (first = 0; first < nEntries; ++first) {
+			if (mScriptCallbackEntryListGetPointer(&dispatch->entries, first)->id >= dispatch->resumeId) {
+				break;
+			}
+		}
+		if (first == nEntries) {
+			first = 0;
+		}
+		dispatch->resumeId = 0;
+	}
+	size_t i;
+	for (i = 0; i < nEntries; ++i) {
+		struct mScriptCallbackEntry* entry = mScriptCallbackEntryListGetPointer(&dispatch->entries, (first + i) % nEntries);
+		if (dispatch->dirty && !TableLookup(&dispatch->callbacks, entry->id)) {
+			// Removed by an earlier callback in this trigger
+			continue;
+		}
+		// At least one callback runs per trigger, so deferred ones get
+		// their turn even if the budget is used up before every trigger
+		if (!args && i && _overFrameBudget(context) && context->frameBudgetDefer) {
+			struct mScriptCallbackInfo* info = TableLookup(&dispatch->callbacks, entry->id);
+			++info->deferred;
+			if (!dispatch->resumeId) {
+				dispatch->resumeId = entry->id;
+			}
+			continue;
+		}
+		struct mScriptValue* fn = entry->fn;
+		if (fn->type == mSCRIPT_TYPE_MS_WEAKREF) {
+			fn = mScriptContextAccessWeakref(context, fn);
+		}
 		if (fn) {
-			mScriptFrameInit(&frame);
+			uint64_t callStart = timed ? _dispatchTime() : 0;
 			if (args) {
-				mScriptListCopy(&frame.stack, args);
+				mScriptListCopy(&frame->stack, args);
+			}
+			mScriptContextInvoke(context, fn, frame);
+			mScriptListClear(&frame->stack);
+			++dispatch->stats.calls;
+			if (timed) {
+				_accountCallback(context, dispatch, callback, entry->id, _dispatchTime() - callStart);
 			}
-			mScriptContextInvoke(context, fn, &frame);
-			mScriptFrameDeinit(&frame);
 		}
 
-		if (info->oneshot) {
-			*UInt32ListAppend(&oneshots) = info->id;
+		if (entry->oneshot) {
+			mScriptContextRemoveCallback(context, entry->id);
 		}
-	} while (TableIteratorNext(table, &iter));
+	}
 
-	size_t i;
-	for (i = 0; i < UInt32ListSize(&oneshots); ++i) {
-		mScriptContextRemoveCallback(context, *UInt32ListGetPointer(&oneshots, i));
+	--dispatch->depth;
+	if (frame == &localFrame) {
+		mScriptFrameDeinit(frame);
+	}
+	dispatch->stats.usec += _dispatchTime() - start;
+}
+
+bool mScriptContextGetCallbackStats(struct mScriptContext* context, const char* callback, struct mScriptCallbackStats* stats) {
+	struct mScriptCallbackDispatch* dispatch = HashTableLookup(&context->callbacks, callback);
+	if (!dispatch) {
+		return false;
+	}
+	*stats = dispatch->stats;
+	return true;
+}
+
+struct mScriptCallbackStatsEnumerator {
+	void (*handler)(const char* callback, const struct mScriptCallbackStats*, void* user);
+	void* user;
+};
+
+static void _enumerateStats(const char* key, void* value, void* user) {
+	struct mScriptCallbackDispatch* dispatch = value;
+	struct mScriptCallbackStatsEnumerator* enumerator = user;
+	enumerator->handler(key, &dispatch->stats, enumerator->user);
+}
+
+static void _setEngineProfiling(const char* key, void* value, void* user) {
+	UNUSED(key);
+	struct mScriptEngineContext* engine = value;
+	if (engine->setProfiling) {
+		engine->setProfiling(engine, *(bool*) user);
+	}
+}
+
+void mScriptContextSetProfiling(struct mScriptContext* context, bool enable) {
+	if (enable) {
+		struct TableIterator iter;
+		if (TableIteratorStart(&context->callbackId, &iter)) {
+			do {
+				struct mScriptCallbackInfo* info = TableIteratorGetValue(&context->callbackId, &iter);
+				info->calls = 0;
+				info->usec = 0;
+				info->deferred = 0;
+			} while (TableIteratorNext(&context->callbackId, &iter));
+		}
+	}
+	context->profiling = enable;
+	HashTableEnumerate(&context->engines, _setEngineProfiling, &enable);
+}
+
+void mScriptContextEnumerateCallbackProfiles(struct mScriptContext* context, void (*handler)(const struct mScriptCallbackProfile*, void* user), void* user) {
+	struct TableIterator iter;
+	if (!TableIteratorStart(&context->callbackId, &iter)) {
+		return;
 	}
-	UInt32ListDeinit(&oneshots);
+	do {
+		struct mScriptCallbackInfo* info = TableIteratorGetValue(&context->callbackId, &iter);
+		struct mScriptCallbackProfile profile = {
+			.id = info->id,
+			.callback = info->callback,
+			.calls = info->calls,
+			.usec = info->usec,
+			.deferred = info->deferred,
+		};
+		handler(&profile, user);
+	} while (TableIteratorNext(&context->callbackId, &iter));
+}
+
+struct mScriptFunctionProfileEnumerator {
+	mScriptProfileHandler handler;
+	void* user;
+};
+
+static void _enumerateEngineProfile(const char* key, void* value, void* user) {
+	UNUSED(key);
+	struct mScriptEngineContext* engine = value;
+	struct mScriptFunctionProfileEnumerator* enumerator = user;
+	if (engine->enumerateProfile) {
+		engine->enumerateProfile(engine, enumerator->handler, enumerator->user);
+	}
+}
+
+void mScriptContextEnumerateFunctionProfiles(struct mScriptContext* context, mScriptProfileHandler handler, void* user) {
+	struct mScriptFunctionProfileEnumerator enumerator = {
+		.handler = handler,
+		.user = user
+	};
+	HashTableEnumerate(&context->engines, _enumerateEngineProfile, &enumerator);
+}
+
+void mScriptContextSetFrameBudget(struct mScriptContext* context, uint64_t usec, bool defer) {
+	context->frameBudget = usec;
+	context->frameBudgetDefer = defer;
+	mScriptContextStartFrame(context);
+}
+
+void mScriptContextStartFrame(struct mScriptContext* context) {
+	context->frameBudgetUsed = 0;
+	context->frameBudgetWarned = false;
+}
+
+void mScriptContextEnumerateCallbackStats(struct mScriptContext* context, void (*handler)(const char* callback, const struct mScriptCallbackStats*, void* user), void* user) {
+	struct mScriptCallbackStatsEnumerator enumerator = {
+		.handler = handler,
+		.user = user
+	};
+	HashTableEnumerate(&context->callbacks, _enumerateStats, &enumerator);
 }
 
 static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context, const char* callback, struct mScriptValue* fn, bool oneshot) {
@@ -296,11 +580,13 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 	} else if (fn->type->base != mSCRIPT_TYPE_FUNCTION) {
 		return 0;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, callback);
-	if (!table) {
-		table = calloc(1, sizeof(*table));
-		TableInit(table, 0, NULL);
-		HashTableInsert(&context->callbacks, callback, table);
+	struct mScriptCallbackDispatch* dispatch = HashTableLookup(&context->callbacks, callback);
+	if (!dispatch) {
+		dispatch = calloc(1, sizeof(*dispatch));
+		TableInit(&dispatch->callbacks, 0, NULL);
+		mScriptCallbackEntryListInit(&dispatch->entries, 0);
+		mScriptFrameInit(&dispatch->frame);
+		HashTableInsert(&context->callbacks, callback, dispatch);
 	}
 	struct mScriptCallbackInfo* info = malloc(sizeof(*info));
 	// Steal the string from the table key, since it's guaranteed to outlive this struct
@@ -308,6 +594,10 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 	HashTableIteratorLookup(&context->callbacks, &iter, callback);
 	info->callback = HashTableIteratorGetKey(&context->callbacks, &iter);
 	info->oneshot = oneshot;
+	info->watch = NULL;
+	info->calls = 0;
+	info->usec = 0;
+	info->deferred = 0;
 	if (fn->type->base == mSCRIPT_TYPE_WRAPPER) {
 		fn = mScriptValueUnwrap(fn);
 	}
@@ -323,7 +613,8 @@ static uint32_t mScriptContextAddCallbackInternal(struct mScriptContext* context
 		info->id = id;
 		break;
 	}
-	TableInsert(table, info->id, info);
+	TableInsert(&dispatch->callbacks, info->id, info);
+	dispatch->dirty = true;
 	return info->id;
 }
 
@@ -340,13 +631,201 @@ void mScriptContextRemoveCallback(struct mScriptContext* context, uint32_t cbid)
 	if (!info) {
 		return;
 	}
-	struct Table* table = HashTableLookup(&context->callbacks, info->callback);
-	if (!table) {
+	struct mScriptCallbackDispatch* dispatch = HashTableLookup(&context->callbacks, info->callback);
+	if (!dispatch) {
 		return;
 	}
+	if (info->watch) {
+		size_t i;
+		for (i = 0; i < mScriptWatchListSize(&context->watches); ++i) {
+			if (*mScriptWatchListGetPointer(&context->watches, i) == info->watch) {
+				mScriptWatchListShift(&context->watches, i, 1);
+				break;
+			}
+		}
+		_freeWatch(info->watch);
+	}
 	mScriptValueDeref(info->fn);
-	TableRemove(table, cbid);
+	TableRemove(&dispatch->callbacks, cbid);
 	TableRemove(&context->callbackId, cbid);
+	dispatch->dirty = true;
+}
+
+uint32_t mScriptContextAddWatch(struct mScriptContext* context, struct mScriptValue* domain, uint32_t address, uint32_t length, struct mScriptValue* fn) {
+	if (!length || (uint64_t) address + length > 0x100000000ULL) {
+		return 0;
+	}
+	if (domain->type->base == mSCRIPT_TYPE_WRAPPER) {
+		domain = mScriptValueUnwrap(domain);
+	}
+	struct mScriptWatch* watch = calloc(1, sizeof(*watch));
+	if (!watch) {
+		return 0;
+	}
+	watch->shadow = malloc(length);
+	if (!watch->shadow) {
+		free(watch);
+		return 0;
+	}
+	uint32_t id = mScriptContextAddCallbackInternal(context, "watch", fn, false);
+	if (!id) {
+		free(watch->shadow);
+		free(watch);
+		return 0;
+	}
+	watch->domain = domain;
+	mScriptValueRef(domain);
+	watch->address = address;
+	watch->length = length;
+	watch->id = id;
+
+	struct mScriptCallbackInfo* info = TableLookup(&context->callbackId, id);
+	info->watch = watch;
+	*mScriptWatchListAppend(&context->watches) = watch;
+	context->watchesDirty = true;
+	return id;
+}
+
+static int _watchCompare(const void* a, const void* b) {
+	const struct mScriptWatch* wa = *(const struct mScriptWatch* const*) a;
+	const struct mScriptWatch* wb = *(const struct mScriptWatch* const*) b;
+	if (wa->domain != wb->domain) {
+		return (uintptr_t) wa->domain < (uintptr_t) wb->domain ? -1 : 1;
+	}
+	if (wa->address != wb->address) {
+		return wa->address < wb->address ? -1 : 1;
+	}
+	return 0;
+}
+
+void mScriptContextCheckWatches(struct mScriptContext* context, const struct mScriptWatchSource* source) {
+	if (context->speculative) {
+		return;
+	}
+	size_t nWatches = mScriptWatchListSize(&context->watches);
+	if (!nWatches) {
+		return;
+	}
+	struct mScriptWatch** watches = mScriptWatchListGetPointer(&context->watches, 0);
+	if (context->watchesDirty) {
+		qsort(watches, nWatches, sizeof(*watches), _watchCompare);
+		context->watchesDirty = false;
+	}
+
+	bool tracked = false;
+	uint32_t since = context->watchEpoch;
+	if (source->collectStores && source->storedSince) {
+		context->watchEpoch = source->collectStores(source->user);
+		// If the epoch went backwards, a different core was attached since
+		// the last check, so its stores can't be compared against
+		tracked = context->watchEpoch > since;
+	}
+
+	struct UInt32List changed;
+	UInt32ListInit(&changed, 0);
+	uint8_t* span = NULL;
+	size_t spanCapacity = 0;
+	size_t i = 0;
+	while (i < nWatches) {
+		uint32_t start = watches[i]->address;
+		uint64_t end = (uint64_t) start + watches[i]->length;
+		bool primed = watches[i]->primed;
+		size_t j;
+		for (j = i + 1; j < nWatches && watches[j]->domain == watches[i]->domain && watches[j]->address <= end; ++j) {
+			uint64_t watchEnd = (uint64_t) watches[j]->address + watches[j]->length;
+			if (watchEnd > end) {
+				end = watchEnd;
+			}
+			primed = primed && watches[j]->primed;
+		}
+		size_t length = end - start;
+		bool stored = true;
+		if (tracked && primed) {
+			stored = source->storedSince(source->user, watches[i]->domain, start, length, since);
+		}
+		if (stored && length > spanCapacity) {
+			free(span);
+			span = malloc(length);
+			spanCapacity = span ? length : 0;
+		}
+		if (stored && span && source->read(source->user, watches[i]->domain, start, length, span)) {
+			size_t k;
+			for (k = i; k < j; ++k) {
+				struct mScriptWatch* watch = watches[k];
+				const uint8_t* current = &span[watch->address - start];
+				if (!watch->primed) {
+					watch->primed = true;
+				} else if (memcmp(watch->shadow, current, watch->length) == 0) {
+					continue;
+				} else {
+					watch->pending = true;
+				}
+				memcpy(watch->shadow, current, watch->length);
+			}
+		}
+		for (; i < j; ++i) {
+			if (watches[i]->pending) {
+				*UInt32ListAppend(&changed) = watches[i]->id;
+			}
+		}
+	}
+	free(span);
+
+	// Callbacks may add or remove watches, so only call them once the
+	// list is no longer being walked
+	struct mScriptCallbackDispatch* dispatch = HashTableLookup(&context->callbacks, "watch");
+	size_t nChanged = UInt32ListSize(&changed);
+	if (dispatch && nChanged) {
+		uint64_t start = _dispatchTime();
+		bool timed = context->profiling || context->frameBudget;
+		++dispatch->stats.triggers;
+		// Call back in the order the watches were added, resuming after the
+		// last watch the budget skipped, like other callbacks
+		qsort(UInt32ListGetPointer(&changed, 0), nChanged, sizeof(uint32_t), _idCompare);
+		size_t first = 0;
+		if (dispatch->resumeId) {
+			for (first = 0; first < nChanged; ++first) {
+				if (*UInt32ListGetPointer(&changed, first) >= dispatch->resumeId) {
+					break;
+				}
+			}
+			if (first == nChanged) {
+				first = 0;
+			}
+			dispatch->resumeId = 0;
+		}
+		for (i = 0; i < nChanged; ++i) {
+			uint32_t id = *UInt32ListGetPointer(&changed, (first + i) % nChanged);
+			struct mScriptCallbackInfo* info = TableLookup(&context->callbackId, id);
+			if (!info) {
+				// Removed by an earlier callback in this check
+				continue;
+			}
+			if (i && _overFrameBudget(context) && context->frameBudgetDefer) {
+				// Stays pending until a check that's within budget
+				++info->deferred;
+				if (!dispatch->resumeId) {
+					dispatch->resumeId = id;
+				}
+				continue;
+			}
+			info->watch->pending = false;
+			struct mScriptValue* fn = mScriptContextAccessWeakref(context, info->fn);
+			if (fn) {
+				uint64_t callStart = timed ? _dispatchTime() : 0;
+				struct mScriptFrame frame;
+				mScriptFrameInit(&frame);
+				mScriptContextInvoke(context, fn, &frame);
+				mScriptFrameDeinit(&frame);
+				++dispatch->stats.calls;
+				if (timed) {
+					_accountCallback(context, dispatch, "watch", id, _dispatchTime() - callStart);
+				}
+			}
+		}
+		dispatch->stats.usec += _dispatchTime() - start;
+	}
+	UInt32ListDeinit(&changed);
 }
 
 void mScriptContextExportConstants(struct mScriptContext* context, const char* nspace, struct mScriptKVPair* constants) {
@@ -470,6 +949,48 @@ void mScriptContextDeactivate(struct mScriptContext* context) {
 	}
 }
 
+static int _poolClass(size_t size) {
+	// Round up to the next power of two, so nearby sizes share blocks
+	int sizeClass = 0;
+	size_t classSize = mSCRIPT_POOL_MIN_SIZE;
+	while (classSize < size) {
+		classSize <<= 1;
+		++sizeClass;
+	}
+	if (sizeClass >= mSCRIPT_POOL_CLASSES) {
+		return -1;
+	}
+	return sizeClass;
+}
+
+void* mScriptPoolAlloc(size_t size) {
+	int sizeClass = _poolClass(size);
+	if (sizeClass < 0) {
+		return malloc(size);
+	}
+	struct mScriptContext* context = ThreadLocalGetValue(_threadContext);
+	if (context && context->pool.blocks[sizeClass]) {
+		void* block = context->pool.blocks[sizeClass];
+		context->pool.blocks[sizeClass] = *(void**) block;
+		--context->pool.count[sizeClass];
+		return block;
+	}
+	// Always allocate the full class size so the block can be pooled later
+	return malloc((size_t) mSCRIPT_POOL_MIN_SIZE << sizeClass);
+}
+
+void mScriptPoolFree(void* block, size_t size) {
+	int sizeClass = _poolClass(size);
+	struct mScriptContext* context = ThreadLocalGetValue(_threadContext);
+	if (sizeClass < 0 || !context || context->pool.count[sizeClass] >= mSCRIPT_POOL_DEPTH) {
+		free(block);
+		return;
+	}
+	*(void**) block = context->pool.blocks[sizeClass];
+	context->pool.blocks[sizeClass] = block;
+	++context->pool.count[sizeClass];
+}
+
 bool mScriptContextInvoke(struct mScriptContext* context, const struct mScriptValue* fn, struct mScriptFrame* frame) {
 	if (!mScriptContextActivate(context)) {
 		return false;
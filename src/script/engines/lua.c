@@ -20,6 +20,8 @@
 
 #define MAX_KEY_SIZE 128
 #define LUA_NAME "lua"
+#define LUA_FRAME_CACHE 8
+#define LUA_PROFILE_INTERVAL 1000
 
 #define mSCRIPT_TYPE_MS_LUA_FUNC (&mSTLuaFunc)
 
@@ -33,6 +35,8 @@ static struct mScriptValue* _luaRootScope(struct mScriptEngineContext*);
 static bool _luaLoad(struct mScriptEngineContext*, const char*, struct VFile*);
 static bool _luaRun(struct mScriptEngineContext*);
 static const char* _luaGetError(struct mScriptEngineContext*);
+static void _luaSetProfiling(struct mScriptEngineContext*, bool enable);
+static void _luaEnumerateProfile(struct mScriptEngineContext*, mScriptProfileHandler handler, void* user);
 
 static bool _luaCall(struct mScriptFrame*, void* context);
 
@@ -45,6 +49,7 @@ static bool _luaPopFrame(struct mScriptEngineContextLua*, lua_State*, struct mSc
 static bool _luaInvoke(struct mScriptEngineContextLua*, struct mScriptFrame*);
 
 static struct mScriptValue* _luaCoerce(struct mScriptEngineContextLua* luaContext, lua_State*, bool pop);
+static void _luaCoerceScalar(lua_State*, struct mScriptValue* out);
 static bool _luaWrap(struct mScriptEngineContextLua* luaContext, lua_State*, struct mScriptValue*);
 
 static void _luaDeref(struct mScriptValue*);
@@ -61,6 +66,7 @@ static int _luaLenList(lua_State* lua);
 
 static int _luaRequireShim(lua_State* lua);
 static int _luaPrintShim(lua_State* lua);
+static int _luaCoroutineShim(lua_State* lua);
 
 static const char* _socketLuaSource =
 	"socket = {\n"
@@ -83,6 +89,30 @@ static const char* _socketLuaSource =
 	"    _callbacks = {},\n"
 	"    _nextCallback = 1,\n"
 	"  }, mt) end,\n"
+	"  _active = {},\n"
+	"  _register = function(sock)\n"
+	"    if not socket._readycb then\n"
+	"      socket._pollcb = callbacks:add('frame', function() _socket.events:poll(0) end)\n"
+	"      socket._readycb = callbacks:add('socketReady', socket._ready)\n"
+	"    end\n"
+	"    sock._id = _socket.events:add(sock._s)\n"
+	"    socket._active[sock._id] = sock\n"
+	"  end,\n"
+	"  _unregister = function(sock)\n"
+	"    if not sock._id then return end\n"
+	"    _socket.events:remove(sock._s)\n"
+	"    socket._active[sock._id] = nil\n"
+	"    sock._id = nil\n"
+	"  end,\n"
+	"  _ready = function(id)\n"
+	"    local sock = socket._active[id]\n"
+	"    if not sock then return end\n"
+	"    if sock._s.failed then\n"
+	"      sock:_dispatch('error', select(2, socket._wrap(sock._s.error)))\n"
+	"    elseif sock._s.readable then\n"
+	"      sock:_dispatch('received')\n"
+	"    end\n"
+	"  end,\n"
 	"  _wrap = function(status)\n"
 	"    if status == 0 then return 1 end\n"
 	"    return nil, socket.ERRORS[status] or ('error#' .. status)\n"
@@ -90,10 +120,7 @@ static const char* _socketLuaSource =
 	"  _mt = {\n"
 	"    __index = {\n"
 	"      close = function(self)\n"
-	"        if self._onframecb then\n"
-	"          callbacks:remove(self._onframecb)\n"
-	"          self._onframecb = nil\n"
-	"        end\n"
+	"        socket._unregister(self)\n"
 	"        self._callbacks = {}\n"
 	"        return self._s:close()\n"
 	"      end,\n"
@@ -126,7 +153,7 @@ static const char* _socketLuaSource =
 	"    __index = {\n"
 	"      _hook = function(self, status)\n"
 	"        if status == 0 then\n"
-	"          self._onframecb = callbacks:add('frame', function() self:poll() end)\n"
+	"          socket._register(self)\n"
 	"        end\n"
 	"        return socket._wrap(status)\n"
 	"      end,\n"
@@ -157,6 +184,14 @@ static const char* _socketLuaSource =
 	"        if i then return result + i - 1 end\n"
 	"        return result\n"
 	"      end,\n"
+	"      queue = function(self, data)\n"
+	"        local result = self._s:queue(data)\n"
+	"        if result < 0 then return socket._wrap(self._s.error) end\n"
+	"        return result\n"
+	"      end,\n"
+	"      pending = function(self)\n"
+	"        return self._s:pending()\n"
+	"      end,\n"
 	// TODO: This does not match the API for LuaSocket's receive() implementation
 	"      receive = function(self, maxBytes)\n"
 	"        local result = self._s:recv(maxBytes)\n"
@@ -326,7 +361,16 @@ struct mScriptEngineContextLua {
 	lua_State* lua;
 	int func;
 	int require;
+	int members;
 	char* lastError;
+
+	// Reused frames for calls into the runtime, indexed by nesting depth
+	struct mScriptFrame frames[LUA_FRAME_CACHE];
+	unsigned frameDepth;
+	uint32_t framesBusy;
+
+	// Samples per function, taken every LUA_PROFILE_INTERVAL instructions
+	struct Table profile;
 };
 
 struct mScriptEngineContextLuaRef {
@@ -381,10 +425,18 @@ struct mScriptEngineContext* _luaCreate(struct mScriptEngine2* engine, struct mS
 		.rootScope = _luaRootScope,
 		.load = _luaLoad,
 		.run = _luaRun,
-		.getError = _luaGetError
+		.getError = _luaGetError,
+		.setProfiling = _luaSetProfiling,
+		.enumerateProfile = _luaEnumerateProfile
 	};
 	luaContext->lua = luaL_newstate();
 	luaContext->func = -1;
+	HashTableInit(&luaContext->profile, 0, free);
+
+	size_t i;
+	for (i = 0; i < LUA_FRAME_CACHE; ++i) {
+		mScriptFrameInit(&luaContext->frames[i]);
+	}
 
 	luaL_openlibs(luaContext->lua);
 
@@ -415,6 +467,9 @@ struct mScriptEngineContext* _luaCreate(struct mScriptEngine2* engine, struct mS
 	lua_getglobal(luaContext->lua, "require");
 	luaContext->require = luaL_ref(luaContext->lua, LUA_REGISTRYINDEX);
 
+	lua_newtable(luaContext->lua);
+	luaContext->members = luaL_ref(luaContext->lua, LUA_REGISTRYINDEX);
+
 	lua_pushliteral(luaContext->lua, "log");
 	lua_pushcclosure(luaContext->lua, _luaPrintShim, 1);
 	lua_setglobal(luaContext->lua, "print");
@@ -423,6 +478,27 @@ struct mScriptEngineContext* _luaCreate(struct mScriptEngine2* engine, struct mS
 	lua_pushcclosure(luaContext->lua, _luaPrintShim, 1);
 	lua_setglobal(luaContext->lua, "warn");
 
+	// Coroutines are tracked so that hooks can be installed on ones that
+	// already exist, since they only inherit hooks when they're created
+	lua_pushliteral(luaContext->lua, "mCoroutines");
+	lua_newtable(luaContext->lua);
+	lua_newtable(luaContext->lua);
+	lua_pushliteral(luaContext->lua, "k");
+	lua_setfield(luaContext->lua, -2, "__mode");
+	lua_setmetatable(luaContext->lua, -2);
+	lua_rawset(luaContext->lua, LUA_REGISTRYINDEX);
+
+	lua_getglobal(luaContext->lua, "coroutine");
+	if (lua_istable(luaContext->lua, -1)) {
+		lua_getfield(luaContext->lua, -1, "create");
+		lua_pushcclosure(luaContext->lua, _luaCoroutineShim, 1);
+		lua_setfield(luaContext->lua, -2, "create");
+		lua_getfield(luaContext->lua, -1, "wrap");
+		lua_pushcclosure(luaContext->lua, _luaCoroutineShim, 1);
+		lua_setfield(luaContext->lua, -2, "wrap");
+	}
+	lua_pop(luaContext->lua, 1);
+
 	HashTableInit(&luaContext->d.docroot, 0, (void (*)(void*)) mScriptValueDeref);
 
 	int status = luaL_dostring(luaContext->lua, _socketLuaSource);
@@ -498,8 +574,17 @@ void _luaDestroy(struct mScriptEngineContext* ctx) {
 	if (luaContext->require > 0) {
 		luaL_unref(luaContext->lua, LUA_REGISTRYINDEX, luaContext->require);
 	}
+	if (luaContext->members > 0) {
+		luaL_unref(luaContext->lua, LUA_REGISTRYINDEX, luaContext->members);
+	}
 	lua_close(luaContext->lua);
 
+	size_t i;
+	for (i = 0; i < LUA_FRAME_CACHE; ++i) {
+		mScriptFrameDeinit(&luaContext->frames[i]);
+	}
+
+	HashTableDeinit(&luaContext->profile);
 	HashTableDeinit(&luaContext->d.docroot);
 	free(luaContext);
 }
@@ -734,6 +819,25 @@ struct mScriptValue* _luaCoerce(struct mScriptEngineContextLua* luaContext, lua_
 	return value;
 }
 
+void _luaCoerceScalar(lua_State* lua, struct mScriptValue* out) {
+	out->refs = mSCRIPT_VALUE_UNREF;
+	out->flags = 0;
+	if (lua_type(lua, -1) == LUA_TBOOLEAN) {
+		out->type = mSCRIPT_TYPE_MS_BOOL;
+		out->value.u32 = lua_toboolean(lua, -1);
+		return;
+	}
+#if LUA_VERSION_NUM >= 503
+	if (lua_isinteger(lua, -1)) {
+		out->type = mSCRIPT_TYPE_MS_S64;
+		out->value.s64 = lua_tointeger(lua, -1);
+		return;
+	}
+#endif
+	out->type = mSCRIPT_TYPE_MS_F64;
+	out->value.f64 = lua_tonumber(lua, -1);
+}
+
 bool _luaWrap(struct mScriptEngineContextLua* luaContext, lua_State* lua, struct mScriptValue* value) {
 	if (!value) {
 		lua_pushnil(lua);
@@ -1032,6 +1136,80 @@ const char* _luaGetError(struct mScriptEngineContext* context) {
 	return luaContext->lastError;
 }
 
+static void _luaProfileHook(lua_State* lua, lua_Debug* ar) {
+	UNUSED(ar);
+	// mCtx is cleared whenever a nested call returns, so it can't be used here
+	lua_pushliteral(lua, "mProfile");
+	lua_rawget(lua, LUA_REGISTRYINDEX);
+	struct mScriptEngineContextLua* luaContext = lua_touserdata(lua, -1);
+	lua_pop(lua, 1);
+	if (!luaContext) {
+		return;
+	}
+
+	lua_Debug info;
+	if (!lua_getstack(lua, 0, &info) || !lua_getinfo(lua, "S", &info)) {
+		return;
+	}
+	char name[MAX_KEY_SIZE];
+	snprintf(name, sizeof(name), "%s:%i", info.short_src, info.linedefined);
+	uint64_t* samples = HashTableLookup(&luaContext->profile, name);
+	if (!samples) {
+		samples = calloc(1, sizeof(*samples));
+		HashTableInsert(&luaContext->profile, name, samples);
+	}
+	++*samples;
+}
+
+static void _luaSetHook(lua_State* lua, bool enable) {
+	if (enable) {
+		lua_sethook(lua, _luaProfileHook, LUA_MASKCOUNT, LUA_PROFILE_INTERVAL);
+	} else {
+		lua_sethook(lua, NULL, 0, 0);
+	}
+}
+
+void _luaSetProfiling(struct mScriptEngineContext* ctx, bool enable) {
+	struct mScriptEngineContextLua* luaContext = (struct mScriptEngineContextLua*) ctx;
+	lua_pushliteral(luaContext->lua, "mProfile");
+	if (enable) {
+		HashTableClear(&luaContext->profile);
+		lua_pushlightuserdata(luaContext->lua, luaContext);
+	} else {
+		lua_pushnil(luaContext->lua);
+	}
+	lua_rawset(luaContext->lua, LUA_REGISTRYINDEX);
+	_luaSetHook(luaContext->lua, enable);
+
+	lua_pushliteral(luaContext->lua, "mCoroutines");
+	lua_rawget(luaContext->lua, LUA_REGISTRYINDEX);
+	lua_pushnil(luaContext->lua);
+	while (lua_next(luaContext->lua, -2)) {
+		lua_pop(luaContext->lua, 1);
+		_luaSetHook(lua_tothread(luaContext->lua, -1), enable);
+	}
+	lua_pop(luaContext->lua, 1);
+}
+
+struct mScriptLuaProfileEnumerator {
+	mScriptProfileHandler handler;
+	void* user;
+};
+
+static void _luaEnumerateSample(const char* key, void* value, void* user) {
+	struct mScriptLuaProfileEnumerator* enumerator = user;
+	enumerator->handler(key, *(uint64_t*) value, enumerator->user);
+}
+
+void _luaEnumerateProfile(struct mScriptEngineContext* ctx, mScriptProfileHandler handler, void* user) {
+	struct mScriptEngineContextLua* luaContext = (struct mScriptEngineContextLua*) ctx;
+	struct mScriptLuaProfileEnumerator enumerator = {
+		.handler = handler,
+		.user = user
+	};
+	HashTableEnumerate(&luaContext->profile, _luaEnumerateSample, &enumerator);
+}
+
 bool _luaPushFrame(struct mScriptEngineContextLua* luaContext, lua_State* lua, struct mScriptList* frame) {
 	bool ok = true;
 	if (frame) {
@@ -1056,12 +1234,24 @@ bool _luaPopFrame(struct mScriptEngineContextLua* luaContext, lua_State* lua, st
 	if (frame) {
 		int i;
 		for (i = 0; i < count; ++i) {
+			struct mScriptValue* tail;
+			switch (lua_type(lua, -1)) {
+			case LUA_TNUMBER:
+			case LUA_TBOOLEAN:
+				// Store scalars in the frame directly instead of boxing them
+				tail = mScriptListAppend(frame);
+				_luaCoerceScalar(lua, tail);
+				lua_pop(lua, 1);
+				continue;
+			default:
+				break;
+			}
 			struct mScriptValue* value = _luaCoerce(luaContext, lua, true);
 			if (!value) {
 				ok = false;
 				break;
 			}
-			struct mScriptValue* tail = mScriptListAppend(frame);
+			tail = mScriptListAppend(frame);
 			mScriptValueWrap(value, tail);
 			if (tail->type == value->type) {
 				mScriptValueDeref(value);
@@ -1190,30 +1380,53 @@ static struct mScriptEngineContextLua* _luaGetContext(lua_State* lua) {
 	return luaContext;
 }
 
+static struct mScriptFrame* _luaAcquireFrame(struct mScriptEngineContextLua* luaContext, struct mScriptFrame* fallback) {
+	if (luaContext->frameDepth < LUA_FRAME_CACHE) {
+		luaContext->framesBusy |= 1 << luaContext->frameDepth;
+		return &luaContext->frames[luaContext->frameDepth++];
+	}
+	mScriptFrameInit(fallback);
+	return fallback;
+}
+
+static void _luaReleaseFrame(struct mScriptEngineContextLua* luaContext, struct mScriptFrame* frame, struct mScriptFrame* fallback) {
+	if (frame == fallback) {
+		mScriptFrameDeinit(fallback);
+		return;
+	}
+	mScriptListClear(&frame->stack);
+	luaContext->framesBusy &= ~(1 << (frame - luaContext->frames));
+	// Frames are usually released innermost first, but one released out of
+	// order stays reserved until every frame above it is released too
+	while (luaContext->frameDepth && !(luaContext->framesBusy & (1 << (luaContext->frameDepth - 1)))) {
+		--luaContext->frameDepth;
+	}
+}
+
 int _luaThunk(lua_State* lua) {
 	struct mScriptEngineContextLua* luaContext = _luaGetContext(lua);
-	struct mScriptFrame frame;
-	mScriptFrameInit(&frame);
-	if (!_luaPopFrame(luaContext, lua, &frame.stack)) {
-		_freeFrame(&frame.stack);
+	struct mScriptFrame fallback;
+	struct mScriptFrame* frame = _luaAcquireFrame(luaContext, &fallback);
+	if (!_luaPopFrame(luaContext, lua, &frame->stack)) {
+		_freeFrame(&frame->stack);
 		mScriptContextDrainPool(luaContext->d.context);
-		mScriptFrameDeinit(&frame);
+		_luaReleaseFrame(luaContext, frame, &fallback);
 		luaL_traceback(lua, lua, "Error calling function (translating arguments into runtime)", 1);
 		return lua_error(lua);
 	}
 
 	struct mScriptValue* fn = lua_touserdata(lua, lua_upvalueindex(1));
-	_autofreeFrame(luaContext->d.context, &frame.stack);
-	if (!fn || !mScriptContextInvoke(luaContext->d.context, fn, &frame)) {
+	_autofreeFrame(luaContext->d.context, &frame->stack);
+	if (!fn || !mScriptContextInvoke(luaContext->d.context, fn, frame)) {
 		mScriptContextDrainPool(luaContext->d.context);
-		mScriptFrameDeinit(&frame);
+		_luaReleaseFrame(luaContext, frame, &fallback);
 		luaL_traceback(lua, lua, "Error calling function (invoking failed)", 1);
 		return lua_error(lua);
 	}
 
-	bool ok = _luaPushFrame(luaContext, lua, &frame.stack);
+	bool ok = _luaPushFrame(luaContext, lua, &frame->stack);
 	mScriptContextDrainPool(luaContext->d.context);
-	mScriptFrameDeinit(&frame);
+	_luaReleaseFrame(luaContext, frame, &fallback);
 	if (!ok) {
 		luaL_traceback(lua, lua, "Error calling function (translating return values from runtime)", 1);
 		return lua_error(lua);
@@ -1222,6 +1435,76 @@ int _luaThunk(lua_State* lua) {
 	return lua_gettop(lua);
 }
 
+// Pushes the table caching member lookups for a class. Keys are Lua
+// strings, which Lua already interns, so a cached lookup never has to
+// hash or compare the name again.
+static void _luaPushMemberCache(struct mScriptEngineContextLua* luaContext, lua_State* lua, struct mScriptTypeClass* cls) {
+	lua_rawgeti(lua, LUA_REGISTRYINDEX, luaContext->members);
+	lua_pushlightuserdata(lua, cls);
+	lua_rawget(lua, -2);
+	if (lua_isnil(lua, -1)) {
+		lua_pop(lua, 1);
+		lua_newtable(lua);
+		lua_pushlightuserdata(lua, cls);
+		lua_pushvalue(lua, -2);
+		lua_rawset(lua, -4);
+	}
+	lua_remove(lua, -2);
+}
+
+// Looks up a member through the cache, leaving the result on top of the
+// stack. Methods don't depend on the object, so their wrapped function is
+// cached outright; other members cache their slot.
+static bool _luaGetCachedMember(struct mScriptEngineContextLua* luaContext, lua_State* lua, struct mScriptValue* obj) {
+	struct mScriptValue* unwrapped = obj;
+	if (unwrapped->type->base == mSCRIPT_TYPE_WRAPPER) {
+		unwrapped = mScriptValueUnwrap(unwrapped);
+	}
+	if (!unwrapped || unwrapped->type->base != mSCRIPT_TYPE_OBJECT || !unwrapped->type->details.cls) {
+		return false;
+	}
+	struct mScriptTypeClass* cls = unwrapped->type->details.cls;
+
+	// Stack: key
+	_luaPushMemberCache(luaContext, lua, cls);
+	lua_pushvalue(lua, -2);
+	lua_rawget(lua, -2);
+	// Stack: key, cache, entry
+	if (lua_isfunction(lua, -1)) {
+		return true;
+	}
+
+	int slot;
+	if (lua_isnumber(lua, -1)) {
+		slot = lua_tointeger(lua, -1);
+	} else {
+		slot = mScriptClassGetSlot(cls, lua_tostring(lua, -3));
+		if (slot < 0) {
+			lua_pop(lua, 2);
+			return false;
+		}
+	}
+	lua_pop(lua, 1);
+
+	struct mScriptValue val;
+	if (!mScriptObjectGetSlot(unwrapped, slot, &val)) {
+		lua_pop(lua, 1);
+		return false;
+	}
+	if (!_luaWrap(luaContext, lua, &val)) {
+		lua_pop(lua, 1);
+		return false;
+	}
+	lua_pushvalue(lua, -3);
+	if (val.type->base == mSCRIPT_TYPE_FUNCTION) {
+		lua_pushvalue(lua, -2);
+	} else {
+		lua_pushinteger(lua, slot);
+	}
+	lua_rawset(lua, -4);
+	return true;
+}
+
 int _luaGetObject(lua_State* lua) {
 	struct mScriptEngineContextLua* luaContext = _luaGetContext(lua);
 	char key[MAX_KEY_SIZE];
@@ -1234,15 +1517,21 @@ int _luaGetObject(lua_State* lua) {
 		luaL_traceback(lua, lua, "Invalid key", 1);
 		return lua_error(lua);
 	}
-	strlcpy(key, keyPtr, sizeof(key));
-	lua_pop(lua, 2);
 
 	obj = mScriptContextAccessWeakref(luaContext->d.context, obj);
 	if (!obj) {
+		lua_pop(lua, 2);
 		luaL_traceback(lua, lua, "Invalid object", 1);
 		return lua_error(lua);
 	}
 
+	if (lua_type(lua, -1) == LUA_TSTRING && _luaGetCachedMember(luaContext, lua, obj)) {
+		return 1;
+	}
+
+	strlcpy(key, keyPtr, sizeof(key));
+	lua_pop(lua, 2);
+
 	if (!mScriptObjectGet(obj, key, &val)) {
 		char error[MAX_KEY_SIZE + 16];
 		snprintf(error, sizeof(error), "Invalid key '%s'", key);
@@ -1570,6 +1859,34 @@ static int _luaRequireShim(lua_State* lua) {
 	return newtop - oldtop + 1;
 }
 
+static int _luaCoroutineShim(lua_State* lua) {
+	// The first upvalue is the original coroutine.create or coroutine.wrap
+	int n = lua_gettop(lua);
+	lua_pushvalue(lua, lua_upvalueindex(1));
+	lua_insert(lua, 1);
+	lua_call(lua, n, 1);
+
+	// A wrapped coroutine is the first upvalue of the function wrap returns
+	if (lua_type(lua, -1) == LUA_TFUNCTION) {
+		if (!lua_getupvalue(lua, -1, 1)) {
+			return 1;
+		}
+	} else {
+		lua_pushvalue(lua, -1);
+	}
+	if (lua_type(lua, -1) != LUA_TTHREAD) {
+		lua_pop(lua, 1);
+		return 1;
+	}
+	lua_pushliteral(lua, "mCoroutines");
+	lua_rawget(lua, LUA_REGISTRYINDEX);
+	lua_insert(lua, -2);
+	lua_pushboolean(lua, true);
+	lua_rawset(lua, -3);
+	lua_pop(lua, 1);
+	return 1;
+}
+
 static int _luaPrintShim(lua_State* lua) {
 	int n = lua_gettop(lua);
 
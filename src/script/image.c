@@ -63,6 +63,9 @@ mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mImage, _deinit, mImageDestroy, 0);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mImage, drawImageOpaque, mImageBlit, 3, CS(mImage), image, U32, x, U32, y);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD_WITH_DEFAULTS(mImage, drawImage, mImageCompositeWithAlpha, 4, CS(mImage), image, U32, x, U32, y, F32, alpha);
 
+mSCRIPT_DECLARE_STRUCT_C_METHOD_WITH_DEFAULTS(mImage, U32, hash, mImageHashRegion, 4, S32, x, S32, y, S32, width, S32, height);
+mSCRIPT_DECLARE_STRUCT_C_METHOD_WITH_DEFAULTS(mImage, U32, compare, mImageCompare, 3, CS(mImage), image, S32, x, S32, y);
+
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mImage, drawImage)
 	mSCRIPT_NO_DEFAULT,
 	mSCRIPT_NO_DEFAULT,
@@ -70,6 +73,19 @@ mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mImage, drawImage)
 	mSCRIPT_F32(1.0f)
 mSCRIPT_DEFINE_DEFAULTS_END;
 
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mImage, hash)
+	mSCRIPT_S32(0),
+	mSCRIPT_S32(0),
+	mSCRIPT_S32(0),
+	mSCRIPT_S32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mImage, compare)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_S32(0),
+	mSCRIPT_S32(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
 #ifdef ENABLE_VFS
 mSCRIPT_DECLARE_STRUCT_C_METHOD_WITH_DEFAULTS(mImage, BOOL, save, mImageSave, 2, CHARP, path, CHARP, format);
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mImage, save)
@@ -95,6 +111,18 @@ mSCRIPT_DEFINE_STRUCT(mImage)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mImage, drawImageOpaque)
 	mSCRIPT_DEFINE_DOCSTRING("Draw another image onto this image with alpha blending as needed, optionally specifying a coefficient for adjusting the opacity")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mImage, drawImage)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a CRC32 of the pixels in a rectangle of the image, for cheaply checking if part of it changed. "
+		"A width or height of 0 extends the rectangle to the edge of the image. Hashes only match between "
+		"images of the same format, such as two frames from struct::mScriptCoreAdapter.frameView"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mImage, hash)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Count how many pixels of another image, placed at a given coordinate, differ from this image. "
+		"Alpha is ignored, except that fully transparent pixels of the other image are skipped, "
+		"and only the area where the two images overlap is compared"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mImage, compare)
 	mSCRIPT_DEFINE_DOCSTRING("The width of the image, in pixels")
 	mSCRIPT_DEFINE_STRUCT_CONST_MEMBER(mImage, U32, width)
 	mSCRIPT_DEFINE_DOCSTRING("The height of the image, in pixels")
@@ -10,15 +10,56 @@
 #include <mgba/internal/script/socket.h>
 #include <mgba/script/macros.h>
 #include <mgba-util/socket.h>
+#include <mgba-util/vector.h>
+
+#if !defined(_WIN32) && !defined(GEKKO) && !defined(PSP2) && !defined(__3DS__)
+#include <poll.h>
+#define USE_POLL
+#endif
+
+// Upper bound on data waiting to be sent, so a stalled peer can't grow the queue forever
+#define SOCKET_QUEUE_MAX 0x100000
+
+struct mScriptSocketSet;
 
 struct mScriptSocket {
 	Socket socket;
 	struct Address address;
 	int32_t error;
 	uint16_t port;
+
+	struct mScriptSocketSet* set;
+	uint32_t id;
+	bool readable;
+	bool failed;
+
+	// Data waiting for the socket to become writable
+	uint8_t* queue;
+	size_t queued;
+	size_t queueCapacity;
 };
 mSCRIPT_DECLARE_STRUCT(mScriptSocket);
 
+DECLARE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+DEFINE_VECTOR(mScriptSocketList, struct mScriptSocket*);
+
+// Every socket with event callbacks, polled together once per frame
+struct mScriptSocketSet {
+	struct mScriptContext* context;
+	struct mScriptSocketList sockets;
+	uint32_t nextId;
+#ifdef USE_POLL
+	struct pollfd* fds;
+	size_t fdCapacity;
+#else
+	Socket* reads;
+	Socket* writes;
+	Socket* errors;
+	size_t fdCapacity;
+#endif
+};
+mSCRIPT_DECLARE_STRUCT(mScriptSocketSet);
+
 static const struct _mScriptSocketErrorMapping {
 	int32_t nativeError;
 	enum mSocketErrorCode mappedError;
@@ -100,14 +141,24 @@ struct mScriptValue* _mScriptSocketCreate() {
 	struct mScriptValue* result = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptSocket));
 	result->value.opaque = calloc(1, sizeof(struct mScriptSocket));
 	*(struct mScriptSocket*) result->value.opaque = client;
-	result->flags = mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+	result->flags = mSCRIPT_VALUE_FLAG_DEINIT | mSCRIPT_VALUE_FLAG_FREE_BUFFER;
 	return result;
 }
 
+static void _mScriptSocketSetRemove(struct mScriptSocketSet* set, struct mScriptSocket* ssock);
+
 void _mScriptSocketClose(struct mScriptSocket* ssock) {
+	if (ssock->set) {
+		_mScriptSocketSetRemove(ssock->set, ssock);
+	}
 	if (!SOCKET_FAILED(ssock->socket)) {
 		SocketClose(ssock->socket);
+		ssock->socket = INVALID_SOCKET;
 	}
+	free(ssock->queue);
+	ssock->queue = NULL;
+	ssock->queued = 0;
+	ssock->queueCapacity = 0;
 }
 
 struct mScriptValue* _mScriptSocketAccept(struct mScriptSocket* ssock) {
@@ -181,8 +232,63 @@ struct mScriptValue* _mScriptSocketRecv(struct mScriptSocket* ssock, uint32_t ma
 	return value;
 }
 
+static bool _mScriptSocketFlush(struct mScriptSocket* ssock) {
+	if (!ssock->queued) {
+		return true;
+	}
+	ssize_t written = SocketSend(ssock->socket, ssock->queue, ssock->queued);
+	if (written < 0) {
+		if (SocketWouldBlock()) {
+			return true;
+		}
+		_mScriptSocketSetError(ssock, SocketError());
+		return false;
+	}
+	ssock->queued -= written;
+	memmove(ssock->queue, &ssock->queue[written], ssock->queued);
+	return true;
+}
+
+int32_t _mScriptSocketQueue(struct mScriptSocket* ssock, struct mScriptString* data) {
+	if (ssock->queued + data->size > SOCKET_QUEUE_MAX) {
+		// Make room with whatever the socket will take right now before giving up
+		if (!_mScriptSocketFlush(ssock)) {
+			return -ssock->error;
+		}
+		if (ssock->queued + data->size > SOCKET_QUEUE_MAX) {
+			ssock->error = mSCRIPT_SOCKERR_AGAIN;
+			return -mSCRIPT_SOCKERR_AGAIN;
+		}
+	}
+	if (ssock->queued + data->size > ssock->queueCapacity) {
+		size_t capacity = ssock->queueCapacity ? ssock->queueCapacity : 0x400;
+		while (capacity < ssock->queued + data->size) {
+			capacity *= 2;
+		}
+		uint8_t* queue = realloc(ssock->queue, capacity);
+		if (!queue) {
+			ssock->error = mSCRIPT_SOCKERR_OUT_OF_MEMORY;
+			return -mSCRIPT_SOCKERR_OUT_OF_MEMORY;
+		}
+		ssock->queue = queue;
+		ssock->queueCapacity = capacity;
+	}
+	memcpy(&ssock->queue[ssock->queued], data->buffer, data->size);
+	ssock->queued += data->size;
+	// Send as much as possible now, and leave the rest for when the socket is writable
+	if (!_mScriptSocketFlush(ssock)) {
+		return -ssock->error;
+	}
+	ssock->error = mSCRIPT_SOCKERR_OK;
+	return ssock->queued;
+}
+
+uint32_t _mScriptSocketPending(const struct mScriptSocket* ssock) {
+	return ssock->queued;
+}
+
 // This works sufficiently well for a single socket, but it could be better.
-// Ideally, all sockets would be tracked and selected on together for efficiency.
+// Sockets with event callbacks are instead polled together by mScriptSocketSet.
 uint32_t _mScriptSocketSelectOne(struct mScriptSocket* ssock, int64_t timeoutMillis) {
 	Socket reads[] = { ssock->socket };
 	Socket errors[] = { ssock->socket };
@@ -205,6 +311,8 @@ mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptSocket, S32, listen, _mScript
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, S32, send, _mScriptSocketSend, 1, STR, data);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, WSTR, recv, _mScriptSocketRecv, 1, U32, maxBytes);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, S32, select, _mScriptSocketSelectOne, 1, S64, timeoutMillis);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocket, S32, queue, _mScriptSocketQueue, 1, STR, data);
+mSCRIPT_DECLARE_STRUCT_C_METHOD(mScriptSocket, U32, pending, _mScriptSocketPending, 0);
 
 mSCRIPT_DEFINE_STRUCT(mScriptSocket)
 	mSCRIPT_DEFINE_INTERNAL
@@ -247,24 +355,251 @@ mSCRIPT_DEFINE_STRUCT(mScriptSocket)
 		"Returns -1 if an error has occurred on the socket."
 	)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocket, select)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Queues data to be sent without blocking. As much as possible is sent immediately, "
+		"and the rest is sent when the socket becomes writable while it is polled. "
+		"At most 1 MiB can be waiting at once; once the queue is full, further data is rejected with "
+		"C.SOCKERR.AGAIN until the socket has caught up. "
+		"Returns the number of bytes still queued, or a negative error code."
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocket, queue)
+	mSCRIPT_DEFINE_DOCSTRING("Returns the number of queued bytes that have not been sent yet.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocket, pending)
 	mSCRIPT_DEFINE_DOCSTRING(
 		"One of the C.SOCKERR constants describing the last error on the socket."
 	)
 	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, S32, error)
+	mSCRIPT_DEFINE_DOCSTRING("Whether data was available to be read when the socket was last polled.")
+	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, BOOL, readable)
+	mSCRIPT_DEFINE_DOCSTRING("Whether an error occurred on the socket when it was last polled.")
+	mSCRIPT_DEFINE_STRUCT_MEMBER(mScriptSocket, BOOL, failed)
 mSCRIPT_DEFINE_END;
 
 mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptSocket, listen)
 	mSCRIPT_S32(1)
 mSCRIPT_DEFINE_DEFAULTS_END;
 
+static uint32_t _mScriptSocketSetAdd(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	if (ssock->set == set) {
+		return ssock->id;
+	}
+	if (ssock->set) {
+		_mScriptSocketSetRemove(ssock->set, ssock);
+	}
+	ssock->set = set;
+	ssock->id = set->nextId;
+	++set->nextId;
+	ssock->readable = false;
+	ssock->failed = false;
+	*mScriptSocketListAppend(&set->sockets) = ssock;
+	return ssock->id;
+}
+
+static void _mScriptSocketSetRemove(struct mScriptSocketSet* set, struct mScriptSocket* ssock) {
+	if (ssock->set != set) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < mScriptSocketListSize(&set->sockets); ++i) {
+		if (*mScriptSocketListGetPointer(&set->sockets, i) == ssock) {
+			mScriptSocketListShift(&set->sockets, i, 1);
+			break;
+		}
+	}
+	ssock->set = NULL;
+	ssock->id = 0;
+}
+
+static bool _mScriptSocketSetReserve(struct mScriptSocketSet* set, size_t nSockets) {
+	if (nSockets <= set->fdCapacity) {
+		return true;
+	}
+	size_t capacity = nSockets * 2;
+#ifdef USE_POLL
+	struct pollfd* fds = realloc(set->fds, capacity * sizeof(*fds));
+	if (!fds) {
+		return false;
+	}
+	set->fds = fds;
+#else
+	// Keep whichever arrays did grow; the capacity only changes once all of them have
+	Socket* reads = realloc(set->reads, capacity * sizeof(Socket));
+	if (!reads) {
+		return false;
+	}
+	set->reads = reads;
+	Socket* writes = realloc(set->writes, capacity * sizeof(Socket));
+	if (!writes) {
+		return false;
+	}
+	set->writes = writes;
+	Socket* errors = realloc(set->errors, capacity * sizeof(Socket));
+	if (!errors) {
+		return false;
+	}
+	set->errors = errors;
+#endif
+	set->fdCapacity = capacity;
+	return true;
+}
+
+static int32_t _mScriptSocketSetPoll(struct mScriptSocketSet* set, int64_t timeoutMillis) {
+	size_t nSockets = mScriptSocketListSize(&set->sockets);
+	if (!nSockets) {
+		return 0;
+	}
+	if (!_mScriptSocketSetReserve(set, nSockets)) {
+		return -mSCRIPT_SOCKERR_OUT_OF_MEMORY;
+	}
+	struct mScriptSocket** sockets = mScriptSocketListGetPointer(&set->sockets, 0);
+	size_t i;
+#ifdef USE_POLL
+	for (i = 0; i < nSockets; ++i) {
+		set->fds[i].fd = sockets[i]->socket;
+		set->fds[i].events = POLLIN;
+		if (sockets[i]->queued) {
+			set->fds[i].events |= POLLOUT;
+		}
+		set->fds[i].revents = 0;
+	}
+	if (poll(set->fds, nSockets, timeoutMillis < 0 ? -1 : timeoutMillis) < 0) {
+		return -1;
+	}
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = sockets[i];
+		short revents = set->fds[i].revents;
+		// A closed connection shows up as readable, so recv can report it
+		ssock->readable = revents & (POLLIN | POLLHUP);
+		ssock->failed = revents & (POLLERR | POLLNVAL);
+		if (revents & POLLOUT && !_mScriptSocketFlush(ssock)) {
+			ssock->failed = true;
+		}
+		if (ssock->failed) {
+			_mScriptSocketSetError(ssock, revents & POLLNVAL ? EINVAL : SocketError());
+		}
+	}
+#else
+	size_t nWrites = 0;
+	for (i = 0; i < nSockets; ++i) {
+		set->reads[i] = sockets[i]->socket;
+		set->errors[i] = sockets[i]->socket;
+		if (sockets[i]->queued) {
+			set->writes[nWrites] = sockets[i]->socket;
+			++nWrites;
+		}
+	}
+	for (i = nWrites; i < nSockets; ++i) {
+		set->writes[i] = INVALID_SOCKET;
+	}
+	if (SocketPoll(nSockets, set->reads, set->writes, set->errors, timeoutMillis) < 0) {
+		return -1;
+	}
+	for (i = 0; i < nSockets; ++i) {
+		struct mScriptSocket* ssock = sockets[i];
+		ssock->readable = false;
+		ssock->failed = false;
+		size_t j;
+		for (j = 0; j < nSockets && !SOCKET_FAILED(set->reads[j]); ++j) {
+			if (set->reads[j] == ssock->socket) {
+				ssock->readable = true;
+			}
+		}
+		for (j = 0; j < nSockets && !SOCKET_FAILED(set->errors[j]); ++j) {
+			if (set->errors[j] == ssock->socket) {
+				ssock->failed = true;
+			}
+		}
+		for (j = 0; j < nSockets && !SOCKET_FAILED(set->writes[j]); ++j) {
+			if (set->writes[j] == ssock->socket && !_mScriptSocketFlush(ssock)) {
+				ssock->failed = true;
+			}
+		}
+		if (ssock->failed) {
+			_mScriptSocketSetError(ssock, SocketError());
+		}
+	}
+#endif
+
+	// Callbacks may close sockets, which removes them from the set, so
+	// collect the ids first
+	struct UInt32List ready;
+	UInt32ListInit(&ready, 0);
+	for (i = 0; i < nSockets; ++i) {
+		if (sockets[i]->readable || sockets[i]->failed) {
+			*UInt32ListAppend(&ready) = sockets[i]->id;
+		}
+	}
+	int32_t nReady = UInt32ListSize(&ready);
+	for (i = 0; i < UInt32ListSize(&ready); ++i) {
+		struct mScriptList args;
+		mScriptListInit(&args, 1);
+		*mScriptListAppend(&args) = mSCRIPT_MAKE_U32(*UInt32ListGetPointer(&ready, i));
+		mScriptContextTriggerCallback(set->context, "socketReady", &args);
+		mScriptListDeinit(&args);
+	}
+	UInt32ListDeinit(&ready);
+	return nReady;
+}
+
+static void _mScriptSocketSetDeinit(struct mScriptSocketSet* set) {
+	while (mScriptSocketListSize(&set->sockets)) {
+		_mScriptSocketSetRemove(set, *mScriptSocketListGetPointer(&set->sockets, 0));
+	}
+	mScriptSocketListDeinit(&set->sockets);
+#ifdef USE_POLL
+	free(set->fds);
+#else
+	free(set->reads);
+	free(set->writes);
+	free(set->errors);
+#endif
+}
+
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptSocketSet, U32, add, _mScriptSocketSetAdd, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, remove, _mScriptSocketSetRemove, 1, S(mScriptSocket), socket);
+mSCRIPT_DECLARE_STRUCT_METHOD_WITH_DEFAULTS(mScriptSocketSet, S32, poll, _mScriptSocketSetPoll, 1, S64, timeoutMillis);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptSocketSet, _deinit, _mScriptSocketSetDeinit, 0);
+
+mSCRIPT_DEFINE_STRUCT(mScriptSocketSet)
+	mSCRIPT_DEFINE_INTERNAL
+	mSCRIPT_DEFINE_CLASS_DOCSTRING(
+		"An internal set of sockets that are polled together. For each socket that is readable or has failed, "
+		"the `socketReady` callback is called with the id that was returned when it was added."
+	)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptSocketSet)
+	mSCRIPT_DEFINE_DOCSTRING("Adds a socket to the set, returning its id. Closing the socket removes it again.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, add)
+	mSCRIPT_DEFINE_DOCSTRING("Removes a socket from the set.")
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, remove)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Checks every socket in the set with a single call, sends queued data on writable sockets, "
+		"and calls back for each ready socket. Returns the number of ready sockets, -1 if polling fails, "
+		"or a negative error code if the set could not grow to fit every socket."
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptSocketSet, poll)
+mSCRIPT_DEFINE_END;
+
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptSocketSet, poll)
+	mSCRIPT_S64(0)
+mSCRIPT_DEFINE_DEFAULTS_END;
 
 void mScriptContextAttachSocket(struct mScriptContext* context) {
+	struct mScriptValue* events = mScriptValueAlloc(mSCRIPT_TYPE_MS_S(mScriptSocketSet));
+	struct mScriptSocketSet* set = calloc(1, sizeof(*set));
+	set->context = context;
+	set->nextId = 1;
+	mScriptSocketListInit(&set->sockets, 0);
+	events->value.opaque = set;
+	events->flags = mSCRIPT_VALUE_FLAG_DEINIT | mSCRIPT_VALUE_FLAG_FREE_BUFFER;
+
 	mScriptContextExportNamespace(context, "_socket", (struct mScriptKVPair[]) {
 		mSCRIPT_KV_PAIR(create, &mScriptSocketCreate_Binding),
+		mSCRIPT_KV_PAIR(events, events),
 		mSCRIPT_KV_SENTINEL
 	});
 	mScriptContextSetDocstring(context, "_socket", "Basic TCP sockets library");
 	mScriptContextSetDocstring(context, "_socket.create", "Creates a new socket object");
+	mScriptContextSetDocstring(context, "_socket.events", "The set of sockets polled once per frame");
 	mScriptContextExportConstants(context, "SOCKERR", (struct mScriptKVPair[]) {
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, UNKNOWN_ERROR),
 		mSCRIPT_CONSTANT_PAIR(mSCRIPT_SOCKERR, OK),
@@ -37,6 +37,104 @@ static uint32_t _mScriptCallbackOneshot(struct mScriptCallbackManager* adapter,
 	return id;
 }
 
+static uint32_t _mScriptCallbackWatch(struct mScriptCallbackManager* adapter, struct mScriptValue* domain, uint32_t address, uint32_t length, struct mScriptValue* fn) {
+	if (fn->type->base == mSCRIPT_TYPE_WRAPPER) {
+		fn = mScriptValueUnwrap(fn);
+	}
+	if (domain->type->base == mSCRIPT_TYPE_WRAPPER) {
+		domain = mScriptValueUnwrap(domain);
+	}
+	// Watched ranges are copied every check, so keep them within the domain
+	struct mScriptValue sizeFn;
+	if (!mScriptObjectGet(domain, "size", &sizeFn)) {
+		return 0;
+	}
+	struct mScriptFrame frame;
+	uint32_t size = 0;
+	mScriptFrameInit(&frame);
+	mScriptValueWrap(domain, mScriptListAppend(&frame.stack));
+	bool ok = mScriptInvoke(&sizeFn, &frame) && mScriptPopU32(&frame.stack, &size);
+	mScriptFrameDeinit(&frame);
+	if (!ok || (uint64_t) address + length > size) {
+		return 0;
+	}
+	return mScriptContextAddWatch(adapter->context, domain, address, length, fn);
+}
+
+static void _mScriptCallbackAddStats(struct mScriptValue* table, const char* name, struct mScriptValue* value) {
+	struct mScriptValue* key = mScriptStringCreateFromUTF8(name);
+	mScriptTableInsert(table, key, value);
+	mScriptValueDeref(key);
+	mScriptValueDeref(value);
+}
+
+static void _mScriptCallbackCollectStats(const char* callback, const struct mScriptCallbackStats* stats, void* user) {
+	struct mScriptValue* entry = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = stats->triggers;
+	_mScriptCallbackAddStats(entry, "triggers", value);
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = stats->calls;
+	_mScriptCallbackAddStats(entry, "calls", value);
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_F64);
+	value->value.f64 = stats->usec / 1000000.;
+	_mScriptCallbackAddStats(entry, "time", value);
+	_mScriptCallbackAddStats(user, callback, entry);
+}
+
+static struct mScriptValue* _mScriptCallbackStats(struct mScriptCallbackManager* adapter) {
+	struct mScriptValue* stats = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	mScriptContextEnumerateCallbackStats(adapter->context, _mScriptCallbackCollectStats, stats);
+	return stats;
+}
+
+static void _mScriptCallbackSetProfiling(struct mScriptCallbackManager* adapter, bool enable) {
+	mScriptContextSetProfiling(adapter->context, enable);
+}
+
+static void _mScriptCallbackCollectProfile(const struct mScriptCallbackProfile* profile, void* user) {
+	struct mScriptValue* entry = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	_mScriptCallbackAddStats(entry, "callback", mScriptStringCreateFromUTF8(profile->callback));
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = profile->calls;
+	_mScriptCallbackAddStats(entry, "calls", value);
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_F64);
+	value->value.f64 = profile->usec / 1000000.;
+	_mScriptCallbackAddStats(entry, "time", value);
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = profile->deferred;
+	_mScriptCallbackAddStats(entry, "deferred", value);
+
+	struct mScriptValue* key = mScriptValueCreateFromUInt(profile->id);
+	mScriptTableInsert(user, key, entry);
+	mScriptValueDeref(key);
+	mScriptValueDeref(entry);
+}
+
+static void _mScriptCallbackCollectSamples(const char* function, uint64_t samples, void* user) {
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+	value->value.u64 = samples;
+	_mScriptCallbackAddStats(user, function, value);
+}
+
+static struct mScriptValue* _mScriptCallbackProfile(struct mScriptCallbackManager* adapter) {
+	struct mScriptValue* profile = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	struct mScriptValue* callbacks = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	mScriptContextEnumerateCallbackProfiles(adapter->context, _mScriptCallbackCollectProfile, callbacks);
+	_mScriptCallbackAddStats(profile, "callbacks", callbacks);
+	struct mScriptValue* functions = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	mScriptContextEnumerateFunctionProfiles(adapter->context, _mScriptCallbackCollectSamples, functions);
+	_mScriptCallbackAddStats(profile, "functions", functions);
+	return profile;
+}
+
+static void _mScriptCallbackSetFrameBudget(struct mScriptCallbackManager* adapter, double seconds, bool defer) {
+	if (seconds < 0) {
+		seconds = 0;
+	}
+	mScriptContextSetFrameBudget(adapter->context, seconds * 1000000, defer);
+}
+
 static void _mScriptCallbackRemove(struct mScriptCallbackManager* adapter, uint32_t id) {
 	mScriptContextRemoveCallback(adapter->context, id);
 }
@@ -44,8 +142,18 @@ static void _mScriptCallbackRemove(struct mScriptCallbackManager* adapter, uint3
 mSCRIPT_DECLARE_STRUCT(mScriptCallbackManager);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, U32, add, _mScriptCallbackAdd, 2, STR, callback, WRAPPER, function);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, U32, oneshot, _mScriptCallbackOneshot, 2, STR, callback, WRAPPER, function);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, U32, watch, _mScriptCallbackWatch, 4, WRAPPER, domain, U32, address, U32, length, WRAPPER, function);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, WTABLE, stats, _mScriptCallbackStats, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCallbackManager, setProfiling, _mScriptCallbackSetProfiling, 1, BOOL, enable);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptCallbackManager, WTABLE, profile, _mScriptCallbackProfile, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD_WITH_DEFAULTS(mScriptCallbackManager, setFrameBudget, _mScriptCallbackSetFrameBudget, 2, F64, seconds, BOOL, defer);
 mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptCallbackManager, remove, _mScriptCallbackRemove, 1, U32, cbid);
 
+mSCRIPT_DEFINE_STRUCT_BINDING_DEFAULTS(mScriptCallbackManager, setFrameBudget)
+	mSCRIPT_NO_DEFAULT,
+	mSCRIPT_VAL(BOOL, false)
+mSCRIPT_DEFINE_DEFAULTS_END;
+
 static uint64_t mScriptMakeBitmask(struct mScriptList* list) {
 	size_t i;
 	uint64_t mask = 0;
@@ -97,8 +205,36 @@ mSCRIPT_DEFINE_STRUCT(mScriptCallbackManager)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, add)
 	mSCRIPT_DEFINE_DOCSTRING("Add a one-shot callback of the named type that will be automatically removed after called. The returned id can be used to remove it early")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, oneshot)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Add a callback that is called at the end of any frame in which the given range of a memory domain changed. "
+		"Changes within a single frame are batched into one call. The range must lie within the domain. "
+		"The returned id can be used to remove it, and is 0 if the watch couldn't be added"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, watch)
 	mSCRIPT_DEFINE_DOCSTRING("Remove a callback with the previously retuned id")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, remove)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a table of statistics for each named callback type, with the number of times it was triggered, "
+		"the total number of callbacks called, and the total time in seconds spent calling them"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, stats)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Enable or disable profiling. While enabled, every callback is timed individually and the running script "
+		"functions are sampled periodically. Enabling it again clears the previous results"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, setProfiling)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get the results of profiling. `callbacks` is indexed by callback id and contains the callback type, the number "
+		"of calls, the total time in seconds and the number of times it was deferred. `functions` maps each script "
+		"function, by source and line, to the number of times it was sampled"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, profile)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Set how many seconds callbacks may take per frame before a warning is logged. If `defer` is true, callbacks "
+		"without arguments are also skipped for the rest of the frame once it's exceeded, and the next frame starts with "
+		"the ones that were skipped. Use 0 to disable the budget"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptCallbackManager, setFrameBudget)
 mSCRIPT_DEFINE_END;
 
 static struct mScriptValue* _mRectangleNew(int32_t x, int32_t y, int32_t width, int32_t height) {
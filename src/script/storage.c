@@ -6,6 +6,9 @@
 #include <mgba/script/storage.h>
 
 #include <mgba/core/config.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
 #include <mgba-util/vfs.h>
 
 #include <json.h>
@@ -13,15 +16,69 @@
 
 #define STORAGE_LEN_MAX 64
 
+#define STORAGE_LOG_MAGIC 0x5453546D // "mTST"
+#define STORAGE_LOG_VERSION 1
+#define STORAGE_LOG_HEADER_SIZE 8
+#define STORAGE_LOG_RECORD_HEADER_SIZE 8
+
+// Logs are only compacted once they are at least this big and twice
+// the size of the data they actually hold
+#define STORAGE_COMPACT_MIN 0x10000
+
+enum mScriptStorageTag {
+	mSTORAGE_TAG_NULL = 0,
+	mSTORAGE_TAG_SINT,
+	mSTORAGE_TAG_UINT,
+	mSTORAGE_TAG_FLOAT,
+	mSTORAGE_TAG_BOOL,
+	mSTORAGE_TAG_STRING,
+	mSTORAGE_TAG_LIST,
+	mSTORAGE_TAG_TABLE,
+};
+
+struct mScriptStorageContext;
+
 struct mScriptStorageBucket {
+	struct mScriptStorageContext* storage;
 	char* name;
 	struct mScriptValue* root;
 	bool autoflush;
-	bool dirty;
+
+	// Keys changed since the last flush; only these get appended to the log
+	struct Table dirtyKeys;
+	// Size of the newest record for each key, to tell how much of the log is stale
+	struct Table recordSizes;
+	size_t logSize;
+	size_t liveSize;
+	bool needsRewrite;
+	bool writeFailed;
+};
+
+struct mScriptStorageJob {
+	struct mScriptStorageBucket* bucket;
+	char path[PATH_MAX];
+	struct UInt8List data;
+	bool rewrite;
+	bool failed;
 };
 
+DECLARE_VECTOR(mScriptStorageJobList, struct mScriptStorageJob);
+DEFINE_VECTOR(mScriptStorageJobList, struct mScriptStorageJob);
+
 struct mScriptStorageContext {
 	struct Table buckets;
+
+	struct mScriptStorageJobList jobs;
+#ifndef DISABLE_THREADING
+	Thread writer;
+	Mutex mutex;
+	Condition jobAvailable;
+	Condition jobsDone;
+	bool writerRunning;
+	bool writerBusy;
+#endif
+	// Once the context is being torn down, jobs are written immediately instead
+	bool writeImmediately;
 };
 
 void mScriptStorageBucketDeinit(void*);
@@ -77,7 +134,7 @@ mSCRIPT_DEFINE_STRUCT(mScriptStorageBucket)
 	mSCRIPT_DEFINE_STRUCT_DEFAULT_GET(mScriptStorageBucket)
 	mSCRIPT_DEFINE_DOCSTRING("Reload the state of the bucket from disk")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptStorageBucket, reload)
-	mSCRIPT_DEFINE_DOCSTRING("Flush the bucket to disk manually")
+	mSCRIPT_DEFINE_DOCSTRING("Flush the bucket to disk manually, waiting until it has been written")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptStorageBucket, flush)
 	mSCRIPT_DEFINE_DOCSTRING(
 		"Enable or disable the automatic flushing of this bucket. This is good for ensuring buckets "
@@ -119,7 +176,7 @@ void mScriptStorageBucketSet(struct mScriptStorageBucket* bucket, const char* ke
 	}
 	mScriptTableInsert(bucket->root, vkey, value);
 	mScriptValueDeref(vkey);
-	bucket->dirty = true;
+	HashTableInsert(&bucket->dirtyKeys, key, bucket);
 }
 
 void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char* key, struct mScriptValue* value) {
@@ -127,7 +184,7 @@ void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char
 	struct mScriptValue* vkey = mScriptStringCreateFromUTF8(key);
 	mScriptTableInsert(bucket->root, vkey, &mScriptValueNull);
 	mScriptValueDeref(vkey);
-	bucket->dirty = true;
+	HashTableInsert(&bucket->dirtyKeys, key, bucket);
 }
 
 #define MAKE_SCALAR_SETTER(NAME, TYPE) \
@@ -138,7 +195,7 @@ void mScriptStorageBucketSetVoid(struct mScriptStorageBucket* bucket, const char
 		mScriptTableInsert(bucket->root, vkey, vval); \
 		mScriptValueDeref(vkey); \
 		mScriptValueDeref(vval); \
-		bucket->dirty = true; \
+		HashTableInsert(&bucket->dirtyKeys, key, bucket); \
 	}
 
 MAKE_SCALAR_SETTER(SInt, S64)
@@ -146,7 +203,7 @@ MAKE_SCALAR_SETTER(UInt, U64)
 MAKE_SCALAR_SETTER(Float, F64)
 MAKE_SCALAR_SETTER(Bool, BOOL)
 
-void mScriptStorageGetBucketPath(const char* bucket, char* out) {
+static void _mScriptStorageGetPath(const char* bucket, const char* extension, char* out) {
 	mCoreConfigDirectory(out, PATH_MAX);
 
 	strncat(out, PATH_SEP "storage" PATH_SEP, PATH_MAX - 1);
@@ -160,10 +217,599 @@ void mScriptStorageGetBucketPath(const char* bucket, char* out) {
 #endif
 
 	char suffix[STORAGE_LEN_MAX + 6];
-	snprintf(suffix, sizeof(suffix), "%s.json", bucket);
+	snprintf(suffix, sizeof(suffix), "%s.%s", bucket, extension);
 	strncat(out, suffix, PATH_MAX - 1);
 }
 
+void mScriptStorageGetBucketPath(const char* bucket, char* out) {
+	_mScriptStorageGetPath(bucket, "json", out);
+}
+
+void mScriptStorageGetBucketBinaryPath(const char* bucket, char* out) {
+	_mScriptStorageGetPath(bucket, "bin", out);
+}
+
+static bool _mScriptStorageReplaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+	WCHAR wfrom[MAX_PATH];
+	WCHAR wto[MAX_PATH];
+	MultiByteToWideChar(CP_UTF8, 0, from, -1, wfrom, MAX_PATH);
+	MultiByteToWideChar(CP_UTF8, 0, to, -1, wto, MAX_PATH);
+	return MoveFileExW(wfrom, wto, MOVEFILE_REPLACE_EXISTING);
+#else
+	return rename(from, to) == 0;
+#endif
+}
+
+static void _putBytes(struct UInt8List* out, const void* data, size_t size) {
+	if (!size) {
+		return;
+	}
+	size_t offset = UInt8ListSize(out);
+	UInt8ListResize(out, size);
+	memcpy(UInt8ListGetPointer(out, offset), data, size);
+}
+
+static void _store32(uint8_t* bytes, uint32_t value) {
+	bytes[0] = value;
+	bytes[1] = value >> 8;
+	bytes[2] = value >> 16;
+	bytes[3] = value >> 24;
+}
+
+static void _put32(struct UInt8List* out, uint32_t value) {
+	uint8_t bytes[4];
+	_store32(bytes, value);
+	_putBytes(out, bytes, sizeof(bytes));
+}
+
+static void _put64(struct UInt8List* out, uint64_t value) {
+	_put32(out, value);
+	_put32(out, value >> 32);
+}
+
+static void _put8(struct UInt8List* out, uint8_t value) {
+	*UInt8ListAppend(out) = value;
+}
+
+static bool _get32(const uint8_t** cursor, const uint8_t* end, uint32_t* value) {
+	if (end - *cursor < 4) {
+		return false;
+	}
+	const uint8_t* bytes = *cursor;
+	*value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+	*cursor += 4;
+	return true;
+}
+
+static bool _get64(const uint8_t** cursor, const uint8_t* end, uint64_t* value) {
+	uint32_t lo;
+	uint32_t hi;
+	if (!_get32(cursor, end, &lo) || !_get32(cursor, end, &hi)) {
+		return false;
+	}
+	*value = lo | ((uint64_t) hi << 32);
+	return true;
+}
+
+static bool _serializeValue(struct mScriptValue* value, struct UInt8List* out);
+
+static bool _serializeKey(struct mScriptValue* key, struct UInt8List* out) {
+	if (key->type == mSCRIPT_TYPE_MS_CHARP) {
+		size_t size = strlen(key->value.copaque);
+		_put32(out, size);
+		_putBytes(out, key->value.copaque, size);
+	} else if (key->type == mSCRIPT_TYPE_MS_STR) {
+		_put32(out, key->value.string->size);
+		_putBytes(out, key->value.string->buffer, key->value.string->size);
+	} else {
+		// Only string keys can be exported to JSON, so only allow them here too
+		return false;
+	}
+	return true;
+}
+
+bool _serializeValue(struct mScriptValue* value, struct UInt8List* out) {
+	if (value->type->base == mSCRIPT_TYPE_WRAPPER) {
+		value = mScriptValueUnwrap(value);
+	}
+
+	size_t i;
+	uint64_t bits;
+	struct TableIterator iter;
+	switch (value->type->base) {
+	case mSCRIPT_TYPE_SINT:
+		_put8(out, mSTORAGE_TAG_SINT);
+		_put64(out, value->type->size <= 4 ? (int64_t) value->value.s32 : value->value.s64);
+		break;
+	case mSCRIPT_TYPE_UINT:
+		if (value->type == mSCRIPT_TYPE_MS_BOOL) {
+			_put8(out, mSTORAGE_TAG_BOOL);
+			_put8(out, !!value->value.u32);
+			break;
+		}
+		_put8(out, mSTORAGE_TAG_UINT);
+		_put64(out, value->type->size <= 4 ? value->value.u32 : value->value.u64);
+		break;
+	case mSCRIPT_TYPE_FLOAT:
+		_put8(out, mSTORAGE_TAG_FLOAT);
+		if (value->type->size <= 4) {
+			double f64 = value->value.f32;
+			memcpy(&bits, &f64, sizeof(bits));
+		} else {
+			memcpy(&bits, &value->value.f64, sizeof(bits));
+		}
+		_put64(out, bits);
+		break;
+	case mSCRIPT_TYPE_STRING:
+		_put8(out, mSTORAGE_TAG_STRING);
+		_put32(out, value->value.string->size);
+		_putBytes(out, value->value.string->buffer, value->value.string->size);
+		break;
+	case mSCRIPT_TYPE_LIST:
+		_put8(out, mSTORAGE_TAG_LIST);
+		_put32(out, mScriptListSize(value->value.list));
+		for (i = 0; i < mScriptListSize(value->value.list); ++i) {
+			if (!_serializeValue(mScriptListGetPointer(value->value.list, i), out)) {
+				return false;
+			}
+		}
+		break;
+	case mSCRIPT_TYPE_TABLE:
+		_put8(out, mSTORAGE_TAG_TABLE);
+		_put32(out, mScriptTableSize(value));
+		if (mScriptTableIteratorStart(value, &iter)) {
+			do {
+				if (!_serializeKey(mScriptTableIteratorGetKey(value, &iter), out)) {
+					return false;
+				}
+				if (!_serializeValue(mScriptTableIteratorGetValue(value, &iter), out)) {
+					return false;
+				}
+			} while (mScriptTableIteratorNext(value, &iter));
+		}
+		break;
+	case mSCRIPT_TYPE_VOID:
+		_put8(out, mSTORAGE_TAG_NULL);
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static struct mScriptValue* _deserializeValue(const uint8_t** cursor, const uint8_t* end) {
+	if (*cursor >= end) {
+		return NULL;
+	}
+	uint8_t tag = **cursor;
+	++*cursor;
+
+	struct mScriptValue* value = NULL;
+	uint64_t bits;
+	uint32_t size;
+	uint32_t i;
+	switch (tag) {
+	case mSTORAGE_TAG_NULL:
+		return &mScriptValueNull;
+	case mSTORAGE_TAG_SINT:
+		if (!_get64(cursor, end, &bits)) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S64);
+		value->value.s64 = bits;
+		break;
+	case mSTORAGE_TAG_UINT:
+		if (!_get64(cursor, end, &bits)) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_U64);
+		value->value.u64 = bits;
+		break;
+	case mSTORAGE_TAG_FLOAT:
+		if (!_get64(cursor, end, &bits)) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_F64);
+		memcpy(&value->value.f64, &bits, sizeof(bits));
+		break;
+	case mSTORAGE_TAG_BOOL:
+		if (*cursor >= end) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_BOOL);
+		value->value.u32 = !!**cursor;
+		++*cursor;
+		break;
+	case mSTORAGE_TAG_STRING:
+		if (!_get32(cursor, end, &size) || (size_t) (end - *cursor) < size) {
+			return NULL;
+		}
+		value = mScriptStringCreateFromBytes((const char*) *cursor, size);
+		*cursor += size;
+		break;
+	case mSTORAGE_TAG_LIST:
+		if (!_get32(cursor, end, &size)) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+		for (i = 0; i < size; ++i) {
+			struct mScriptValue* vval = _deserializeValue(cursor, end);
+			if (!vval) {
+				mScriptValueDeref(value);
+				return NULL;
+			}
+			mScriptValueWrap(vval, mScriptListAppend(value->value.list));
+			mScriptValueDeref(vval);
+		}
+		break;
+	case mSTORAGE_TAG_TABLE:
+		if (!_get32(cursor, end, &size)) {
+			return NULL;
+		}
+		value = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		for (i = 0; i < size; ++i) {
+			uint32_t keySize;
+			if (!_get32(cursor, end, &keySize) || (size_t) (end - *cursor) < keySize) {
+				mScriptValueDeref(value);
+				return NULL;
+			}
+			struct mScriptValue* vkey = mScriptStringCreateFromBytes((const char*) *cursor, keySize);
+			*cursor += keySize;
+			struct mScriptValue* vval = _deserializeValue(cursor, end);
+			if (!vval) {
+				mScriptValueDeref(vkey);
+				mScriptValueDeref(value);
+				return NULL;
+			}
+			mScriptTableInsert(value, vkey, vval);
+			mScriptValueDeref(vkey);
+			mScriptValueDeref(vval);
+		}
+		break;
+	default:
+		return NULL;
+	}
+	return value;
+}
+
+// Each record is a length and CRC32 followed by a key and its value. A torn
+// or corrupted record at the end of the log fails the CRC and is dropped.
+static bool _appendRecord(struct mScriptStorageBucket* bucket, const char* key, struct mScriptValue* value, struct UInt8List* out) {
+	size_t start = UInt8ListSize(out);
+	size_t keySize = strlen(key);
+	UInt8ListResize(out, STORAGE_LOG_RECORD_HEADER_SIZE);
+	_put32(out, keySize);
+	_putBytes(out, key, keySize);
+	if (!_serializeValue(value, out)) {
+		UInt8ListResize(out, -(ssize_t) (UInt8ListSize(out) - start));
+		return false;
+	}
+	size_t payloadSize = UInt8ListSize(out) - start - STORAGE_LOG_RECORD_HEADER_SIZE;
+	uint8_t* record = UInt8ListGetPointer(out, start);
+	uint32_t crc = crc32(0, &record[STORAGE_LOG_RECORD_HEADER_SIZE], payloadSize);
+	_store32(&record[0], payloadSize);
+	_store32(&record[4], crc);
+
+	size_t recordSize = payloadSize + STORAGE_LOG_RECORD_HEADER_SIZE;
+	size_t oldSize = (uintptr_t) HashTableLookup(&bucket->recordSizes, key);
+	bucket->liveSize += recordSize - oldSize;
+	HashTableInsert(&bucket->recordSizes, key, (void*) (uintptr_t) recordSize);
+	return true;
+}
+
+static bool _serializeBucket(struct mScriptStorageBucket* bucket, struct UInt8List* out) {
+	HashTableClear(&bucket->recordSizes);
+	bucket->liveSize = 0;
+	_put32(out, STORAGE_LOG_MAGIC);
+	_put32(out, STORAGE_LOG_VERSION);
+
+	struct TableIterator iter;
+	if (!mScriptTableIteratorStart(bucket->root, &iter)) {
+		return true;
+	}
+	do {
+		struct mScriptValue* key = mScriptTableIteratorGetKey(bucket->root, &iter);
+		const char* ckey;
+		if (key->type == mSCRIPT_TYPE_MS_CHARP) {
+			ckey = key->value.copaque;
+		} else if (key->type == mSCRIPT_TYPE_MS_STR) {
+			ckey = key->value.string->buffer;
+		} else {
+			return false;
+		}
+		if (!_appendRecord(bucket, ckey, mScriptTableIteratorGetValue(bucket->root, &iter), out)) {
+			return false;
+		}
+	} while (mScriptTableIteratorNext(bucket->root, &iter));
+	return true;
+}
+
+static struct mScriptValue* _mScriptStorageLoadLog(struct mScriptStorageBucket* bucket, struct VFile* vf) {
+	ssize_t size = vf->size(vf);
+	if (size < STORAGE_LOG_HEADER_SIZE) {
+		vf->close(vf);
+		return NULL;
+	}
+	uint8_t* data = malloc(size);
+	if (vf->read(vf, data, size) != size) {
+		free(data);
+		vf->close(vf);
+		return NULL;
+	}
+	vf->close(vf);
+
+	const uint8_t* cursor = data;
+	const uint8_t* end = &data[size];
+	uint32_t magic;
+	uint32_t version;
+	_get32(&cursor, end, &magic);
+	_get32(&cursor, end, &version);
+	if (magic != STORAGE_LOG_MAGIC || version != STORAGE_LOG_VERSION) {
+		free(data);
+		return NULL;
+	}
+
+	HashTableClear(&bucket->recordSizes);
+	bucket->liveSize = 0;
+	struct mScriptValue* root = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	while (cursor < end) {
+		const uint8_t* record = cursor;
+		uint32_t payloadSize;
+		uint32_t crc;
+		if (!_get32(&cursor, end, &payloadSize) || !_get32(&cursor, end, &crc)) {
+			break;
+		}
+		if ((size_t) (end - cursor) < payloadSize || crc32(0, cursor, payloadSize) != crc) {
+			break;
+		}
+		const uint8_t* recordEnd = &cursor[payloadSize];
+		uint32_t keySize;
+		if (!_get32(&cursor, recordEnd, &keySize) || (size_t) (recordEnd - cursor) < keySize) {
+			break;
+		}
+		struct mScriptValue* vkey = mScriptStringCreateFromBytes((const char*) cursor, keySize);
+		cursor += keySize;
+		struct mScriptValue* value = _deserializeValue(&cursor, recordEnd);
+		if (!value) {
+			mScriptValueDeref(vkey);
+			break;
+		}
+		mScriptTableInsert(root, vkey, value);
+		mScriptValueDeref(value);
+		cursor = recordEnd;
+
+		const char* key = vkey->value.string->buffer;
+		size_t recordSize = cursor - record;
+		size_t oldSize = (uintptr_t) HashTableLookup(&bucket->recordSizes, key);
+		bucket->liveSize += recordSize - oldSize;
+		HashTableInsert(&bucket->recordSizes, key, (void*) (uintptr_t) recordSize);
+		mScriptValueDeref(vkey);
+	}
+	bucket->logSize = cursor - data;
+	// Anything left over is a torn write, so rewrite the log without it
+	bucket->needsRewrite = cursor != end;
+	free(data);
+	return root;
+}
+
+static bool _mScriptStorageRunJob(struct mScriptStorageJob* job) {
+	struct VFile* vf;
+	if (!job->rewrite) {
+		if (!UInt8ListSize(&job->data)) {
+			return true;
+		}
+		vf = VFileOpen(job->path, O_WRONLY);
+		if (!vf) {
+			return false;
+		}
+		vf->seek(vf, 0, SEEK_END);
+		bool ok = vf->write(vf, UInt8ListGetPointer(&job->data, 0), UInt8ListSize(&job->data)) == (ssize_t) UInt8ListSize(&job->data);
+		vf->close(vf);
+		return ok;
+	}
+
+	// Write compacted logs next to the old one so it stays intact if anything fails
+	char tmpPath[PATH_MAX + 4];
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", job->path);
+	vf = VFileOpen(tmpPath, O_WRONLY | O_CREAT | O_TRUNC);
+	if (!vf) {
+		return false;
+	}
+	bool ok = vf->write(vf, UInt8ListGetPointer(&job->data, 0), UInt8ListSize(&job->data)) == (ssize_t) UInt8ListSize(&job->data);
+	vf->close(vf);
+	if (!ok) {
+		remove(tmpPath);
+		return false;
+	}
+	return _mScriptStorageReplaceFile(tmpPath, job->path);
+}
+
+// Runs a batch of jobs, merging consecutive appends to the same log so each
+// log is only opened once per batch
+static void _mScriptStorageRunJobs(struct mScriptStorageJobList* jobs) {
+	size_t i;
+	for (i = 0; i < mScriptStorageJobListSize(jobs); ++i) {
+		struct mScriptStorageJob* job = mScriptStorageJobListGetPointer(jobs, i);
+		while (i + 1 < mScriptStorageJobListSize(jobs) && job[1].bucket == job->bucket) {
+			struct mScriptStorageJob* next = &job[1];
+			if (next->rewrite) {
+				// A rewrite replaces everything queued before it
+				UInt8ListDeinit(&job->data);
+			} else {
+				if (UInt8ListSize(&next->data)) {
+					_putBytes(&job->data, UInt8ListGetPointer(&next->data, 0), UInt8ListSize(&next->data));
+				}
+				UInt8ListDeinit(&next->data);
+				next->data = job->data;
+				next->rewrite = job->rewrite;
+			}
+			++i;
+			job = next;
+		}
+		job->failed = !_mScriptStorageRunJob(job);
+		UInt8ListDeinit(&job->data);
+	}
+}
+
+#ifndef DISABLE_THREADING
+static THREAD_ENTRY _mScriptStorageWriterThread(void* context) {
+	struct mScriptStorageContext* storage = context;
+	ThreadSetName("Script storage");
+	struct mScriptStorageJobList jobs;
+	mScriptStorageJobListInit(&jobs, 0);
+	MutexLock(&storage->mutex);
+	while (true) {
+		if (!mScriptStorageJobListSize(&storage->jobs)) {
+			if (!storage->writerRunning) {
+				break;
+			}
+			ConditionWait(&storage->jobAvailable, &storage->mutex);
+			continue;
+		}
+		// Take everything queued so far, so the emulation thread can keep
+		// queueing while this batch is written
+		struct mScriptStorageJobList batch = storage->jobs;
+		storage->jobs = jobs;
+		jobs = batch;
+		storage->writerBusy = true;
+		MutexUnlock(&storage->mutex);
+
+		_mScriptStorageRunJobs(&jobs);
+
+		MutexLock(&storage->mutex);
+		size_t i;
+		for (i = 0; i < mScriptStorageJobListSize(&jobs); ++i) {
+			struct mScriptStorageJob* job = mScriptStorageJobListGetPointer(&jobs, i);
+			if (job->failed) {
+				job->bucket->writeFailed = true;
+			}
+		}
+		mScriptStorageJobListClear(&jobs);
+		storage->writerBusy = false;
+		ConditionWake(&storage->jobsDone);
+	}
+	MutexUnlock(&storage->mutex);
+	mScriptStorageJobListDeinit(&jobs);
+	THREAD_EXIT(0);
+}
+#endif
+
+static void _mScriptStorageQueueJob(struct mScriptStorageContext* storage, struct mScriptStorageJob* job) {
+#ifndef DISABLE_THREADING
+	if (!storage->writeImmediately) {
+		MutexLock(&storage->mutex);
+		if (!storage->writerRunning) {
+			storage->writerRunning = true;
+			if (ThreadCreate(&storage->writer, _mScriptStorageWriterThread, storage)) {
+				// Without a writer thread, write everything on the calling thread
+				storage->writerRunning = false;
+				storage->writeImmediately = true;
+			}
+		}
+		if (storage->writerRunning) {
+			*mScriptStorageJobListAppend(&storage->jobs) = *job;
+			ConditionWake(&storage->jobAvailable);
+			MutexUnlock(&storage->mutex);
+			return;
+		}
+		MutexUnlock(&storage->mutex);
+	}
+#endif
+	if (!_mScriptStorageRunJob(job)) {
+		job->bucket->writeFailed = true;
+	}
+	UInt8ListDeinit(&job->data);
+}
+
+// Wait until everything queued so far has been written
+static void _mScriptStorageSync(struct mScriptStorageContext* storage) {
+#ifndef DISABLE_THREADING
+	MutexLock(&storage->mutex);
+	while (mScriptStorageJobListSize(&storage->jobs) || storage->writerBusy) {
+		ConditionWait(&storage->jobsDone, &storage->mutex);
+	}
+	MutexUnlock(&storage->mutex);
+#else
+	UNUSED(storage);
+#endif
+}
+
+static bool _mScriptStorageBucketIsDirty(struct mScriptStorageBucket* bucket) {
+	if (HashTableSize(&bucket->dirtyKeys) || bucket->needsRewrite) {
+		return true;
+	}
+	// A failed write still has to be retried, e.g. when the context is
+	// deinitialized right after an asynchronous write failed
+#ifndef DISABLE_THREADING
+	MutexLock(&bucket->storage->mutex);
+#endif
+	bool failed = bucket->writeFailed;
+#ifndef DISABLE_THREADING
+	MutexUnlock(&bucket->storage->mutex);
+#endif
+	return failed;
+}
+
+// Serializes the changes on the calling thread, and leaves the writing to
+// the writer thread
+static bool _mScriptStorageBucketQueueFlush(struct mScriptStorageBucket* bucket) {
+#ifndef DISABLE_THREADING
+	MutexLock(&bucket->storage->mutex);
+#endif
+	if (bucket->writeFailed) {
+		bucket->writeFailed = false;
+		bucket->needsRewrite = true;
+	}
+#ifndef DISABLE_THREADING
+	MutexUnlock(&bucket->storage->mutex);
+#endif
+	if (!_mScriptStorageBucketIsDirty(bucket) && bucket->logSize) {
+		return true;
+	}
+
+	struct mScriptStorageJob job = {
+		.bucket = bucket,
+		.rewrite = !bucket->logSize || bucket->needsRewrite ||
+		           (bucket->logSize >= STORAGE_COMPACT_MIN && bucket->logSize > bucket->liveSize * 2),
+	};
+	mScriptStorageGetBucketBinaryPath(bucket->name, job.path);
+	UInt8ListInit(&job.data, 0);
+
+	bool ok = true;
+	if (job.rewrite) {
+		ok = _serializeBucket(bucket, &job.data);
+	} else {
+		struct TableIterator iter;
+		if (HashTableIteratorStart(&bucket->dirtyKeys, &iter)) {
+			do {
+				const char* key = HashTableIteratorGetKey(&bucket->dirtyKeys, &iter);
+				struct mScriptValue* value = mScriptTableLookup(bucket->root, &mSCRIPT_MAKE_CHARP(key));
+				if (value && !_appendRecord(bucket, key, value, &job.data)) {
+					ok = false;
+					break;
+				}
+			} while (HashTableIteratorNext(&bucket->dirtyKeys, &iter));
+		}
+	}
+	if (!ok) {
+		// The record sizes may be partly updated now, so start over next time
+		UInt8ListDeinit(&job.data);
+		bucket->needsRewrite = true;
+		return false;
+	}
+
+	if (job.rewrite) {
+		bucket->logSize = UInt8ListSize(&job.data);
+	} else {
+		bucket->logSize += UInt8ListSize(&job.data);
+	}
+	HashTableClear(&bucket->dirtyKeys);
+	bucket->needsRewrite = false;
+	_mScriptStorageQueueJob(bucket->storage, &job);
+	return true;
+}
+
 static struct json_object* _tableToJson(struct mScriptValue* rootVal) {
 	bool ok = true;
 
@@ -297,20 +943,23 @@ static bool _mScriptStorageBucketFlushVF(struct mScriptStorageBucket* bucket, st
 	vf->write(vf, json, strlen(json));
 	vf->close(vf);
 
-	bucket->dirty = false;
-
 	json_object_put(rootObj);
 	return true;
 }
 
 bool mScriptStorageBucketFlush(struct mScriptStorageBucket* bucket) {
-	char path[PATH_MAX];
-	mScriptStorageGetBucketPath(bucket->name, path);
-	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
-	if (!vf) {
+	if (!_mScriptStorageBucketQueueFlush(bucket)) {
 		return false;
 	}
-	return _mScriptStorageBucketFlushVF(bucket, vf);
+	_mScriptStorageSync(bucket->storage);
+#ifndef DISABLE_THREADING
+	MutexLock(&bucket->storage->mutex);
+#endif
+	bool ok = !bucket->writeFailed;
+#ifndef DISABLE_THREADING
+	MutexUnlock(&bucket->storage->mutex);
+#endif
+	return ok;
 }
 
 void mScriptStorageBucketEnableAutoFlush(struct mScriptStorageBucket* bucket, bool enable) {
@@ -421,13 +1070,26 @@ static struct mScriptValue* _mScriptStorageLoadJson(struct VFile* vf) {
 }
 
 bool mScriptStorageBucketReload(struct mScriptStorageBucket* bucket) {
+	_mScriptStorageSync(bucket->storage);
+
 	char path[PATH_MAX];
-	mScriptStorageGetBucketPath(bucket->name, path);
+	mScriptStorageGetBucketBinaryPath(bucket->name, path);
 	struct VFile* vf = VFileOpen(path, O_RDONLY);
-	if (!vf) {
-		return false;
+	struct mScriptValue* root;
+	if (vf) {
+		root = _mScriptStorageLoadLog(bucket, vf);
+	} else {
+		// Buckets used to be stored as JSON, so import those and
+		// write them back out in the new format on the next flush
+		mScriptStorageGetBucketPath(bucket->name, path);
+		vf = VFileOpen(path, O_RDONLY);
+		if (!vf) {
+			return false;
+		}
+		root = _mScriptStorageLoadJson(vf);
+		bucket->logSize = 0;
+		bucket->needsRewrite = true;
 	}
-	struct mScriptValue* root = _mScriptStorageLoadJson(vf);
 	if (!root) {
 		return false;
 	}
@@ -435,8 +1097,7 @@ bool mScriptStorageBucketReload(struct mScriptStorageBucket* bucket) {
 		mScriptValueDeref(bucket->root);
 	}
 	bucket->root = root;
-
-	bucket->dirty = false;
+	HashTableClear(&bucket->dirtyKeys);
 
 	return true;
 }
@@ -455,8 +1116,8 @@ bool mScriptStorageLoadBucketVF(struct mScriptContext* context, const char* buck
 	struct mScriptStorageBucket* bucket = mScriptStorageGetBucket(storage, bucketName);
 	mScriptValueDeref(bucket->root);
 	bucket->root = root;
-
-	bucket->dirty = false;
+	HashTableClear(&bucket->dirtyKeys);
+	bucket->needsRewrite = true;
 
 	return true;
 }
@@ -478,6 +1139,12 @@ void mScriptContextAttachStorage(struct mScriptContext* context) {
 	value->value.opaque = storage;
 
 	HashTableInit(&storage->buckets, 0, mScriptStorageBucketDeinit);
+	mScriptStorageJobListInit(&storage->jobs, 0);
+#ifndef DISABLE_THREADING
+	MutexInit(&storage->mutex);
+	ConditionInit(&storage->jobAvailable);
+	ConditionInit(&storage->jobsDone);
+#endif
 
 	mScriptContextSetGlobal(context, "storage", value);
 	mScriptContextSetDocstring(context, "storage", "Singleton instance of struct::mScriptStorageContext");
@@ -493,16 +1160,46 @@ void mScriptStorageFlushAll(struct mScriptContext* context) {
 }
 
 void mScriptStorageContextDeinit(struct mScriptStorageContext* storage) {
+	struct TableIterator iter;
+	if (HashTableIteratorStart(&storage->buckets, &iter)) {
+		do {
+			struct mScriptStorageBucket* bucket = HashTableIteratorGetValue(&storage->buckets, &iter);
+			if (_mScriptStorageBucketIsDirty(bucket)) {
+				_mScriptStorageBucketQueueFlush(bucket);
+			}
+		} while (HashTableIteratorNext(&storage->buckets, &iter));
+	}
+
+#ifndef DISABLE_THREADING
+	MutexLock(&storage->mutex);
+	bool running = storage->writerRunning;
+	storage->writerRunning = false;
+	ConditionWake(&storage->jobAvailable);
+	MutexUnlock(&storage->mutex);
+	if (running) {
+		ThreadJoin(&storage->writer);
+	}
+#endif
+	storage->writeImmediately = true;
 	HashTableDeinit(&storage->buckets);
+
+#ifndef DISABLE_THREADING
+	ConditionDeinit(&storage->jobAvailable);
+	ConditionDeinit(&storage->jobsDone);
+	MutexDeinit(&storage->mutex);
+#endif
+	mScriptStorageJobListDeinit(&storage->jobs);
 }
 
+// Autoflushing doesn't wait for the writes to finish, so it can be done
+// periodically without stalling emulation
 void mScriptStorageContextFlushAll(struct mScriptStorageContext* storage) {
 	struct TableIterator iter;
 	if (HashTableIteratorStart(&storage->buckets, &iter)) {
 		do {
 			struct mScriptStorageBucket* bucket = HashTableIteratorGetValue(&storage->buckets, &iter);
 			if (bucket->autoflush) {
-				mScriptStorageBucketFlush(bucket);
+				_mScriptStorageBucketQueueFlush(bucket);
 			}
 		} while (HashTableIteratorNext(&storage->buckets, &iter));
 	}
@@ -537,8 +1234,11 @@ struct mScriptStorageBucket* mScriptStorageGetBucket(struct mScriptStorageContex
 	}
 
 	bucket = calloc(1, sizeof(*bucket));
+	bucket->storage = storage;
 	bucket->name = strdup(name);
 	bucket->autoflush = true;
+	HashTableInit(&bucket->dirtyKeys, 0, NULL);
+	HashTableInit(&bucket->recordSizes, 0, NULL);
 	if (!mScriptStorageBucketReload(bucket)) {
 		bucket->root = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
 	}
@@ -548,10 +1248,12 @@ struct mScriptStorageBucket* mScriptStorageGetBucket(struct mScriptStorageContex
 
 void mScriptStorageBucketDeinit(void* data) {
 	struct mScriptStorageBucket* bucket = data;
-	if (bucket->dirty) {
+	if (_mScriptStorageBucketIsDirty(bucket)) {
 		mScriptStorageBucketFlush(bucket);
 	}
 	mScriptValueDeref(bucket->root);
+	HashTableDeinit(&bucket->dirtyKeys);
+	HashTableDeinit(&bucket->recordSizes);
 	free(bucket->name);
 	free(bucket);
 }
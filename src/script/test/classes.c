@@ -448,6 +448,42 @@ M_TEST_DEFINE(testAGet) {
 	assert_false(cls->init);
 }
 
+M_TEST_DEFINE(testAGetSlot) {
+	struct mScriptTypeClass* cls = mSCRIPT_TYPE_MS_S(TestA)->details.cls;
+
+	struct TestA s = {
+		.i = 1,
+		.i2 = 2,
+	};
+
+	struct mScriptValue sval = mSCRIPT_MAKE_S(TestA, &s);
+	struct mScriptValue val;
+	struct mScriptValue compare;
+
+	int slotI = mScriptClassGetSlot(cls, "i");
+	int slotI2 = mScriptClassGetSlot(cls, "i2");
+	assert_true(slotI >= 0);
+	assert_true(slotI2 >= 0);
+	assert_int_not_equal(slotI, slotI2);
+	assert_int_equal(mScriptClassGetSlot(cls, "unknown"), -1);
+
+	compare = mSCRIPT_MAKE_S32(1);
+	assert_true(mScriptObjectGetSlot(&sval, slotI, &val));
+	assert_true(compare.type->equal(&compare, &val));
+
+	s.i2 = 3;
+	compare = mSCRIPT_MAKE_S32(3);
+	assert_true(mScriptObjectGetSlot(&sval, slotI2, &val));
+	assert_true(compare.type->equal(&compare, &val));
+
+	assert_false(mScriptObjectGetSlot(&sval, cls->nSlots, &val));
+	assert_false(mScriptObjectGetSlot(&sval, -1, &val));
+
+	assert_true(cls->init);
+	mScriptClassDeinit(cls);
+	assert_false(cls->init);
+}
+
 M_TEST_DEFINE(testASet) {
 	struct mScriptTypeClass* cls = mSCRIPT_TYPE_MS_S(TestA)->details.cls;
 
@@ -1252,6 +1288,7 @@ M_TEST_SUITE_DEFINE(mScriptClasses,
 	cmocka_unit_test(testALayout),
 	cmocka_unit_test(testASignatures),
 	cmocka_unit_test(testAGet),
+	cmocka_unit_test(testAGetSlot),
 	cmocka_unit_test(testASet),
 	cmocka_unit_test(testAStatic),
 	cmocka_unit_test(testADynamic),
@@ -521,6 +521,50 @@ M_TEST_DEFINE(globalStructFieldSet) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(globalStructMemberCache) {
+	SETUP_LUA;
+
+	struct Test s1 = {
+		.i = 1,
+		.ifn0 = testI0,
+	};
+	struct Test s2 = {
+		.i = 2,
+		.ifn0 = testI0,
+	};
+
+	struct mScriptValue a;
+	struct mScriptValue b;
+	struct mScriptValue* val;
+
+	LOAD_PROGRAM(
+		"assert(a.ifn0 == b.ifn0)\n"
+		"c = a:ifn0() * 10 + b:ifn0() + a.i * 100"
+	);
+
+	a = mSCRIPT_MAKE_S(Test, &s1);
+	assert_true(lua->setGlobal(lua, "a", &a));
+	a = mSCRIPT_MAKE_S(Test, &s2);
+	assert_true(lua->setGlobal(lua, "b", &a));
+
+	assert_true(lua->run(lua));
+	b = mSCRIPT_MAKE_S32(112);
+	val = lua->getGlobal(lua, "c");
+	assert_non_null(val);
+	assert_true(b.type->equal(&b, val));
+	mScriptValueDeref(val);
+
+	s1.i = 3;
+	assert_true(lua->run(lua));
+	b = mSCRIPT_MAKE_S32(332);
+	val = lua->getGlobal(lua, "c");
+	assert_non_null(val);
+	assert_true(b.type->equal(&b, val));
+	mScriptValueDeref(val);
+
+	mScriptContextDeinit(&context);
+}
+
 
 M_TEST_DEFINE(globalStructMethods) {
 	SETUP_LUA;
@@ -863,6 +907,7 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptLua,
 	cmocka_unit_test(globalNull),
 	cmocka_unit_test(globalStructFieldGet),
 	cmocka_unit_test(globalStructFieldSet),
+	cmocka_unit_test(globalStructMemberCache),
 	cmocka_unit_test(globalStructMethods),
 	cmocka_unit_test(errorReporting),
 	cmocka_unit_test(tableLookup),
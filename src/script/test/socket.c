@@ -0,0 +1,122 @@
+/* Copyright (c) 2013-2022 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/internal/script/lua.h>
+#include <mgba/script.h>
+#include <mgba-util/socket.h>
+
+#include "script/test.h"
+
+#define SETUP_LUA \
+	struct mScriptContext context; \
+	mScriptContextInit(&context); \
+	struct mScriptEngineContext* lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA); \
+	mScriptContextAttachStdlib(&context); \
+	mScriptContextAttachSocket(&context)
+
+#define SETUP_PAIR \
+	TEST_PROGRAM( \
+		"for port = 47800, 47831 do\n" \
+		"	server = socket.bind('127.0.0.1', port)\n" \
+		"	if server then\n" \
+		"		assert(server:listen())\n" \
+		"		client = assert(socket.connect('127.0.0.1', port))\n" \
+		"		peer = assert(server:accept())\n" \
+		"		break\n" \
+		"	end\n" \
+		"end\n" \
+		"assert(peer)" \
+	)
+
+M_TEST_SUITE_SETUP(mScriptSocket) {
+	if (mSCRIPT_ENGINE_LUA->init) {
+		mSCRIPT_ENGINE_LUA->init(mSCRIPT_ENGINE_LUA);
+	}
+	SocketSubsystemInit();
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(mScriptSocket) {
+	SocketSubsystemDeinit();
+	if (mSCRIPT_ENGINE_LUA->deinit) {
+		mSCRIPT_ENGINE_LUA->deinit(mSCRIPT_ENGINE_LUA);
+	}
+	return 0;
+}
+
+M_TEST_DEFINE(queueDrains) {
+	SETUP_LUA;
+	SETUP_PAIR;
+
+	// The peer never reads, so the kernel buffers fill up and the rest has to wait in the queue
+	TEST_PROGRAM(
+		"chunk = string.rep('x', 0x10000)\n"
+		"queued = 0\n"
+		"for i = 1, 1024 do\n"
+		"	assert(client:queue(chunk))\n"
+		"	queued = queued + #chunk\n"
+		"	if client:pending() > 0 then break end\n"
+		"end\n"
+		"assert(client:pending() > 0)"
+	);
+
+	TEST_PROGRAM(
+		"received = 0\n"
+		"for i = 1, 0x10000 do\n"
+		"	_socket.events:poll(0)\n"
+		"	local data = peer:receive(0x10000)\n"
+		"	if data then received = received + #data end\n"
+		"	if client:pending() == 0 and received == queued then break end\n"
+		"end\n"
+		"assert(client:pending() == 0)\n"
+		"assert(received == queued)"
+	);
+
+	TEST_PROGRAM("client:close() peer:close() server:close()");
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(queueLimit) {
+	SETUP_LUA;
+	SETUP_PAIR;
+
+	TEST_PROGRAM(
+		"chunk = string.rep('x', 0x10000)\n"
+		"queued = 0\n"
+		"for i = 1, 1024 do\n"
+		"	ok, err = client:queue(chunk)\n"
+		"	if not ok then break end\n"
+		"	queued = queued + #chunk\n"
+		"end\n"
+		"assert(not ok)\n"
+		"assert(err == socket.ERRORS.AGAIN)\n"
+		"assert(client:pending() > 0)\n"
+		"assert(client:pending() <= 0x100000)"
+	);
+
+	// Once the peer catches up, everything that was accepted still arrives
+	TEST_PROGRAM(
+		"received = 0\n"
+		"for i = 1, 0x10000 do\n"
+		"	_socket.events:poll(0)\n"
+		"	local data = peer:receive(0x10000)\n"
+		"	if data then received = received + #data end\n"
+		"	if client:pending() == 0 and received == queued then break end\n"
+		"end\n"
+		"assert(client:pending() == 0)\n"
+		"assert(received == queued)\n"
+		"assert(client:queue(chunk))"
+	);
+
+	TEST_PROGRAM("client:close() peer:close() server:close()");
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptSocket,
+	cmocka_unit_test(queueDrains),
+	cmocka_unit_test(queueLimit),
+)
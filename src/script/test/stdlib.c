@@ -126,6 +126,75 @@ M_TEST_DEFINE(oneshot) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(callbackRemoveDuringTrigger) {
+	SETUP_LUA;
+
+	TEST_PROGRAM(
+		"order = ''\n"
+		"a = callbacks:add('test', function() order = order .. 'a' callbacks:remove(b) end)\n"
+		"b = callbacks:add('test', function() order = order .. 'b' end)\n"
+		"c = callbacks:add('test', function() order = order .. 'c' end)\n"
+	);
+
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	TEST_PROGRAM("assert(order == 'acac')");
+
+	TEST_PROGRAM(
+		"stats = callbacks:stats().test\n"
+		"assert(stats.triggers == 2)\n"
+		"assert(stats.calls == 4)\n"
+		"assert(stats.time >= 0)"
+	);
+
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(callbackProfile) {
+	SETUP_LUA;
+
+	TEST_PROGRAM(
+		"order = ''\n"
+		"function busy()\n"
+		"	local x = 0\n"
+		"	for i = 1, 100000 do x = x + i end\n"
+		"	return x\n"
+		"end\n"
+		"a = callbacks:add('test', function() order = order .. 'a' busy() end)\n"
+		"b = callbacks:add('test', function() order = order .. 'b' end)\n"
+		"callbacks:setProfiling(true)\n"
+	);
+
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	TEST_PROGRAM(
+		"profile = callbacks:profile()\n"
+		"assert(profile.callbacks[a].callback == 'test')\n"
+		"assert(profile.callbacks[a].calls == 1)\n"
+		"assert(profile.callbacks[b].calls == 1)\n"
+		"assert(next(profile.functions))\n"
+	);
+
+	// Any nonzero time overruns the smallest possible budget
+	mScriptContextSetFrameBudget(&context, 1, true);
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	TEST_PROGRAM("assert(order == 'aba')");
+	TEST_PROGRAM("assert(callbacks:profile().callbacks[b].deferred == 1)");
+
+	// The skipped callback runs first on the next frame, even over budget
+	mScriptContextStartFrame(&context);
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	TEST_PROGRAM("assert(order:sub(1, 4) == 'abab')");
+	TEST_PROGRAM("assert(callbacks:profile().callbacks[b].calls == 2)");
+
+	mScriptContextStartFrame(&context);
+	TEST_PROGRAM("callbacks:setFrameBudget(0)");
+	TEST_PROGRAM("order = ''");
+	mScriptContextTriggerCallback(&context, "test", NULL);
+	TEST_PROGRAM("assert(order == 'ab')");
+
+	mScriptContextDeinit(&context);
+}
+
 static void _tableIncrement(struct mScriptValue* table) {
 	assert_non_null(table);
 	struct mScriptValue* value = mScriptTableLookup(table, &mSCRIPT_MAKE_CHARP("key"));
@@ -262,6 +331,8 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStdlib,
 	cmocka_unit_test(bitUnmask),
 	cmocka_unit_test(callbacks),
 	cmocka_unit_test(oneshot),
+	cmocka_unit_test(callbackRemoveDuringTrigger),
+	cmocka_unit_test(callbackProfile),
 	cmocka_unit_test(callbackWeakref),
 	cmocka_unit_test(rectangle),
 	cmocka_unit_test(size),
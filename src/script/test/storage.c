@@ -18,8 +18,17 @@
 	mScriptContextAttachStorage(&context); \
 	char bucketPath[PATH_MAX]; \
 	mScriptStorageGetBucketPath("xtest", bucketPath); \
+	remove(bucketPath); \
+	mScriptStorageGetBucketBinaryPath("xtest", bucketPath); \
 	remove(bucketPath)
 
+#define RESTART_LUA \
+	mScriptContextDeinit(&context); \
+	mScriptContextInit(&context); \
+	lua = mScriptContextRegisterEngine(&context, mSCRIPT_ENGINE_LUA); \
+	mScriptContextAttachStdlib(&context); \
+	mScriptContextAttachStorage(&context)
+
 M_TEST_SUITE_SETUP(mScriptStorage) {
 	if (mSCRIPT_ENGINE_LUA->init) {
 		mSCRIPT_ENGINE_LUA->init(mSCRIPT_ENGINE_LUA);
@@ -551,6 +560,45 @@ M_TEST_DEFINE(autoflush) {
 	mScriptContextDeinit(&context);
 }
 
+M_TEST_DEFINE(persistence) {
+	SETUP_LUA;
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("bucket.a = 1");
+	TEST_PROGRAM("bucket.b = { ['c'] = 'd' }");
+	TEST_PROGRAM("assert(bucket:flush())");
+	TEST_PROGRAM("bucket.a = 2");
+	TEST_PROGRAM("assert(bucket:flush())");
+
+	RESTART_LUA;
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("assert(bucket.a == 2)");
+	TEST_PROGRAM("assert(bucket.b.c == 'd')");
+
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(tornWrite) {
+	SETUP_LUA;
+
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("bucket.a = 1");
+	TEST_PROGRAM("assert(bucket:flush())");
+
+	static const char garbage[] = { 0x20, 0, 0, 0, 'x', 'x' };
+	struct VFile* vf = VFileOpen(bucketPath, O_WRONLY);
+	assert_non_null(vf);
+	vf->seek(vf, 0, SEEK_END);
+	vf->write(vf, garbage, sizeof(garbage));
+	vf->close(vf);
+
+	RESTART_LUA;
+	TEST_PROGRAM("bucket = storage:getBucket('xtest')");
+	TEST_PROGRAM("assert(bucket.a == 1)");
+
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStorage,
 	cmocka_unit_test(basicInt),
 	cmocka_unit_test(basicFloat),
@@ -581,4 +629,6 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptStorage,
 	cmocka_unit_test(deserializeError),
 	cmocka_unit_test(structuredRoundTrip),
 	cmocka_unit_test(autoflush),
+	cmocka_unit_test(persistence),
+	cmocka_unit_test(tornWrite),
 )
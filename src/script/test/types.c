@@ -1363,6 +1363,65 @@ M_TEST_DEFINE(lambda0) {
 	mScriptValueDeref(fn);
 }
 
+M_TEST_DEFINE(valuePool) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+
+	struct mScriptValue* value = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	assert_true(mScriptContextActivate(&context));
+	mScriptValueDeref(value);
+	assert_int_equal(context.pool.count[0], 2);
+
+	// Freed blocks are handed back out while the context is active
+	struct mScriptValue* list = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	assert_ptr_equal(list, value);
+	assert_int_equal(context.pool.count[0], 0);
+	struct mScriptValue* table = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+	mScriptValueWrap(table, mScriptListAppend(list->value.list));
+	mScriptValueDeref(list);
+	assert_int_equal(context.pool.count[0], 3);
+	assert_int_equal(context.pool.count[2], 1);
+	mScriptContextDeactivate(&context);
+
+	// Without an active context, blocks go back to the heap
+	value = mScriptValueAlloc(mSCRIPT_TYPE_MS_S32);
+	mScriptValueDeref(value);
+	assert_int_equal(context.pool.count[0], 3);
+
+	mScriptContextDeinit(&context);
+}
+
+M_TEST_DEFINE(poolSizeClasses) {
+	struct mScriptContext context;
+	mScriptContextInit(&context);
+	assert_true(mScriptContextActivate(&context));
+
+	// Sizes are rounded up to the next power of two
+	void* block = mScriptPoolAlloc(33);
+	mScriptPoolFree(block, 33);
+	assert_int_equal(context.pool.count[0], 0);
+	assert_int_equal(context.pool.count[1], 1);
+	assert_ptr_equal(mScriptPoolAlloc(64), block);
+	assert_int_equal(context.pool.count[1], 0);
+	mScriptPoolFree(block, 64);
+	assert_ptr_equal(mScriptPoolAlloc(48), block);
+	mScriptPoolFree(block, 48);
+
+	block = mScriptPoolAlloc(1);
+	mScriptPoolFree(block, 1);
+	assert_int_equal(context.pool.count[0], 1);
+	assert_ptr_equal(mScriptPoolAlloc(mSCRIPT_POOL_MIN_SIZE), block);
+	mScriptPoolFree(block, mSCRIPT_POOL_MIN_SIZE);
+
+	// Anything past the largest class goes straight to the heap
+	block = mScriptPoolAlloc(mSCRIPT_POOL_MIN_SIZE << mSCRIPT_POOL_CLASSES);
+	mScriptPoolFree(block, mSCRIPT_POOL_MIN_SIZE << mSCRIPT_POOL_CLASSES);
+	assert_int_equal(context.pool.count[mSCRIPT_POOL_CLASSES - 1], 0);
+
+	mScriptContextDeactivate(&context);
+	mScriptContextDeinit(&context);
+}
+
 M_TEST_SUITE_DEFINE(mScript,
 	cmocka_unit_test(voidArgs),
 	cmocka_unit_test(voidFunc),
@@ -1401,4 +1460,6 @@ M_TEST_SUITE_DEFINE(mScript,
 	cmocka_unit_test(nullString),
 	cmocka_unit_test(nullStruct),
 	cmocka_unit_test(lambda0),
+	cmocka_unit_test(valuePool),
+	cmocka_unit_test(poolSizeClasses),
 )
@@ -11,6 +11,7 @@
 #include <mgba-util/hash.h>
 #include <mgba-util/string.h>
 #include <mgba-util/table.h>
+#include <mgba-util/threading.h>
 
 struct mScriptLambda {
 	struct mScriptValue* fn;
@@ -304,7 +305,7 @@ struct mScriptValue mScriptValueNull = {
 DEFINE_VECTOR(mScriptList, struct mScriptValue)
 
 void _allocList(struct mScriptValue* val) {
-	val->value.list = malloc(sizeof(struct mScriptList));
+	val->value.list = mScriptPoolAlloc(sizeof(struct mScriptList));
 	mScriptListInit(val->value.list, 0);
 }
 
@@ -321,11 +322,11 @@ void _freeList(struct mScriptValue* val) {
 		}
 	}
 	mScriptListDeinit(val->value.list);
-	free(val->value.list);
+	mScriptPoolFree(val->value.list, sizeof(struct mScriptList));
 }
 
 void _allocTable(struct mScriptValue* val) {
-	val->value.table = malloc(sizeof(struct Table));
+	val->value.table = mScriptPoolAlloc(sizeof(struct Table));
 	struct TableFunctions funcs = {
 		.deinitializer = _deinitTableValue,
 		.hash = _valHash,
@@ -338,7 +339,7 @@ void _allocTable(struct mScriptValue* val) {
 
 void _freeTable(struct mScriptValue* val) {
 	HashTableDeinit(val->value.table);
-	free(val->value.table);
+	mScriptPoolFree(val->value.table, sizeof(struct Table));
 }
 
 void _deinitTableValue(void* val) {
@@ -881,8 +882,7 @@ void _lambdaFree(struct mScriptValue* value) {
 }
 
 struct mScriptValue* mScriptValueAlloc(const struct mScriptType* type) {
-	// TODO: Use an arena instead of just the generic heap
-	struct mScriptValue* val = malloc(sizeof(*val));
+	struct mScriptValue* val = mScriptPoolAlloc(sizeof(*val));
 	val->refs = 1;
 	val->type = type;
 	val->flags = 0;
@@ -914,7 +914,7 @@ void mScriptValueDeref(struct mScriptValue* val) {
 	} else if (val->flags & mSCRIPT_VALUE_FLAG_FREE_BUFFER) {
 		free(val->value.opaque);
 	}
-	free(val);
+	mScriptPoolFree(val, sizeof(*val));
 }
 
 void mScriptValueWrap(struct mScriptValue* value, struct mScriptValue* out) {
@@ -1163,6 +1163,44 @@ bool _callLambda0(struct mScriptFrame* frame, void* context) {
 	return ok;
 }
 
+// Classes are shared between all contexts, so contexts running on separate
+// threads may race to initialize the same class
+#ifdef USE_PTHREADS
+static Mutex _classInitMutex;
+static pthread_once_t _classInitOnce = PTHREAD_ONCE_INIT;
+
+static void _createClassInitMutex(void) {
+	MutexInit(&_classInitMutex);
+}
+#elif defined(_WIN32)
+static Mutex _classInitMutex;
+static INIT_ONCE _classInitOnce = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK _createClassInitMutex(PINIT_ONCE once, PVOID param, PVOID* context) {
+	UNUSED(once);
+	UNUSED(param);
+	UNUSED(context);
+	MutexInit(&_classInitMutex);
+	return TRUE;
+}
+#endif
+
+static void _lockClassInit(void) {
+#ifdef USE_PTHREADS
+	pthread_once(&_classInitOnce, _createClassInitMutex);
+	MutexLock(&_classInitMutex);
+#elif defined(_WIN32)
+	InitOnceExecuteOnce(&_classInitOnce, _createClassInitMutex, NULL, 0);
+	MutexLock(&_classInitMutex);
+#endif
+}
+
+static void _unlockClassInit(void) {
+#if defined(USE_PTHREADS) || defined(_WIN32)
+	MutexUnlock(&_classInitMutex);
+#endif
+}
+
 static void _mScriptClassInit(struct mScriptTypeClass* cls, const struct mScriptClassInitDetails* details, bool child) {
 	const char* docstring = NULL;
 
@@ -1246,8 +1284,24 @@ static void _mScriptClassInit(struct mScriptTypeClass* cls, const struct mScript
 	}
 }
 
+static void _mScriptClassAssignSlot(const char* key, void* value, void* user) {
+	UNUSED(key);
+	struct mScriptTypeClass* cls = user;
+	struct mScriptClassMember* member = value;
+	member->slot = cls->nSlots;
+	cls->slots[cls->nSlots] = member;
+	++cls->nSlots;
+}
+
 void mScriptClassInit(struct mScriptTypeClass* cls) {
+	bool init;
+	ATOMIC_LOAD(init, cls->init);
+	if (init) {
+		return;
+	}
+	_lockClassInit();
 	if (cls->init) {
+		_unlockClassInit();
 		return;
 	}
 	HashTableInit(&cls->instanceMembers, 0, free);
@@ -1259,7 +1313,12 @@ void mScriptClassInit(struct mScriptTypeClass* cls) {
 	cls->get = NULL;
 	_mScriptClassInit(cls, cls->details, false);
 
-	cls->init = true;
+	cls->slots = calloc(HashTableSize(&cls->instanceMembers), sizeof(*cls->slots));
+	cls->nSlots = 0;
+	HashTableEnumerate(&cls->instanceMembers, _mScriptClassAssignSlot, cls);
+
+	ATOMIC_STORE(cls->init, true);
+	_unlockClassInit();
 }
 
 void mScriptClassDeinit(struct mScriptTypeClass* cls) {
@@ -1269,6 +1328,9 @@ void mScriptClassDeinit(struct mScriptTypeClass* cls) {
 	HashTableDeinit(&cls->instanceMembers);
 	HashTableDeinit(&cls->castToMembers);
 	HashTableDeinit(&cls->setters);
+	free(cls->slots);
+	cls->slots = NULL;
+	cls->nSlots = 0;
 	cls->init = false;
 }
 
@@ -1415,6 +1477,35 @@ bool mScriptObjectGet(struct mScriptValue* obj, const char* member, struct mScri
 	return _accessRawMember(m, obj->value.opaque, obj->type->isConst, val);
 }
 
+int mScriptClassGetSlot(struct mScriptTypeClass* cls, const char* member) {
+	mScriptClassInit(cls);
+	struct mScriptClassMember* m = HashTableLookup(&cls->instanceMembers, member);
+	if (!m) {
+		return -1;
+	}
+	return m->slot;
+}
+
+bool mScriptObjectGetSlot(struct mScriptValue* obj, int slot, struct mScriptValue* val) {
+	if (obj->type->base == mSCRIPT_TYPE_WRAPPER) {
+		obj = mScriptValueUnwrap(obj);
+	}
+	if (obj->type->base != mSCRIPT_TYPE_OBJECT) {
+		return false;
+	}
+
+	struct mScriptTypeClass* cls = obj->type->details.cls;
+	if (!cls) {
+		return false;
+	}
+
+	mScriptClassInit(cls);
+	if (slot < 0 || (size_t) slot >= cls->nSlots) {
+		return false;
+	}
+	return _accessRawMember(cls->slots[slot], obj->value.opaque, obj->type->isConst, val);
+}
+
 bool mScriptObjectGetConst(const struct mScriptValue* obj, const char* member, struct mScriptValue* val) {
 	if (obj->type->base == mSCRIPT_TYPE_WRAPPER) {
 		obj = mScriptValueUnwrapConst(obj);
@@ -0,0 +1,75 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/state-journal.h>
+#include <mgba-util/vfs.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void _usage(const char* arg0) {
+	fprintf(stderr, "usage: %s JOURNAL [INDEX OUTPUT]\n", arg0);
+	fprintf(stderr, "Lists the checkpoints in a savestate journal, or extracts checkpoint INDEX\n");
+	fprintf(stderr, "to OUTPUT as a normal savestate. Negative indices count from the end.\n");
+}
+
+int main(int argc, char* argv[]) {
+	if (argc != 2 && argc != 4) {
+		_usage(argv[0]);
+		return 1;
+	}
+
+	struct VFile* vf = VFileOpen(argv[1], O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		return 1;
+	}
+	struct mStateJournal journal;
+	if (!mStateJournalOpen(&journal, vf)) {
+		fprintf(stderr, "%s is not a savestate journal\n", argv[1]);
+		vf->close(vf);
+		return 1;
+	}
+
+	int status = 0;
+	size_t count = mStateJournalCount(&journal);
+	if (argc == 2) {
+		size_t i;
+		for (i = 0; i < count; ++i) {
+			const struct mStateJournalEntry* entry = mStateJournalEntryListGetConstPointer(&journal.entries, i);
+			if (entry->base == i) {
+				printf("%zu\t%u bytes\tfull\n", i, entry->size);
+			} else {
+				printf("%zu\t%u bytes\tdiff from %u\n", i, entry->size, entry->base);
+			}
+		}
+	} else {
+		char* end;
+		errno = 0;
+		long index = strtol(argv[2], &end, 10);
+		if (index < 0) {
+			index += count;
+		}
+		struct VFile* out = NULL;
+		if (errno || *end || index < 0 || (size_t) index >= count) {
+			fprintf(stderr, "Invalid checkpoint %s (journal has %zu)\n", argv[2], count);
+			status = 1;
+		} else if (!(out = VFileOpen(argv[3], O_WRONLY | O_CREAT | O_TRUNC))) {
+			fprintf(stderr, "Could not open %s\n", argv[3]);
+			status = 1;
+		} else if (!mStateJournalExtract(&journal, index, out)) {
+			fprintf(stderr, "Could not extract checkpoint %li\n", index);
+			status = 1;
+		}
+		if (out) {
+			out->close(out);
+		}
+	}
+
+	mStateJournalClose(&journal);
+	vf->close(vf);
+	return status;
+}
@@ -0,0 +1,147 @@
+/* Copyright (c) 2013-2026 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/feature/movie.h>
+#include <mgba-util/crc32.h>
+#include <mgba-util/vfs.h>
+
+#ifdef _MSC_VER
+#include <mgba-util/platform/windows/getopt.h>
+#else
+#include <getopt.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void _usage(const char* arg0) {
+	fprintf(stderr, "usage: %s [-f FRAME] [-H CRC32] ROM MOVIE\n", arg0);
+	fprintf(stderr, "Replays a movie without video and prints a CRC32 of the game's RAM.\n");
+	fprintf(stderr, "  -f FRAME   Stop at FRAME instead of the end of the movie\n");
+	fprintf(stderr, "  -H CRC32   Exit with an error unless the RAM CRC32 matches\n");
+}
+
+static void _log(struct mLogger* logger, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(logger);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
+
+static uint32_t _hashRAM(struct mCore* core) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	uint32_t hash = 0;
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if ((blocks[i].flags & (mCORE_MEMORY_RW | mCORE_MEMORY_WORM | mCORE_MEMORY_VIRTUAL)) != mCORE_MEMORY_RW) {
+			continue;
+		}
+		size_t size;
+		void* data = core->getMemoryBlock(core, blocks[i].id, &size);
+		if (data) {
+			hash = crc32(hash, data, size);
+		}
+	}
+	return hash;
+}
+
+int main(int argc, char* argv[]) {
+	long stopFrame = -1;
+	unsigned long expected = 0;
+	bool check = false;
+	char* end;
+	int ch;
+	while ((ch = getopt(argc, argv, "f:H:")) != -1) {
+		errno = 0;
+		switch (ch) {
+		case 'f':
+			stopFrame = strtol(optarg, &end, 10);
+			if (errno || *end || stopFrame < 0) {
+				_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'H':
+			expected = strtoul(optarg, &end, 16);
+			if (errno || *end) {
+				_usage(argv[0]);
+				return 1;
+			}
+			check = true;
+			break;
+		default:
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (argc - optind != 2) {
+		_usage(argv[0]);
+		return 1;
+	}
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	struct mCore* core = mCoreFind(argv[optind]);
+	if (!core) {
+		fprintf(stderr, "Could not load %s\n", argv[optind]);
+		return 1;
+	}
+	// No video buffer is set, so the core skips rendering entirely
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	if (!mCoreLoadFile(core, argv[optind])) {
+		fprintf(stderr, "Could not load %s\n", argv[optind]);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+		return 1;
+	}
+	core->reset(core);
+
+	int status = 1;
+	struct mMovie movie;
+	mMovieInit(&movie);
+	struct VFile* vf = VFileOpen(argv[optind + 1], O_RDONLY);
+	if (!vf || !mMovieLoad(&movie, vf)) {
+		fprintf(stderr, "Could not load movie %s\n", argv[optind + 1]);
+		goto cleanup;
+	}
+	mMovieAttach(&movie, core);
+	if (!mMoviePlay(&movie)) {
+		fprintf(stderr, "Movie %s was not recorded with this game\n", argv[optind + 1]);
+		goto cleanup;
+	}
+
+	size_t frames = mMovieFrameCount(&movie);
+	if (stopFrame < 0 || (size_t) stopFrame > frames) {
+		stopFrame = frames;
+	}
+	// Replay everything from the first keyframe, rather than seeking, so
+	// a desync anywhere in the movie changes the result
+	while (movie.frame < (uint32_t) stopFrame) {
+		core->runFrame(core);
+	}
+
+	uint32_t hash = _hashRAM(core);
+	printf("frame %li\tRAM CRC32 %08X\n", stopFrame, hash);
+	status = check && hash != expected;
+
+cleanup:
+	mMovieStop(&movie);
+	if (vf) {
+		vf->close(vf);
+	}
+	core->unloadROM(core);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	mMovieDeinit(&movie);
+	return status;
+}
@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba-util/image.h>
 
+#include <mgba-util/crc32.h>
 #include <mgba-util/geometry.h>
 #include <mgba-util/image/png-io.h>
 #include <mgba-util/vfs.h>
@@ -446,7 +447,9 @@ void mImageSetPaletteEntry(struct mImage* image, unsigned index, uint32_t color)
 	image->palette[index] = color;
 }
 
-#define COMPOSITE_BOUNDS_INIT(SOURCE, DEST) \
+#define COMPOSITE_BOUNDS_INIT(SOURCE, DEST) COMPOSITE_BOUNDS_INIT_OR_RETURN(SOURCE, DEST, )
+
+#define COMPOSITE_BOUNDS_INIT_OR_RETURN(SOURCE, DEST, RETURN) \
 	struct mRectangle dstRect = { \
 		.x = 0, \
 		.y = 0, \
@@ -460,7 +463,7 @@ void mImageSetPaletteEntry(struct mImage* image, unsigned index, uint32_t color)
 		.height = (SOURCE)->height \
 	}; \
 	if (!mRectangleIntersection(&srcRect, &dstRect)) { \
-		return; \
+		return RETURN; \
 	} \
 	int srcStartX; \
 	int srcStartY; \
@@ -481,6 +484,39 @@ void mImageSetPaletteEntry(struct mImage* image, unsigned index, uint32_t color)
 		dstStartY = srcRect.y; \
 	}
 
+#define ORDER_RGB8 (mCOLOR_XRGB8 | mCOLOR_ARGB8)
+#define ORDER_BGR8 (mCOLOR_XBGR8 | mCOLOR_ABGR8)
+
+// Formats with the alpha (or unused) byte on top and the same channel order
+// only differ in that byte, so pixels can be moved between them as words
+static bool _sameOrder32(enum mColorFormat a, enum mColorFormat b) {
+	return ((a & ORDER_RGB8) && (b & ORDER_RGB8)) || ((a & ORDER_BGR8) && (b & ORDER_BGR8));
+}
+
+// Blend onto an opaque pixel, dividing each channel by 255 exactly as
+// mColorMixARGB8 does, but with two channels per multiply
+static inline uint32_t _blendOpaque(uint32_t color, uint32_t dest, uint32_t alpha) {
+	uint32_t rb = (color & 0x00FF00FF) * alpha + (dest & 0x00FF00FF) * (0xFF - alpha);
+	uint32_t g = ((color >> 8) & 0xFF) * alpha + ((dest >> 8) & 0xFF) * (0xFF - alpha);
+	rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	g = ((g + 1 + (g >> 8)) >> 8) & 0xFF;
+	return 0xFF000000 | rb | (g << 8);
+}
+
+static inline uint32_t _compositePixel(uint32_t color, uint32_t dest) {
+	uint32_t alpha = color >> 24;
+	if (alpha == 0xFF) {
+		return color;
+	}
+	if (!alpha) {
+		return dest;
+	}
+	if (dest >= 0xFF000000) {
+		return _blendOpaque(color, dest, alpha);
+	}
+	return mColorMixARGB8(color, dest);
+}
+
 void mImageBlit(struct mImage* image, const struct mImage* source, int x, int y) {
 	if (image->format == mCOLOR_PAL8) {
 		// Can't blit to paletted image
@@ -489,6 +525,29 @@ void mImageBlit(struct mImage* image, const struct mImage* source, int x, int y)
 
 	COMPOSITE_BOUNDS_INIT(source, image);
 
+	if (source->format == image->format) {
+		// Blitting within one image can overlap, so copy the rows in an order
+		// that doesn't overwrite any that haven't been read yet
+		bool reverse = source->data == image->data && dstStartY > srcStartY;
+		for (y = 0; y < srcRect.height; ++y) {
+			int row = reverse ? srcRect.height - y - 1 : y;
+			memmove(PIXEL(image, dstStartX, dstStartY + row), PIXEL(source, srcStartX, srcStartY + row), srcRect.width * image->depth);
+		}
+		return;
+	}
+	if (_sameOrder32(source->format, image->format)) {
+		// Only the top byte differs, and converting between different formats
+		// always makes it opaque
+		for (y = 0; y < srcRect.height; ++y) {
+			const uint32_t* srcPixel = PIXEL(source, srcStartX, srcStartY + y);
+			uint32_t* dstPixel = PIXEL(image, dstStartX, dstStartY + y);
+			for (x = 0; x < srcRect.width; ++x) {
+				dstPixel[x] = srcPixel[x] | 0xFF000000;
+			}
+		}
+		return;
+	}
+
 	for (y = 0; y < srcRect.height; ++y) {
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
 		uintptr_t dstPixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
@@ -514,6 +573,18 @@ void mImageComposite(struct mImage* image, const struct mImage* source, int x, i
 
 	COMPOSITE_BOUNDS_INIT(source, image);
 
+	if (_sameOrder32(source->format, image->format)) {
+		uint32_t destForce = mColorFormatHasAlpha(image->format) ? 0 : 0xFF000000;
+		for (y = 0; y < srcRect.height; ++y) {
+			const uint32_t* srcPixel = PIXEL(source, srcStartX, srcStartY + y);
+			uint32_t* dstPixel = PIXEL(image, dstStartX, dstStartY + y);
+			for (x = 0; x < srcRect.width; ++x) {
+				dstPixel[x] = _compositePixel(srcPixel[x], dstPixel[x] | destForce) | destForce;
+			}
+		}
+		return;
+	}
+
 	for (y = 0; y < srcRect.height; ++y) {
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
 		uintptr_t dstPixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
@@ -553,6 +624,25 @@ void mImageCompositeWithAlpha(struct mImage* image, const struct mImage* source,
 
 	int fixedAlpha = alpha * 0x200;
 
+	if (_sameOrder32(source->format, image->format)) {
+		uint32_t srcForce = mColorFormatHasAlpha(source->format) ? 0 : 0xFF000000;
+		uint32_t destForce = mColorFormatHasAlpha(image->format) ? 0 : 0xFF000000;
+		for (y = 0; y < srcRect.height; ++y) {
+			const uint32_t* srcPixel = PIXEL(source, srcStartX, srcStartY + y);
+			uint32_t* dstPixel = PIXEL(image, dstStartX, dstStartY + y);
+			for (x = 0; x < srcRect.width; ++x) {
+				uint32_t color = srcPixel[x] | srcForce;
+				uint32_t alpha = ((color >> 24) * fixedAlpha) >> 9;
+				if (alpha > 0xFF) {
+					alpha = 0xFF;
+				}
+				color = (color & 0x00FFFFFF) | (alpha << 24);
+				dstPixel[x] = _compositePixel(color, dstPixel[x] | destForce) | destForce;
+			}
+		}
+		return;
+	}
+
 	for (y = 0; y < srcRect.height; ++y) {
 		uintptr_t srcPixel = (uintptr_t) PIXEL(source, srcStartX, srcStartY + y);
 		uintptr_t dstPixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
@@ -578,6 +668,101 @@ void mImageCompositeWithAlpha(struct mImage* image, const struct mImage* source,
 	}
 }
 
+uint32_t mImageHashRegion(const struct mImage* image, int x, int y, int width, int height) {
+	struct mRectangle rect = {
+		.x = x,
+		.y = y,
+		.width = width > 0 ? width : (int) image->width - x,
+		.height = height > 0 ? height : (int) image->height - y
+	};
+	struct mRectangle bounds = {
+		.x = 0,
+		.y = 0,
+		.width = image->width,
+		.height = image->height
+	};
+	if (rect.width <= 0 || rect.height <= 0 || !mRectangleIntersection(&rect, &bounds)) {
+		return 0;
+	}
+
+	uint32_t xMask = 0;
+	switch (image->format) {
+	case mCOLOR_XBGR8:
+	case mCOLOR_XRGB8:
+		xMask = 0x00FFFFFF;
+		break;
+	case mCOLOR_BGRX8:
+	case mCOLOR_RGBX8:
+		xMask = 0xFFFFFF00;
+		break;
+	default:
+		break;
+	}
+
+	uint32_t hash = 0;
+	for (y = 0; y < rect.height; ++y) {
+		const void* row = PIXEL(image, rect.x, rect.y + y);
+		if (!xMask) {
+			hash = crc32(hash, row, rect.width * image->depth);
+			continue;
+		}
+		// The unused byte isn't guaranteed to be consistent, so leave it out
+		uint32_t buffer[256];
+		const uint32_t* pixel = row;
+		for (x = 0; x < rect.width; x += 256) {
+			int chunk = rect.width - x < 256 ? rect.width - x : 256;
+			int i;
+			for (i = 0; i < chunk; ++i) {
+				buffer[i] = pixel[x + i] & xMask;
+			}
+			hash = crc32(hash, (const void*) buffer, chunk * sizeof(*buffer));
+		}
+	}
+	return hash;
+}
+
+unsigned mImageCompare(const struct mImage* image, const struct mImage* other, int x, int y) {
+	COMPOSITE_BOUNDS_INIT_OR_RETURN(other, image, 0);
+
+	// Transparent pixels in the other image match anything, and the alpha of
+	// the remaining pixels is ignored
+	bool skipTransparent = mColorFormatHasAlpha(other->format);
+	unsigned differences = 0;
+	if (_sameOrder32(other->format, image->format)) {
+		for (y = 0; y < srcRect.height; ++y) {
+			const uint32_t* otherPixel = PIXEL(other, srcStartX, srcStartY + y);
+			const uint32_t* pixel = PIXEL(image, dstStartX, dstStartY + y);
+			if (other->format == image->format && memcmp(pixel, otherPixel, srcRect.width * 4) == 0) {
+				continue;
+			}
+			for (x = 0; x < srcRect.width; ++x) {
+				if (skipTransparent && otherPixel[x] < 0x01000000) {
+					continue;
+				}
+				differences += ((pixel[x] ^ otherPixel[x]) & 0x00FFFFFF) != 0;
+			}
+		}
+		return differences;
+	}
+
+	for (y = 0; y < srcRect.height; ++y) {
+		uintptr_t otherPixel = (uintptr_t) PIXEL(other, srcStartX, srcStartY + y);
+		uintptr_t pixel = (uintptr_t) PIXEL(image, dstStartX, dstStartY + y);
+		for (x = 0; x < srcRect.width; ++x, otherPixel += other->depth, pixel += image->depth) {
+			uint32_t color, colorB;
+			GET_PIXEL(colorB, otherPixel, other->depth);
+			colorB = mImageColorConvert(colorB, other, mCOLOR_ARGB8);
+			if (skipTransparent && colorB < 0x01000000) {
+				continue;
+			}
+			GET_PIXEL(color, pixel, image->depth);
+			color = mImageColorConvert(color, image, mCOLOR_ARGB8);
+			differences += ((color ^ colorB) & 0x00FFFFFF) != 0;
+		}
+	}
+	return differences;
+}
+
 #define FILL_BOUNDS_INIT(X, Y, W, H) \
 	struct mRectangle dstRect = { \
 		.x = 0, \
@@ -624,12 +809,42 @@ static void mPainterFillRectangle(struct mPainter* painter, int x, int y, int wi
 
 	if (!painter->blend || painter->fillColor >= 0xFF000000) {
 		uint32_t color = mColorConvert(painter->fillColor, mCOLOR_ARGB8, painter->backing->format);
+		switch (painter->backing->depth) {
+		case 4:
+			for (y = 0; y < srcRect.height; ++y) {
+				uint32_t* dstPixel = PIXEL(painter->backing, dstStartX, dstStartY + y);
+				for (x = 0; x < srcRect.width; ++x) {
+					dstPixel[x] = color;
+				}
+			}
+			return;
+		case 2:
+			for (y = 0; y < srcRect.height; ++y) {
+				uint16_t* dstPixel = PIXEL(painter->backing, dstStartX, dstStartY + y);
+				for (x = 0; x < srcRect.width; ++x) {
+					dstPixel[x] = color;
+				}
+			}
+			return;
+		}
 		for (y = 0; y < srcRect.height; ++y) {
 			uintptr_t dstPixel = (uintptr_t) PIXEL(painter->backing, dstStartX, dstStartY + y);
 			for (x = 0; x < srcRect.width; ++x, dstPixel += painter->backing->depth) {
 				PUT_PIXEL(color, dstPixel, painter->backing->depth);
 			}
 		}
+	} else if (painter->backing->format & (ORDER_RGB8 | ORDER_BGR8)) {
+		uint32_t color = painter->fillColor;
+		if (painter->backing->format & ORDER_BGR8) {
+			color = mColorConvert(color, mCOLOR_ARGB8, mCOLOR_ABGR8);
+		}
+		uint32_t destForce = mColorFormatHasAlpha(painter->backing->format) ? 0 : 0xFF000000;
+		for (y = 0; y < srcRect.height; ++y) {
+			uint32_t* dstPixel = PIXEL(painter->backing, dstStartX, dstStartY + y);
+			for (x = 0; x < srcRect.width; ++x) {
+				dstPixel[x] = _compositePixel(color, dstPixel[x] | destForce) | destForce;
+			}
+		}
 	} else {
 		for (y = 0; y < srcRect.height; ++y) {
 			uintptr_t dstPixel = (uintptr_t) PIXEL(painter->backing, dstStartX, dstStartY + y);
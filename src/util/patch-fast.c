@@ -22,8 +22,12 @@ void deinitPatchFast(struct PatchFast* patch) {
 
 bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t size) {
 	PatchFastExtentsClear(&patch->extents);
-	const uint32_t* iptr = in;
-	const uint32_t* optr = out;
+	return diffPatchFastRange(patch, in, out, 0, size);
+}
+
+bool diffPatchFastRange(struct PatchFast* patch, const void* restrict in, const void* restrict out, size_t offset, size_t size) {
+	const uint32_t* iptr = (const uint32_t*) ((const uint8_t*) in + offset);
+	const uint32_t* optr = (const uint32_t*) ((const uint8_t*) out + offset);
 	size_t extentOff = 0;
 	struct PatchFastExtent* extent = NULL;
 	size_t off;
@@ -37,7 +41,7 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 		if (a | b | c | d) {
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
-				extent->offset = off;
+				extent->offset = offset + off;
 				extentOff = 0;
 			}
 			extent->extent[extentOff] = a;
@@ -58,8 +62,8 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 		extent->length = extentOff * 4;
 		extent = NULL;
 	}
-	const uint32_t* iptr8 = iptr;
-	const uint32_t* optr8 = optr;
+	const uint8_t* iptr8 = (const uint8_t*) iptr;
+	const uint8_t* optr8 = (const uint8_t*) optr;
 	for (; off < size; ++off) {
 		uint8_t a = iptr8[0] ^ optr8[0];
 		++iptr8;
@@ -67,7 +71,8 @@ bool diffPatchFast(struct PatchFast* patch, const void* restrict in, const void*
 		if (a) {
 			if (!extent) {
 				extent = PatchFastExtentsAppend(&patch->extents);
-				extent->offset = off;
+				extent->offset = offset + off;
+				extentOff = 0;
 			}
 			((uint8_t*) extent->extent)[extentOff] = a;
 			++extentOff;
@@ -94,19 +99,17 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 	if (inSize != outSize) {
 		return false;
 	}
-	const uint32_t* iptr = in;
-	uint32_t* optr = out;
 	size_t lastWritten = 0;
 	size_t s;
 	for (s = 0; s < PatchFastExtentsSize(&patch->extents); ++s) {
 		struct PatchFastExtent* extent = PatchFastExtentsGetPointer(&patch->extents, s);
-		if (extent->length + extent->offset > outSize) {
+		if (extent->length + extent->offset > outSize || extent->offset < lastWritten) {
 			return false;
 		}
-		memcpy(optr, iptr, extent->offset - lastWritten);
-		optr = (uint32_t*) out + extent->offset / 4;
-		iptr = (uint32_t*) in + extent->offset / 4;
-		uint32_t* eptr = extent->extent;
+		memcpy((uint8_t*) out + lastWritten, (const uint8_t*) in + lastWritten, extent->offset - lastWritten);
+		uint32_t* optr = (uint32_t*) ((uint8_t*) out + extent->offset);
+		const uint32_t* iptr = (const uint32_t*) ((const uint8_t*) in + extent->offset);
+		const uint32_t* eptr = extent->extent;
 		size_t off;
 		for (off = 0; off < (extent->length & ~15); off += 16) {
 			optr[0] = iptr[0] ^ eptr[0];
@@ -117,14 +120,17 @@ bool _fastApplyPatch(struct Patch* p, const void* in, size_t inSize, void* out,
 			iptr += 4;
 			eptr += 4;
 		}
+		uint8_t* optr8 = (uint8_t*) optr;
+		const uint8_t* iptr8 = (const uint8_t*) iptr;
+		const uint8_t* eptr8 = (const uint8_t*) eptr;
 		for (; off < extent->length; ++off) {
-			*(uint8_t*) optr = *(uint8_t*) iptr ^ *(uint8_t*) eptr;
-			++optr;
-			++iptr;
-			++eptr;
+			*optr8 = *iptr8 ^ *eptr8;
+			++optr8;
+			++iptr8;
+			++eptr8;
 		}
 		lastWritten = extent->offset + off;
 	}
-	memcpy(optr, iptr, outSize - lastWritten);
+	memcpy((uint8_t*) out + lastWritten, (const uint8_t*) in + lastWritten, outSize - lastWritten);
 	return true;
 }
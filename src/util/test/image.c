@@ -1182,6 +1182,108 @@ M_TEST_DEFINE(blitBoundaries) {
 	         0xFF000000 | (AB), 0xFF000000 | (BB), 0xFF000000 | (CB), \
 	         0xFF000000 | (AC), 0xFF000000 | (BC), 0xFF000000 | (CC))
 
+M_TEST_DEFINE(blitSelf) {
+	static const enum mColorFormat formats[] = { mCOLOR_ARGB8, mCOLOR_ABGR8 };
+	size_t i;
+	for (i = 0; i < sizeof(formats) / sizeof(*formats); ++i) {
+		struct mImage* image = mImageCreate(3, 3, formats[i]);
+		assert_non_null(image);
+		unsigned x, y;
+		for (y = 0; y < 3; ++y) {
+			for (x = 0; x < 3; ++x) {
+				mImageSetPixel(image, x, y, 0x80000000 | (y * 3 + x + 1));
+			}
+		}
+
+		// The rows overlap, and alpha has to be kept as is
+		mImageBlit(image, image, 1, 1);
+		COMPARE3(0x80000001, 0x80000002, 0x80000003,
+		         0x80000004, 0x80000001, 0x80000002,
+		         0x80000007, 0x80000004, 0x80000005);
+
+		mImageBlit(image, image, -1, -1);
+		COMPARE3(0x80000001, 0x80000002, 0x80000003,
+		         0x80000004, 0x80000005, 0x80000002,
+		         0x80000007, 0x80000004, 0x80000005);
+		mImageDestroy(image);
+	}
+}
+
+M_TEST_DEFINE(compositeOpaque) {
+	struct mImage* image = mImageCreate(3, 3, mCOLOR_XBGR8);
+	struct mImage* sprite = mImageCreate(3, 1, mCOLOR_ABGR8);
+	unsigned x, y;
+	for (y = 0; y < 3; ++y) {
+		for (x = 0; x < 3; ++x) {
+			mImageSetPixel(image, x, y, 0xFF0000FF);
+		}
+	}
+	mImageSetPixel(sprite, 0, 0, 0x00FF0000);
+	mImageSetPixel(sprite, 1, 0, 0x80FF0000);
+	mImageSetPixel(sprite, 2, 0, 0xFF00FF00);
+
+	mImageComposite(image, sprite, 0, 1);
+	mImageCompositeWithAlpha(image, sprite, 0, 2, 0.5f);
+	COMPARE3X(0x0000FF, 0x0000FF, 0x0000FF,
+	          0x0000FF, 0x80007F, 0x00FF00,
+	          0x0000FF, 0x4000BF, 0x007F80);
+
+	mImageDestroy(sprite);
+	mImageDestroy(image);
+}
+
+M_TEST_DEFINE(hashRegion) {
+	static const uint32_t buffer[9] = {
+		0xFF000001, 0xFF000002, 0xFF000003,
+		0xFF000004, 0xFF000005, 0xFF000006,
+		0xFF000007, 0xFF000008, 0xFF000009
+	};
+	struct mImage* image = mImageCreateFromConstBuffer(3, 3, 3, mCOLOR_XRGB8, buffer);
+	uint32_t full = mImageHashRegion(image, 0, 0, 3, 3);
+	uint32_t corner = mImageHashRegion(image, 0, 0, 2, 2);
+	assert_int_equal(mImageHashRegion(image, 0, 0, 0, 0), full);
+	assert_int_equal(mImageHashRegion(image, -1, -1, 3, 3), corner);
+	assert_int_not_equal(full, corner);
+	assert_int_equal(mImageHashRegion(image, 3, 0, 1, 1), 0);
+
+	// The unused byte doesn't count
+	mImageSetPixelRaw(image, 1, 1, 0x00000005);
+	assert_int_equal(mImageHashRegion(image, 0, 0, 3, 3), full);
+
+	mImageSetPixel(image, 2, 2, 0xFF000000);
+	assert_int_not_equal(mImageHashRegion(image, 0, 0, 3, 3), full);
+	assert_int_equal(mImageHashRegion(image, 0, 0, 2, 2), corner);
+
+	mImageDestroy(image);
+}
+
+M_TEST_DEFINE(compareImages) {
+	static const uint32_t buffer[9] = {
+		0xFF000001, 0xFF000002, 0xFF000003,
+		0xFF000004, 0xFF000005, 0xFF000006,
+		0xFF000007, 0xFF000008, 0xFF000009
+	};
+	struct mImage* image = mImageCreateFromConstBuffer(3, 3, 3, mCOLOR_XRGB8, buffer);
+	struct mImage* other = mImageCreate(2, 2, mCOLOR_ARGB8);
+	mImageSetPixel(other, 0, 0, 0xFF000005);
+	mImageSetPixel(other, 1, 0, 0x80000006);
+	mImageSetPixel(other, 0, 1, 0xFF000000);
+	mImageSetPixel(other, 1, 1, 0x00000000);
+
+	assert_int_equal(mImageCompare(image, other, 1, 1), 1);
+	assert_int_equal(mImageCompare(image, other, 0, 0), 3);
+	assert_int_equal(mImageCompare(image, other, 2, 2), 1);
+	assert_int_equal(mImageCompare(image, other, 3, 3), 0);
+	assert_int_equal(mImageCompare(image, image, 0, 0), 0);
+
+	struct mImage* converted = mImageConvertToFormat(image, mCOLOR_BGR8);
+	assert_int_equal(mImageCompare(converted, other, 1, 1), 1);
+	mImageDestroy(converted);
+
+	mImageDestroy(other);
+	mImageDestroy(image);
+}
+
 M_TEST_DEFINE(painterFillRectangle) {
 	struct mImage* image;
 	struct mPainter painter;
@@ -2158,6 +2260,10 @@ M_TEST_SUITE_DEFINE(Image,
 	cmocka_unit_test(convert1x2),
 	cmocka_unit_test(convert2x2),
 	cmocka_unit_test(blitBoundaries),
+	cmocka_unit_test(blitSelf),
+	cmocka_unit_test(compositeOpaque),
+	cmocka_unit_test(hashRegion),
+	cmocka_unit_test(compareImages),
 	cmocka_unit_test(painterFillRectangle),
 	cmocka_unit_test(painterFillRectangleBlend),
 	cmocka_unit_test(painterFillRectangleInvalid),
@@ -156,7 +156,7 @@ class Suite(object):
     def collect_tests(self):
         roms = []
         for f in os.listdir(self.cwd):
-            if f.endswith('.gba') or f.endswith('.zip') or f.endswith('.gbc') or f.endswith('.gb'):
+            if f.endswith('.gba') or f.endswith('.zip') or f.endswith('.gbc') or f.endswith('.gb') or f.endswith('.mvl'):
                 roms.append(f)
         roms.sort()
         for rom in roms: